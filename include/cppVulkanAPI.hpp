@@ -13,6 +13,7 @@
 #include "../src/core/pipeline/graphic_pipeline.hpp"
 #include "../src/core/pipeline/shader_module.hpp"
 #include "../src/core/pipeline/pipeline_layout.hpp"
+#include "../src/core/pipeline/pipeline_cache.hpp"
 #include "../src/core/pipeline/render_pass.hpp"
 #include "../src/core/pipeline/descriptor_layout.hpp"
 #include "../src/core/pipeline/descriptor_pool.hpp"
@@ -21,19 +22,37 @@
 #include "../src/core/command_pool.hpp"
 #include "../src/core/command_buffer.hpp"
 #include "../src/core/sync_object.hpp"
+#include "../src/core/query_pool.hpp"
 #include "../src/core/buffer.hpp"
 #include "../src/core/device_memory.hpp"
+#include "../src/core/memory_allocator.hpp"
 
 #include "../src/framework/device.hpp"
 #include "../src/framework/swapchain.hpp"
 #include "../src/framework/window/surface.hpp"
 #include "../src/framework/pipeline.hpp"
+#include "../src/framework/cache_file.hpp"
+#include "../src/framework/pipeline_cache.hpp"
+#include "../src/framework/thread_pool.hpp"
+#include "../src/framework/shader_module_cache.hpp"
+#include "../src/framework/gpu_profiler.hpp"
+#include "../src/framework/trace.hpp"
 #include "../src/framework/descriptor/descriptor.hpp"
+#include "../src/framework/descriptor/descriptor_allocator.hpp"
+#include "../src/framework/descriptor/bindless_texture_table.hpp"
 #include "../src/framework/descriptor/texture.hpp"
+#include "../src/framework/descriptor/compressed_texture.hpp"
 #include "../src/framework/descriptor/uniform_buffer.hpp"
+#include "../src/framework/descriptor/uniform_ring_buffer.hpp"
 #include "../src/framework/command.hpp"
+#include "../src/framework/mipmap_generator.hpp"
 #include "../src/framework/memory/buffer.hpp"
 #include "../src/framework/memory/image.hpp"
 #include "../src/framework/object/mesh.hpp"
+#include "../src/framework/object/mapped_file.hpp"
+#include "../src/framework/object/obj_loader.hpp"
+#include "../src/framework/object/mesh_cache.hpp"
+#include "../src/framework/object/gltf_model.hpp"
+#include "../src/framework/render_graph.hpp"
 #include "../src/framework/render_api.hpp"
 #include "../src/framework/spirv/parser.hpp"
\ No newline at end of file
@@ -0,0 +1,22 @@
+# Writes a SPIR-V binary as a C++ array of 32 bits words.
+# cmake -DINPUT=shader.spv -DOUTPUT=shader.spv.hpp -DNAME=shader_spv -P embed_spirv.cmake
+
+file(READ ${INPUT} SPIRV HEX)
+string(LENGTH "${SPIRV}" SPIRV_LENGTH)
+
+set(WORDS "")
+set(OFFSET 0)
+while(OFFSET LESS SPIRV_LENGTH)
+	# SPIR-V is little endian, the bytes of each word are reversed
+	string(SUBSTRING "${SPIRV}" ${OFFSET} 8 WORD)
+	string(SUBSTRING "${WORD}" 0 2 B0)
+	string(SUBSTRING "${WORD}" 2 2 B1)
+	string(SUBSTRING "${WORD}" 4 2 B2)
+	string(SUBSTRING "${WORD}" 6 2 B3)
+	string(APPEND WORDS "\t0x${B3}${B2}${B1}${B0}u,\n")
+	math(EXPR OFFSET "${OFFSET} + 8")
+endwhile()
+
+file(WRITE ${OUTPUT}
+	"#pragma once\n\n#include <cstdint>\n\nstatic const uint32_t ${NAME}[] =\n{\n${WORDS}};\n"
+)
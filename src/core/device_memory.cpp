@@ -3,6 +3,8 @@
 #include <stdexcept>
 #include <string.h>
 #include <iostream>
+#include <map>
+#include <mutex>
 
 namespace LIB_NAMESPACE
 {
@@ -14,6 +16,8 @@ namespace LIB_NAMESPACE
 		):
 			m_device(device)
 		{
+			m_allocation.size = alloc_info.allocationSize;
+
 			VK_CHECK(vkAllocateMemory(device, &alloc_info, nullptr, &m_memory), "failed to allocate device memory.");
 		}
 
@@ -21,30 +25,38 @@ namespace LIB_NAMESPACE
 			VkDevice device,
 			VkPhysicalDevice physical_device,
 			VkMemoryPropertyFlags properties,
-			VkMemoryRequirements memory_requirements
+			VkMemoryRequirements memory_requirements,
+			bool linear
 		):
-			m_device(device)
+			m_device(device),
+			m_allocator(&MemoryAllocator::get(device, physical_device))
 		{
-			VkMemoryAllocateInfo alloc_info = {};
-			alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			alloc_info.allocationSize = memory_requirements.size;
-			alloc_info.memoryTypeIndex = findMemoryType(
-				physical_device,
-				memory_requirements.memoryTypeBits,
-				properties
-			);
-
-			VK_CHECK(vkAllocateMemory(device, &alloc_info, nullptr, &m_memory), "failed to allocate device memory.");
+			m_allocation = m_allocator->allocate(memory_requirements, properties, linear);
+			m_memory = m_allocation.memory;
 		}
 
 		DeviceMemory::~DeviceMemory()
 		{
-			vkFreeMemory(m_device, m_memory, nullptr);
+			if (m_memory == VK_NULL_HANDLE)
+			{
+				return;
+			}
+
+			if (m_allocator != nullptr)
+			{
+				m_allocator->free(m_allocation);
+			}
+			else
+			{
+				vkFreeMemory(m_device, m_memory, nullptr);
+			}
 		}
 
 		DeviceMemory::DeviceMemory(DeviceMemory && other):
 			m_memory(other.m_memory),
 			m_device(other.m_device),
+			m_allocator(other.m_allocator),
+			m_allocation(other.m_allocation),
 			m_is_mapped(other.m_is_mapped),
 			m_mapped_memory(other.m_mapped_memory)
 		{
@@ -59,8 +71,21 @@ namespace LIB_NAMESPACE
 			VkMemoryPropertyFlags properties
 		)
 		{
-			VkPhysicalDeviceMemoryProperties mem_properties;
-			vkGetPhysicalDeviceMemoryProperties(physical_device, &mem_properties);
+			// memory properties never change, query them once per physical device
+			static std::mutex cache_mutex;
+			static std::map<VkPhysicalDevice, VkPhysicalDeviceMemoryProperties> cache;
+
+			std::unique_lock<std::mutex> lock(cache_mutex);
+
+			auto it = cache.find(physical_device);
+			if (it == cache.end())
+			{
+				VkPhysicalDeviceMemoryProperties mem_properties;
+				vkGetPhysicalDeviceMemoryProperties(physical_device, &mem_properties);
+				it = cache.emplace(physical_device, mem_properties).first;
+			}
+
+			const VkPhysicalDeviceMemoryProperties & mem_properties = it->second;
 
 			for (uint32_t i = 0; i < mem_properties.memoryTypeCount; i++)
 			{
@@ -82,6 +107,19 @@ namespace LIB_NAMESPACE
 			VkMemoryMapFlags flags
 		)
 		{
+			// sub-allocated memory lives in a persistently mapped block
+			if (m_allocator != nullptr)
+			{
+				if (m_allocation.mapped == nullptr)
+				{
+					return VK_ERROR_MEMORY_MAP_FAILED;
+				}
+
+				m_mapped_memory = static_cast<char *>(m_allocation.mapped) + offset;
+				m_is_mapped = true;
+				return VK_SUCCESS;
+			}
+
 			VkResult result = vkMapMemory(m_device, m_memory, offset, size, flags, &m_mapped_memory);
 
 			if (result == VK_SUCCESS)
@@ -94,18 +132,21 @@ namespace LIB_NAMESPACE
 
 		void DeviceMemory::unmap()
 		{
-			vkUnmapMemory(m_device, m_memory);
+			if (m_allocator == nullptr)
+			{
+				vkUnmapMemory(m_device, m_memory);
+			}
 			m_is_mapped = false;
 		}
 
-		void DeviceMemory::write(void *data, uint32_t size)
+		void DeviceMemory::write(void *data, uint32_t size, VkDeviceSize offset)
 		{
 			if (m_is_mapped == false)
 			{
 				throw std::runtime_error("failed to write data to memory: memory is not mapped.");
 			}
 
-			memcpy(m_mapped_memory, data, size);
+			memcpy(static_cast<char *>(m_mapped_memory) + offset, data, size);
 
 		}
 	}
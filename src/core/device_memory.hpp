@@ -1,6 +1,7 @@
 #pragma once
 
 #include "defines.hpp"
+#include "memory_allocator.hpp"
 
 #include <vulkan/vulkan.h>
 
@@ -18,11 +19,13 @@ namespace LIB_NAMESPACE
 				const VkMemoryAllocateInfo & alloc_info
 			);
 
+			// sub-allocated from the device MemoryAllocator, linear is false for optimal tiling images
 			DeviceMemory(
 				VkDevice device,
 				VkPhysicalDevice physical_device,
 				VkMemoryPropertyFlags properties,
-				VkMemoryRequirements memory_requirements
+				VkMemoryRequirements memory_requirements,
+				bool linear = true
 			);
 
 			~DeviceMemory();
@@ -32,6 +35,9 @@ namespace LIB_NAMESPACE
 			DeviceMemory(DeviceMemory && other);
 
 			VkDeviceMemory getVk() { return m_memory; }
+			// offset of this allocation inside getVk(), to use when binding
+			VkDeviceSize offset() const { return m_allocation.offset; }
+			VkDeviceSize size() const { return m_allocation.size; }
 
 			VkResult map(
 				VkDeviceSize offset = 0,
@@ -40,7 +46,9 @@ namespace LIB_NAMESPACE
 			);
 			void unmap();
 
-			void write(void *data, uint32_t size);
+			void write(void *data, uint32_t size, VkDeviceSize offset = 0);
+			// start of the mapped range, null when the memory is not mapped
+			void *mapped() { return m_is_mapped ? m_mapped_memory : nullptr; }
 
 			static uint32_t findMemoryType(
 				VkPhysicalDevice physical_device,
@@ -54,8 +62,12 @@ namespace LIB_NAMESPACE
 
 			VkDevice m_device;
 
-			bool m_is_mapped;
-			void *m_mapped_memory;
+			// no allocator when the memory was allocated directly from a VkMemoryAllocateInfo
+			MemoryAllocator *m_allocator = nullptr;
+			MemoryAllocator::Allocation m_allocation = {};
+
+			bool m_is_mapped = false;
+			void *m_mapped_memory = nullptr;
 
 		};
 	}
@@ -1,8 +1,10 @@
 #include "device.hpp"
+#include "memory_allocator.hpp"
 
 #include <stdexcept>
 #include <iostream>
 #include <set>
+#include <string>
 
 namespace LIB_NAMESPACE
 {
@@ -17,22 +19,95 @@ namespace LIB_NAMESPACE
 			VkDeviceCreateInfo createInfo = {};
 			createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
-			VkPhysicalDeviceFeatures deviceFeatures = {};
-			deviceFeatures.samplerAnisotropy = VK_TRUE;
-			createInfo.pEnabledFeatures = &deviceFeatures;
+			// optional features are enabled when the device has them, callers check enabledFeatures()
+			VkPhysicalDeviceVulkan12Features supportedVulkan12Features = {};
+			supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+			// only known to Vulkan 1.3 devices, the others leave synchronization2 unsupported
+			VkPhysicalDeviceVulkan13Features supportedVulkan13Features = {};
+			supportedVulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physical_device.getVk(), &properties);
+			if (properties.apiVersion >= VK_API_VERSION_1_3)
+			{
+				supportedVulkan12Features.pNext = &supportedVulkan13Features;
+			}
+
+			VkPhysicalDeviceFeatures2 supportedFeatures = {};
+			supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			supportedFeatures.pNext = &supportedVulkan12Features;
+			vkGetPhysicalDeviceFeatures2(physical_device.getVk(), &supportedFeatures);
+
+			m_enabled_features = {};
+			m_enabled_features.samplerAnisotropy = VK_TRUE;
+			m_enabled_features.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect;
+			m_enabled_features.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+			m_enabled_features.shaderStorageImageWriteWithoutFormat = supportedFeatures.features.shaderStorageImageWriteWithoutFormat;
+			m_enabled_features.shaderStorageImageArrayDynamicIndexing = supportedFeatures.features.shaderStorageImageArrayDynamicIndexing;
+			m_enabled_features.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+			m_enabled_features.textureCompressionASTC_LDR = supportedFeatures.features.textureCompressionASTC_LDR;
+			createInfo.pEnabledFeatures = &m_enabled_features;
+
+			VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+			vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+			vulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+			m_draw_indirect_count = supportedVulkan12Features.drawIndirectCount == VK_TRUE;
+
+			// bindless textures: a partially bound array of sampled images indexed by the shaders
+			// and written while frames reading other elements are in flight
+			m_descriptor_indexing =
+				supportedVulkan12Features.runtimeDescriptorArray == VK_TRUE &&
+				supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing == VK_TRUE &&
+				supportedVulkan12Features.descriptorBindingPartiallyBound == VK_TRUE &&
+				supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+				supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending == VK_TRUE;
+			if (m_descriptor_indexing)
+			{
+				vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+				vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+				vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+				vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+				vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+			}
+
+			// vkCmdPipelineBarrier2 of the render graph
+			if (supportedVulkan13Features.synchronization2 != VK_TRUE)
+			{
+				throw std::runtime_error(
+					std::string("failed to create logical device: ") + properties.deviceName
+					+ " does not support synchronization2, a Vulkan 1.3 device is required"
+				);
+			}
+			VkPhysicalDeviceSynchronization2Features synchronization2Features = {};
+			synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+			synchronization2Features.synchronization2 = VK_TRUE;
+			synchronization2Features.pNext = &vulkan12Features;
 
 			VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
 			dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
 			dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+			dynamicRenderingFeatures.pNext = &synchronization2Features;
 			createInfo.pNext = &dynamicRenderingFeatures;
 
 			auto queueFamilyIndices = physical_device.queueFamilyIndices();
 
 			std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 			std::set<uint32_t> uniqueQueueFamilies = {
-				queueFamilyIndices.graphicsFamily.value(),
-				queueFamilyIndices.presentFamily.value()
+				queueFamilyIndices.graphicsFamily.value()
 			};
+			if (queueFamilyIndices.presentFamily.has_value())
+			{
+				uniqueQueueFamilies.insert(queueFamilyIndices.presentFamily.value());
+			}
+			if (queueFamilyIndices.transferFamily.has_value())
+			{
+				uniqueQueueFamilies.insert(queueFamilyIndices.transferFamily.value());
+			}
+			if (queueFamilyIndices.computeFamily.has_value())
+			{
+				uniqueQueueFamilies.insert(queueFamilyIndices.computeFamily.value());
+			}
 
 			float queuePriority = 1.0f;
 			for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -75,6 +150,7 @@ namespace LIB_NAMESPACE
 
 		Device::~Device()
 		{
+			MemoryAllocator::destroy(m_device);
 			vkDestroyDevice(m_device, nullptr);
 		}
 
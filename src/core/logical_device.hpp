@@ -35,9 +35,18 @@ namespace LIB_NAMESPACE
 
 			VkResult waitIdle();
 
+			const VkPhysicalDeviceFeatures & enabledFeatures() const { return m_enabled_features; }
+			bool drawIndirectCountEnabled() const { return m_draw_indirect_count; }
+			// the descriptor indexing features needed by BindlessTextureTable
+			bool descriptorIndexingEnabled() const { return m_descriptor_indexing; }
+
 		private:
 
 			VkDevice m_device;
+
+			VkPhysicalDeviceFeatures m_enabled_features = {};
+			bool m_draw_indirect_count = false;
+			bool m_descriptor_indexing = false;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include "memory_allocator.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+namespace LIB_NAMESPACE
+{
+	namespace core
+	{
+		std::mutex MemoryAllocator::s_registry_mutex;
+		std::map<VkDevice, std::unique_ptr<MemoryAllocator>> MemoryAllocator::s_registry;
+
+		MemoryAllocator::MemoryAllocator(
+			VkDevice device,
+			VkPhysicalDevice physical_device,
+			VkDeviceSize block_size
+		):
+			m_device(device),
+			m_block_size(block_size)
+		{
+			vkGetPhysicalDeviceMemoryProperties(physical_device, &m_memory_properties);
+		}
+
+		MemoryAllocator::~MemoryAllocator()
+		{
+			for (uint32_t i = 0; i < m_blocks.size(); i++)
+			{
+				destroyBlock(i);
+			}
+		}
+
+		MemoryAllocator::Allocation MemoryAllocator::allocate(
+			VkMemoryRequirements memory_requirements,
+			VkMemoryPropertyFlags properties,
+			bool linear
+		)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			Allocation allocation = {};
+			allocation.memory_type = findMemoryType(memory_requirements.memoryTypeBits, properties);
+			allocation.size = memory_requirements.size;
+
+			VkDeviceSize alignment = std::max<VkDeviceSize>(memory_requirements.alignment, 1);
+
+			// big resources get a block of their own so they don't waste half a block
+			if (memory_requirements.size > m_block_size / 2)
+			{
+				allocation.block_index = createBlock(allocation.memory_type, memory_requirements.size, linear, true);
+				allocation.offset = 0;
+			}
+			else
+			{
+				bool found = false;
+				for (uint32_t i = 0; i < m_blocks.size() && found == false; i++)
+				{
+					Block * block = m_blocks[i].get();
+					if (
+						block != nullptr
+						&& block->dedicated == false
+						&& block->memory_type == allocation.memory_type
+						&& block->linear == linear
+						&& allocateFromBlock(*block, memory_requirements.size, alignment, allocation.offset)
+					)
+					{
+						allocation.block_index = i;
+						found = true;
+					}
+				}
+
+				if (found == false)
+				{
+					allocation.block_index = createBlock(allocation.memory_type, m_block_size, linear, false);
+					allocateFromBlock(*m_blocks[allocation.block_index], memory_requirements.size, alignment, allocation.offset);
+				}
+			}
+
+			Block & block = *m_blocks[allocation.block_index];
+			block.allocation_count++;
+
+			allocation.memory = block.memory;
+			if (block.mapped != nullptr)
+			{
+				allocation.mapped = static_cast<char *>(block.mapped) + allocation.offset;
+			}
+
+			return allocation;
+		}
+
+		void MemoryAllocator::free(const Allocation & allocation)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			Block & block = *m_blocks[allocation.block_index];
+			block.allocation_count--;
+
+			if (block.dedicated)
+			{
+				destroyBlock(allocation.block_index);
+				return;
+			}
+
+			auto it = block.free_ranges.emplace(allocation.offset, allocation.size).first;
+
+			// merge with the following free range
+			auto next = std::next(it);
+			if (next != block.free_ranges.end() && it->first + it->second == next->first)
+			{
+				it->second += next->second;
+				block.free_ranges.erase(next);
+			}
+
+			// merge with the preceding free range
+			if (it != block.free_ranges.begin())
+			{
+				auto prev = std::prev(it);
+				if (prev->first + prev->second == it->first)
+				{
+					prev->second += it->second;
+					block.free_ranges.erase(it);
+				}
+			}
+
+			if (block.allocation_count > 0)
+			{
+				return;
+			}
+
+			// keep one empty block per memory type so staging buffers don't reallocate a block every upload
+			for (uint32_t i = 0; i < m_blocks.size(); i++)
+			{
+				Block * other = m_blocks[i].get();
+				if (
+					i != allocation.block_index
+					&& other != nullptr
+					&& other->dedicated == false
+					&& other->allocation_count == 0
+					&& other->memory_type == block.memory_type
+					&& other->linear == block.linear
+				)
+				{
+					destroyBlock(allocation.block_index);
+					return;
+				}
+			}
+		}
+
+		uint32_t MemoryAllocator::findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const
+		{
+			for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++)
+			{
+				if (
+					(type_filter & (1 << i))
+					&& (m_memory_properties.memoryTypes[i].propertyFlags & properties) == properties
+				)
+				{
+					return i;
+				}
+			}
+
+			throw std::runtime_error("failed to find suitable memory type for buffer.");
+		}
+
+		MemoryAllocator::Stats MemoryAllocator::stats()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			Stats stats = {};
+			stats.heaps.resize(m_memory_properties.memoryHeapCount);
+
+			VkDeviceSize total_free = 0;
+			VkDeviceSize largest_free = 0;
+
+			for (auto& block : m_blocks)
+			{
+				if (block == nullptr)
+				{
+					continue;
+				}
+
+				VkDeviceSize free_bytes = 0;
+				for (auto& range : block->free_ranges)
+				{
+					free_bytes += range.second;
+					largest_free = std::max(largest_free, range.second);
+				}
+				total_free += free_bytes;
+
+				uint32_t heap_index = m_memory_properties.memoryTypes[block->memory_type].heapIndex;
+				stats.heaps[heap_index].block_bytes += block->size;
+				stats.heaps[heap_index].used_bytes += block->size - free_bytes;
+
+				stats.block_count++;
+				stats.allocation_count += block->allocation_count;
+				stats.block_bytes += block->size;
+				stats.used_bytes += block->size - free_bytes;
+			}
+
+			if (total_free > 0)
+			{
+				stats.fragmentation = 1.0f - static_cast<float>(largest_free) / static_cast<float>(total_free);
+			}
+
+			return stats;
+		}
+
+		MemoryAllocator & MemoryAllocator::get(VkDevice device, VkPhysicalDevice physical_device)
+		{
+			std::unique_lock<std::mutex> lock(s_registry_mutex);
+
+			auto it = s_registry.find(device);
+			if (it == s_registry.end())
+			{
+				it = s_registry.emplace(device, std::make_unique<MemoryAllocator>(device, physical_device)).first;
+			}
+
+			return *it->second;
+		}
+
+		MemoryAllocator * MemoryAllocator::find(VkDevice device)
+		{
+			std::unique_lock<std::mutex> lock(s_registry_mutex);
+
+			auto it = s_registry.find(device);
+			return it == s_registry.end() ? nullptr : it->second.get();
+		}
+
+		void MemoryAllocator::destroy(VkDevice device)
+		{
+			std::unique_lock<std::mutex> lock(s_registry_mutex);
+
+			s_registry.erase(device);
+		}
+
+		uint32_t MemoryAllocator::createBlock(uint32_t memory_type, VkDeviceSize size, bool linear, bool dedicated)
+		{
+			auto block = std::make_unique<Block>();
+			block->size = size;
+			block->memory_type = memory_type;
+			block->linear = linear;
+			block->dedicated = dedicated;
+
+			VkMemoryAllocateInfo alloc_info = {};
+			alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			alloc_info.allocationSize = size;
+			alloc_info.memoryTypeIndex = memory_type;
+
+			VK_CHECK(vkAllocateMemory(m_device, &alloc_info, nullptr, &block->memory), "failed to allocate device memory.");
+
+			// host visible blocks stay mapped for their whole life, a memory object can only be mapped once
+			if (m_memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			{
+				VK_CHECK(vkMapMemory(m_device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped), "failed to map device memory.");
+			}
+
+			if (dedicated == false)
+			{
+				block->free_ranges.emplace(0, size);
+			}
+
+			for (uint32_t i = 0; i < m_blocks.size(); i++)
+			{
+				if (m_blocks[i] == nullptr)
+				{
+					m_blocks[i] = std::move(block);
+					return i;
+				}
+			}
+
+			m_blocks.push_back(std::move(block));
+			return static_cast<uint32_t>(m_blocks.size() - 1);
+		}
+
+		void MemoryAllocator::destroyBlock(uint32_t block_index)
+		{
+			if (m_blocks[block_index] == nullptr)
+			{
+				return;
+			}
+
+			if (m_blocks[block_index]->mapped != nullptr)
+			{
+				vkUnmapMemory(m_device, m_blocks[block_index]->memory);
+			}
+			vkFreeMemory(m_device, m_blocks[block_index]->memory, nullptr);
+
+			m_blocks[block_index].reset();
+		}
+
+		bool MemoryAllocator::allocateFromBlock(
+			Block & block,
+			VkDeviceSize size,
+			VkDeviceSize alignment,
+			VkDeviceSize & offset
+		)
+		{
+			for (auto it = block.free_ranges.begin(); it != block.free_ranges.end(); it++)
+			{
+				VkDeviceSize range_offset = it->first;
+				VkDeviceSize range_size = it->second;
+
+				VkDeviceSize aligned_offset = (range_offset + alignment - 1) / alignment * alignment;
+				VkDeviceSize padding = aligned_offset - range_offset;
+
+				if (range_size < padding + size)
+				{
+					continue;
+				}
+
+				block.free_ranges.erase(it);
+
+				if (padding > 0)
+				{
+					block.free_ranges.emplace(range_offset, padding);
+				}
+				if (range_size > padding + size)
+				{
+					block.free_ranges.emplace(aligned_offset + size, range_size - padding - size);
+				}
+
+				offset = aligned_offset;
+				return true;
+			}
+
+			return false;
+		}
+	}
+}
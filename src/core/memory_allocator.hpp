@@ -0,0 +1,120 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	namespace core
+	{
+		// Carves buffers and images out of large VkDeviceMemory blocks instead of
+		// calling vkAllocateMemory for every resource.
+		// Linear (buffers, linear images) and optimal resources never share a block,
+		// so bufferImageGranularity can not be violated between neighbours.
+		class MemoryAllocator
+		{
+
+		public:
+
+			struct Allocation
+			{
+				VkDeviceMemory memory = VK_NULL_HANDLE;
+				VkDeviceSize offset = 0;
+				VkDeviceSize size = 0;
+				// null when the memory is not host visible
+				void *mapped = nullptr;
+
+				uint32_t block_index = 0;
+				uint32_t memory_type = 0;
+			};
+
+			struct HeapStats
+			{
+				VkDeviceSize block_bytes = 0;
+				VkDeviceSize used_bytes = 0;
+			};
+
+			struct Stats
+			{
+				uint32_t block_count = 0;
+				uint32_t allocation_count = 0;
+				VkDeviceSize block_bytes = 0;
+				VkDeviceSize used_bytes = 0;
+				// 0 when all free space is contiguous, close to 1 when it is scattered in small ranges
+				float fragmentation = 0.0f;
+				std::vector<HeapStats> heaps;
+			};
+
+			MemoryAllocator(
+				VkDevice device,
+				VkPhysicalDevice physical_device,
+				VkDeviceSize block_size = 64 * 1024 * 1024
+			);
+			~MemoryAllocator();
+
+			MemoryAllocator(const MemoryAllocator &) = delete;
+			MemoryAllocator & operator=(const MemoryAllocator &) = delete;
+
+			Allocation allocate(
+				VkMemoryRequirements memory_requirements,
+				VkMemoryPropertyFlags properties,
+				bool linear
+			);
+			void free(const Allocation & allocation);
+
+			uint32_t findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const;
+
+			const VkPhysicalDeviceMemoryProperties & memoryProperties() const { return m_memory_properties; }
+
+			Stats stats();
+
+			// one allocator per logical device, created on first use
+			static MemoryAllocator & get(VkDevice device, VkPhysicalDevice physical_device);
+			static MemoryAllocator * find(VkDevice device);
+			static void destroy(VkDevice device);
+
+		private:
+
+			struct Block
+			{
+				VkDeviceMemory memory = VK_NULL_HANDLE;
+				VkDeviceSize size = 0;
+				void *mapped = nullptr;
+				uint32_t memory_type = 0;
+				bool linear = true;
+				bool dedicated = false;
+				uint32_t allocation_count = 0;
+				// free ranges ordered by offset: offset -> size
+				std::map<VkDeviceSize, VkDeviceSize> free_ranges;
+			};
+
+			VkDevice m_device;
+			VkDeviceSize m_block_size;
+			VkPhysicalDeviceMemoryProperties m_memory_properties;
+
+			std::vector<std::unique_ptr<Block>> m_blocks;
+
+			std::mutex m_mutex;
+
+			uint32_t createBlock(uint32_t memory_type, VkDeviceSize size, bool linear, bool dedicated);
+			void destroyBlock(uint32_t block_index);
+
+			static bool allocateFromBlock(
+				Block & block,
+				VkDeviceSize size,
+				VkDeviceSize alignment,
+				VkDeviceSize & offset
+			);
+
+			static std::mutex s_registry_mutex;
+			static std::map<VkDevice, std::unique_ptr<MemoryAllocator>> s_registry;
+
+		};
+	}
+}
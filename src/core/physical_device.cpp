@@ -63,8 +63,11 @@ namespace LIB_NAMESPACE
 
 			bool extensionsSupported = core::PhysicalDevice::checkExtensionSupport(physical_device, device_extensions);
 
-			bool swapChainAdequate = false;
-			if (extensionsSupported)
+			// without a surface there is no swapchain to check
+			bool headless = surface == VK_NULL_HANDLE;
+
+			bool swapChainAdequate = headless;
+			if (extensionsSupported && headless == false)
 			{
 				Swapchain::SupportDetails swapChainSupport = querySwapChainSupport(physical_device, surface);
 				swapChainAdequate = swapChainSupport.formats.empty() == false
@@ -74,7 +77,7 @@ namespace LIB_NAMESPACE
 			VkPhysicalDeviceFeatures supportedFeatures;
 			vkGetPhysicalDeviceFeatures(physical_device, &supportedFeatures);
 
-			return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+			return indices.isComplete(headless == false) && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
 		}
 
 		core::Queue::FamilyIndices PhysicalDevice::findQueueFamilies(
@@ -86,29 +89,51 @@ namespace LIB_NAMESPACE
 
 			std::vector<VkQueueFamilyProperties> queueFamilyProperties = core::PhysicalDevice::getQueueFamilyProperties(physical_device);
 
-			int i = 0;
+			uint32_t i = 0;
 			for (const auto& queueFamily : queueFamilyProperties)
 			{
-				if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+				bool graphics = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+				bool compute = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+				bool transfer = queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
+
+				if (graphics && indices.graphicsFamily.has_value() == false)
 				{
 					indices.graphicsFamily = i;
 				}
 
-				VkBool32 presentSupport = core::PhysicalDevice::getSurfaceSupport(physical_device, i, surface);
-
-				if (presentSupport)
+				if (
+					surface != VK_NULL_HANDLE
+					&& indices.presentFamily.has_value() == false
+					&& core::PhysicalDevice::getSurfaceSupport(physical_device, i, surface)
+				)
 				{
 					indices.presentFamily = i;
 				}
 
-				if (indices.isComplete())
+				// DMA engine: transfer without graphics or compute
+				if (transfer && graphics == false && compute == false && indices.transferFamily.has_value() == false)
 				{
-					break;
+					indices.transferFamily = i;
+				}
+
+				if (compute && graphics == false && indices.computeFamily.has_value() == false)
+				{
+					indices.computeFamily = i;
 				}
 
 				i++;
 			}
 
+			// presenting from the graphics family avoids sharing the swapchain images
+			if (
+				surface != VK_NULL_HANDLE
+				&& indices.graphicsFamily.has_value()
+				&& core::PhysicalDevice::getSurfaceSupport(physical_device, indices.graphicsFamily.value(), surface)
+			)
+			{
+				indices.presentFamily = indices.graphicsFamily;
+			}
+
 			return indices;
 		}
 
@@ -6,15 +6,32 @@ namespace LIB_NAMESPACE
 {
 	namespace core
 	{
-		Pipeline::Pipeline(VkDevice device, const VkGraphicsPipelineCreateInfo& createInfo)
+		Pipeline::Pipeline(
+			VkDevice device,
+			const VkGraphicsPipelineCreateInfo& createInfo,
+			VkPipelineCache pipelineCache
+		)
 			: m_device(device)
 		{
-			if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &m_pipeline) != VK_SUCCESS)
+			if (vkCreateGraphicsPipelines(m_device, pipelineCache, 1, &createInfo, nullptr, &m_pipeline) != VK_SUCCESS)
 			{
 				throw std::runtime_error("failed to create graphics pipeline.");
 			}
 		}
 
+		Pipeline::Pipeline(
+			VkDevice device,
+			const VkComputePipelineCreateInfo& createInfo,
+			VkPipelineCache pipelineCache
+		)
+			: m_device(device)
+		{
+			if (vkCreateComputePipelines(m_device, pipelineCache, 1, &createInfo, nullptr, &m_pipeline) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create compute pipeline.");
+			}
+		}
+
 		Pipeline::~Pipeline()
 		{
 			vkDestroyPipeline(m_device, m_pipeline, nullptr);
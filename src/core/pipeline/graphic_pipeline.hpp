@@ -21,7 +21,24 @@ namespace LIB_NAMESPACE
 				}
 			};
 
-			Pipeline(VkDevice device, const VkGraphicsPipelineCreateInfo& createInfo);
+			struct ComputeCreateInfo: public VkComputePipelineCreateInfo
+			{
+				ComputeCreateInfo(): VkComputePipelineCreateInfo()
+				{
+					this->sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+				}
+			};
+
+			Pipeline(
+				VkDevice device,
+				const VkGraphicsPipelineCreateInfo& createInfo,
+				VkPipelineCache pipelineCache = VK_NULL_HANDLE
+			);
+			Pipeline(
+				VkDevice device,
+				const VkComputePipelineCreateInfo& createInfo,
+				VkPipelineCache pipelineCache = VK_NULL_HANDLE
+			);
 			~Pipeline();
 
 			VkPipeline getVk() const { return m_pipeline; }
@@ -0,0 +1,43 @@
+#include "pipeline_cache.hpp"
+
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	namespace core
+	{
+		PipelineCache::PipelineCache(VkDevice device, const VkPipelineCacheCreateInfo& createInfo)
+			: m_device(device)
+		{
+			if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_pipeline_cache) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create pipeline cache.");
+			}
+		}
+
+		PipelineCache::~PipelineCache()
+		{
+			vkDestroyPipelineCache(m_device, m_pipeline_cache, nullptr);
+		}
+
+		std::vector<unsigned char> PipelineCache::getData() const
+		{
+			size_t size = 0;
+			if (vkGetPipelineCacheData(m_device, m_pipeline_cache, &size, nullptr) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to get pipeline cache data size.");
+			}
+
+			std::vector<unsigned char> data(size);
+			// VK_INCOMPLETE only if the cache grew in between, the data written is still a valid cache
+			VkResult result = vkGetPipelineCacheData(m_device, m_pipeline_cache, &size, data.data());
+			if (result != VK_SUCCESS && result != VK_INCOMPLETE)
+			{
+				throw std::runtime_error("failed to get pipeline cache data.");
+			}
+			data.resize(size);
+
+			return data;
+		}
+	}
+}
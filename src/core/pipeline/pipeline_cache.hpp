@@ -0,0 +1,41 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	namespace core
+	{
+		class PipelineCache
+		{
+		
+		public:
+
+			struct CreateInfo: public VkPipelineCacheCreateInfo
+			{
+				CreateInfo(): VkPipelineCacheCreateInfo()
+				{
+					this->sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+				}
+			};
+
+			PipelineCache(VkDevice device, const VkPipelineCacheCreateInfo& createInfo);
+			~PipelineCache();
+
+			VkPipelineCache getVk() const { return m_pipeline_cache; }
+
+			std::vector<unsigned char> getData() const;
+
+		private:
+
+			VkPipelineCache m_pipeline_cache;
+
+			VkDevice m_device;
+
+		};
+	}
+}
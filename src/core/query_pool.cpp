@@ -0,0 +1,35 @@
+#include "query_pool.hpp"
+
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	namespace core
+	{
+		QueryPool::QueryPool(VkDevice device, const CreateInfo& createInfo)
+			: m_device(device)
+		{
+			if (vkCreateQueryPool(device, &createInfo, nullptr, &m_query_pool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create query pool.");
+			}
+		}
+
+		QueryPool::~QueryPool()
+		{
+			vkDestroyQueryPool(m_device, m_query_pool, nullptr);
+		}
+
+		VkResult QueryPool::getResults(
+			uint32_t firstQuery,
+			uint32_t queryCount,
+			size_t dataSize,
+			void* pData,
+			VkDeviceSize stride,
+			VkQueryResultFlags flags
+		)
+		{
+			return vkGetQueryPoolResults(m_device, m_query_pool, firstQuery, queryCount, dataSize, pData, stride, flags);
+		}
+	}
+}
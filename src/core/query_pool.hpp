@@ -0,0 +1,47 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace LIB_NAMESPACE
+{
+	namespace core
+	{
+		class QueryPool
+		{
+
+		public:
+
+			struct CreateInfo: public VkQueryPoolCreateInfo
+			{
+				CreateInfo(): VkQueryPoolCreateInfo()
+				{
+					this->sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+				}
+			};
+
+			QueryPool(VkDevice device, const CreateInfo& createInfo);
+			~QueryPool();
+
+			VkQueryPool getVk() const { return m_query_pool; }
+
+			// VK_NOT_READY when a query is not available yet, see vkGetQueryPoolResults
+			VkResult getResults(
+				uint32_t firstQuery,
+				uint32_t queryCount,
+				size_t dataSize,
+				void* pData,
+				VkDeviceSize stride,
+				VkQueryResultFlags flags
+			);
+
+		private:
+
+			VkQueryPool m_query_pool;
+
+			VkDevice m_device;
+
+		};
+	}
+}
@@ -27,10 +27,14 @@ namespace LIB_NAMESPACE
 			{
 				std::optional<uint32_t> graphicsFamily;
 				std::optional<uint32_t> presentFamily;
+				// families without graphics, so their queues run on separate hardware queues when the device has them
+				std::optional<uint32_t> transferFamily;
+				std::optional<uint32_t> computeFamily;
 
-				bool isComplete()
+				// headless devices never present, so they only need a graphics family
+				bool isComplete(bool require_present = true)
 				{
-					return graphicsFamily.has_value() && presentFamily.has_value();
+					return graphicsFamily.has_value() && (presentFamily.has_value() || require_present == false);
 				}
 			};
 
@@ -43,5 +43,10 @@ namespace LIB_NAMESPACE
 		{
 			vkResetFences(m_device, 1, &m_fence);
 		}
+
+		bool Fence::isSignaled() const
+		{
+			return vkGetFenceStatus(m_device, m_fence) == VK_SUCCESS;
+		}
 	}
 }
\ No newline at end of file
@@ -56,6 +56,7 @@ namespace LIB_NAMESPACE
 
 			void wait(uint64_t timeout = UINT64_MAX);
 			void reset();
+			bool isSignaled() const;
 
 		private:
 
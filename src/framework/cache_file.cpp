@@ -0,0 +1,43 @@
+#include "cache_file.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+namespace LIB_NAMESPACE
+{
+	bool CacheFile::write(
+		const std::string & path,
+		const Header & header,
+		const std::vector<std::pair<const void *, size_t>> & parts
+	)
+	{
+		std::string temporary_path = path + ".tmp";
+		{
+			std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+			if (file.is_open() == false)
+			{
+				return false;
+			}
+
+			file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+			for (const auto & part : parts)
+			{
+				file.write(static_cast<const char *>(part.first), static_cast<std::streamsize>(part.second));
+			}
+
+			if (file.good() == false)
+			{
+				file.close();
+				std::remove(temporary_path.c_str());
+				return false;
+			}
+		}
+
+		if (std::rename(temporary_path.c_str(), path.c_str()) != 0)
+		{
+			std::remove(temporary_path.c_str());
+			return false;
+		}
+		return true;
+	}
+}
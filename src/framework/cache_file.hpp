@@ -0,0 +1,77 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// Layout and atomic write shared by the files the library caches on disk (meshes, pipelines).
+	// A file starts with a 64 bytes header: a magic naming the kind of cache, its format version
+	// and up to 48 bytes of info each cache fills with what identifies and describes its content.
+	class CacheFile
+	{
+
+	public:
+
+		struct Header
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t reserved;
+			uint8_t info[48];
+		};
+		static_assert(sizeof(Header) == 64, "cache file header must stay 64 bytes");
+
+		template<typename Info>
+		static Header makeHeader(const char (&magic)[8], uint32_t version, const Info & info)
+		{
+			static_assert(std::is_trivially_copyable<Info>::value && sizeof(Info) <= sizeof(Header::info), "cache info must fit the header");
+
+			Header header = {};
+			std::memcpy(header.magic, magic, sizeof(header.magic));
+			header.version = version;
+			std::memcpy(header.info, &info, sizeof(Info));
+			return header;
+		}
+
+		// false when the data is too short for a header or has another magic or version,
+		// otherwise the info is copied out for the cache to check
+		template<typename Info>
+		static bool readHeader(const void *data, size_t size, const char (&magic)[8], uint32_t version, Info & info)
+		{
+			static_assert(std::is_trivially_copyable<Info>::value && sizeof(Info) <= sizeof(Header::info), "cache info must fit the header");
+
+			if (size < sizeof(Header))
+			{
+				return false;
+			}
+
+			Header header;
+			std::memcpy(&header, data, sizeof(header));
+			if (std::memcmp(header.magic, magic, sizeof(header.magic)) != 0 || header.version != version)
+			{
+				return false;
+			}
+
+			std::memcpy(&info, header.info, sizeof(Info));
+			return true;
+		}
+
+		// The header then each part, written next to path and renamed over it,
+		// so a concurrent reader or a crash while writing never sees a partial file.
+		// Returns false when the file could not be written, nothing is left behind then.
+		static bool write(
+			const std::string & path,
+			const Header & header,
+			const std::vector<std::pair<const void *, size_t>> & parts
+		);
+
+	};
+}
@@ -1,17 +1,43 @@
 #include "command.hpp"
+#include "trace.hpp"
 
 #include <stdexcept>
 
 namespace LIB_NAMESPACE
 {
 	Command::Command(VkDevice device, const CreateInfo& createInfo)
-		: m_device(device), m_queue(createInfo.queue)
+		: m_device(device),
+		m_queue(createInfo.queue),
+		m_queueFamilyIndex(createInfo.queueFamilyIndex),
+		m_transferQueue(createInfo.transferQueue),
+		m_transferQueueFamilyIndex(createInfo.transferQueueFamilyIndex)
 	{
 		createCommandPool(createInfo);
 	}
 
 	Command::~Command()
 	{
+		if (m_recording_batch.commandBuffer != VK_NULL_HANDLE)
+		{
+			vkEndCommandBuffer(m_recording_batch.commandBuffer);
+			freeCommandBuffer(m_recording_batch.commandBuffer);
+		}
+		if (m_recording_batch.transferCommandBuffer != VK_NULL_HANDLE)
+		{
+			vkEndCommandBuffer(m_recording_batch.transferCommandBuffer);
+			vkFreeCommandBuffers(m_device, m_transferCommandPool, 1, &m_recording_batch.transferCommandBuffer);
+		}
+
+		for (auto& batch : m_pending_batches)
+		{
+			batch.fence->wait();
+		}
+		collectCompletedBatches();
+
+		if (m_transferCommandPool != VK_NULL_HANDLE)
+		{
+			vkDestroyCommandPool(m_device, m_transferCommandPool, nullptr);
+		}
 		vkDestroyCommandPool(m_device, m_commandPool, nullptr);
 	}
 
@@ -27,6 +53,22 @@ namespace LIB_NAMESPACE
 		{
 			TROW("Failed to create command pool", result);
 		}
+
+		// a transfer queue of the same family brings nothing over the batch
+		if (m_transferQueue == VK_NULL_HANDLE || m_transferQueueFamilyIndex == m_queueFamilyIndex)
+		{
+			m_transferQueue = VK_NULL_HANDLE;
+			return;
+		}
+
+		poolInfo.queueFamilyIndex = m_transferQueueFamilyIndex;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		result = vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_transferCommandPool);
+		if (result != VK_SUCCESS)
+		{
+			TROW("Failed to create transfer command pool", result);
+		}
 	}
 
 	VkCommandBuffer Command::allocateCommandBuffer(VkCommandBufferLevel level)
@@ -52,6 +94,11 @@ namespace LIB_NAMESPACE
 		vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
 	}
 
+	void Command::resetPool(VkCommandPoolResetFlags flags)
+	{
+		VK_CHECK(vkResetCommandPool(m_device, m_commandPool, flags), "Failed to reset command pool");
+	}
+
 	VkCommandBuffer Command::beginSingleTimeCommands()
 	{
 		VkCommandBuffer commandBuffer = allocateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
@@ -91,21 +138,217 @@ namespace LIB_NAMESPACE
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
 
-		result = vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE);
+		// the pending batch must execute before this submit
+		flush();
+
+		// only wait for this submit instead of stalling the whole queue
+		core::Fence fence(m_device, core::Fence::CreateInfo());
+
+		result = vkQueueSubmit(m_queue, 1, &submitInfo, fence.getVk());
 		if (result != VK_SUCCESS)
 		{
 			TROW("Failed to submit queue", result);
 		}
 
-		result = vkQueueWaitIdle(m_queue);
-		if (result != VK_SUCCESS)
 		{
-			TROW("Failed to wait for queue to be idle", result);
+			TRACE_ZONE("wait single time commands");
+			fence.wait();
 		}
 
 		freeCommandBuffer(commandBuffer);
 	}
 
+	VkCommandBuffer Command::batchCommandBuffer()
+	{
+		if (m_recording_batch.commandBuffer == VK_NULL_HANDLE)
+		{
+			m_recording_batch.commandBuffer = beginSingleTimeCommands();
+			m_recording_batch.ticket = m_next_ticket++;
+		}
+
+		return m_recording_batch.commandBuffer;
+	}
+
+	uint64_t Command::batchTicket()
+	{
+		batchCommandBuffer();
+
+		return m_recording_batch.ticket;
+	}
+
+	VkCommandBuffer Command::transferCommandBuffer()
+	{
+		// the batch of the same ticket acquires what the transfer queue releases
+		batchCommandBuffer();
+
+		if (m_recording_batch.transferCommandBuffer == VK_NULL_HANDLE)
+		{
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = m_transferCommandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+
+			VK_CHECK(
+				vkAllocateCommandBuffers(m_device, &allocInfo, &m_recording_batch.transferCommandBuffer),
+				"Failed to allocate transfer command buffer"
+			);
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+			VK_CHECK(
+				vkBeginCommandBuffer(m_recording_batch.transferCommandBuffer, &beginInfo),
+				"Failed to begin recording transfer command buffer"
+			);
+		}
+
+		return m_recording_batch.transferCommandBuffer;
+	}
+
+	uint64_t Command::flush()
+	{
+		TRACE_ZONE("flush uploads");
+
+		collectCompletedBatches();
+
+		if (m_recording_batch.commandBuffer == VK_NULL_HANDLE)
+		{
+			// nothing recorded, the last submitted batch is the one to wait for
+			return m_next_ticket - 1;
+		}
+
+		VkResult result = vkEndCommandBuffer(m_recording_batch.commandBuffer);
+		if (result != VK_SUCCESS)
+		{
+			TROW("Failed to record command buffer", result);
+		}
+
+		if (m_free_fences.empty())
+		{
+			m_recording_batch.fence = std::make_unique<core::Fence>(m_device, core::Fence::CreateInfo());
+		}
+		else
+		{
+			m_recording_batch.fence = std::move(m_free_fences.back());
+			m_free_fences.pop_back();
+		}
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &m_recording_batch.commandBuffer;
+
+		VkSemaphore transferSemaphore = VK_NULL_HANDLE;
+		VkPipelineStageFlags transferWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		if (m_recording_batch.transferCommandBuffer != VK_NULL_HANDLE)
+		{
+			result = vkEndCommandBuffer(m_recording_batch.transferCommandBuffer);
+			if (result != VK_SUCCESS)
+			{
+				TROW("Failed to record transfer command buffer", result);
+			}
+
+			if (m_free_semaphores.empty())
+			{
+				m_recording_batch.semaphore = std::make_unique<core::Semaphore>(m_device, core::Semaphore::CreateInfo());
+			}
+			else
+			{
+				m_recording_batch.semaphore = std::move(m_free_semaphores.back());
+				m_free_semaphores.pop_back();
+			}
+			transferSemaphore = m_recording_batch.semaphore->getVk();
+
+			VkSubmitInfo transferInfo = {};
+			transferInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			transferInfo.commandBufferCount = 1;
+			transferInfo.pCommandBuffers = &m_recording_batch.transferCommandBuffer;
+			transferInfo.signalSemaphoreCount = 1;
+			transferInfo.pSignalSemaphores = &transferSemaphore;
+
+			result = vkQueueSubmit(m_transferQueue, 1, &transferInfo, VK_NULL_HANDLE);
+			if (result != VK_SUCCESS)
+			{
+				TROW("Failed to submit transfer queue", result);
+			}
+
+			submitInfo.waitSemaphoreCount = 1;
+			submitInfo.pWaitSemaphores = &transferSemaphore;
+			submitInfo.pWaitDstStageMask = &transferWaitStage;
+		}
+
+		submit(1, &submitInfo, m_recording_batch.fence->getVk());
+
+		uint64_t ticket = m_recording_batch.ticket;
+		m_pending_batches.push_back(std::move(m_recording_batch));
+		m_recording_batch = {};
+
+		return ticket;
+	}
+
+	void Command::wait(uint64_t ticket)
+	{
+		if (m_recording_batch.commandBuffer != VK_NULL_HANDLE && ticket >= m_recording_batch.ticket)
+		{
+			flush();
+		}
+
+		for (auto& batch : m_pending_batches)
+		{
+			if (batch.ticket > ticket)
+			{
+				break;
+			}
+			batch.fence->wait();
+		}
+
+		collectCompletedBatches();
+	}
+
+	void Command::waitAll()
+	{
+		wait(flush());
+	}
+
+	bool Command::isComplete(uint64_t ticket)
+	{
+		collectCompletedBatches();
+
+		return ticket <= m_completed_ticket;
+	}
+
+	void Command::keepAlive(Buffer && buffer)
+	{
+		batchCommandBuffer();
+		m_recording_batch.staging_buffers.push_back(std::move(buffer));
+	}
+
+	void Command::collectCompletedBatches()
+	{
+		// batches are released in submission order so m_completed_ticket stays monotonic
+		while (m_pending_batches.empty() == false && m_pending_batches.front().fence->isSignaled())
+		{
+			Batch & batch = m_pending_batches.front();
+
+			freeCommandBuffer(batch.commandBuffer);
+			batch.fence->reset();
+			m_free_fences.push_back(std::move(batch.fence));
+
+			// the batch waited for the semaphore, so it is unsignaled again
+			if (batch.transferCommandBuffer != VK_NULL_HANDLE)
+			{
+				vkFreeCommandBuffers(m_device, m_transferCommandPool, 1, &batch.transferCommandBuffer);
+				m_free_semaphores.push_back(std::move(batch.semaphore));
+			}
+			m_completed_ticket = batch.ticket;
+
+			m_pending_batches.pop_front();
+		}
+	}
+
 	void Command::submit(
 		uint32_t submitCount,
 		const VkSubmitInfo *pSubmits,
@@ -119,6 +362,151 @@ namespace LIB_NAMESPACE
 		}
 	}
 
+	void Command::uploadBuffer(
+		VkBuffer srcBuffer,
+		VkBuffer dstBuffer,
+		uint32_t regionCount,
+		const VkBufferCopy *pRegions
+	)
+	{
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = dstBuffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+
+		if (m_transferQueue == VK_NULL_HANDLE)
+		{
+			VkCommandBuffer commandBuffer = batchCommandBuffer();
+
+			vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, regionCount, pRegions);
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+				0,
+				0, nullptr,
+				1, &barrier,
+				0, nullptr
+			);
+			return;
+		}
+
+		VkCommandBuffer transferCommandBuffer = this->transferCommandBuffer();
+
+		vkCmdCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, regionCount, pRegions);
+
+		barrier.srcQueueFamilyIndex = m_transferQueueFamilyIndex;
+		barrier.dstQueueFamilyIndex = m_queueFamilyIndex;
+
+		// release
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(
+			transferCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			1, &barrier,
+			0, nullptr
+		);
+
+		// acquire
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			batchCommandBuffer(),
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0,
+			0, nullptr,
+			1, &barrier,
+			0, nullptr
+		);
+	}
+
+	void Command::uploadImage(
+		VkBuffer srcBuffer,
+		VkImage dstImage,
+		VkImageAspectFlags aspectMask,
+		uint32_t mipLevels,
+		uint32_t regionCount,
+		const VkBufferImageCopy *pRegions
+	)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = dstImage;
+		barrier.subresourceRange.aspectMask = aspectMask;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = mipLevels;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		VkCommandBuffer commandBuffer = m_transferQueue == VK_NULL_HANDLE ? batchCommandBuffer() : transferCommandBuffer();
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+
+		vkCmdCopyBufferToImage(
+			commandBuffer,
+			srcBuffer,
+			dstImage,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			regionCount,
+			pRegions
+		);
+
+		if (m_transferQueue == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		// the layout stays the same, only the ownership moves
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = m_transferQueueFamilyIndex;
+		barrier.dstQueueFamilyIndex = m_queueFamilyIndex;
+
+		// release
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+
+		// acquire
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			batchCommandBuffer(),
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+	}
+
 	void Command::copyBufferToBuffer(
 		VkBuffer srcBuffer,
 		VkBuffer dstBuffer,
@@ -126,7 +514,7 @@ namespace LIB_NAMESPACE
 		const VkBufferCopy *pRegions
 	)
 	{
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		VkCommandBuffer commandBuffer = batchCommandBuffer();
 
 		vkCmdCopyBuffer(
 			commandBuffer,
@@ -135,8 +523,6 @@ namespace LIB_NAMESPACE
 			regionCount,
 			pRegions
 		);
-
-		endSingleTimeCommands(commandBuffer);
 	}
 
 	void Command::copyBufferToImage(
@@ -147,7 +533,7 @@ namespace LIB_NAMESPACE
 		const VkBufferImageCopy *pRegions
 	)
 	{
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		VkCommandBuffer commandBuffer = batchCommandBuffer();
 
 		vkCmdCopyBufferToImage(
 			commandBuffer,
@@ -157,8 +543,6 @@ namespace LIB_NAMESPACE
 			regionCount,
 			pRegions
 		);
-
-		endSingleTimeCommands(commandBuffer);
 	}
 
 	void Command::copyImageToImage(
@@ -170,7 +554,7 @@ namespace LIB_NAMESPACE
 		const VkImageCopy *pRegions
 	)
 	{
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		VkCommandBuffer commandBuffer = batchCommandBuffer();
 
 		vkCmdCopyImage(
 			commandBuffer,
@@ -181,8 +565,6 @@ namespace LIB_NAMESPACE
 			regionCount,
 			pRegions
 		);
-
-		endSingleTimeCommands(commandBuffer);
 	}
 
 	void Command::transitionImageLayout(
@@ -197,7 +579,7 @@ namespace LIB_NAMESPACE
 		VkPipelineStageFlags dstStageMask
 	)
 	{
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		VkCommandBuffer commandBuffer = batchCommandBuffer();
 
 		VkImageMemoryBarrier barrier{};
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -225,8 +607,6 @@ namespace LIB_NAMESPACE
 			0, nullptr,
 			1, &barrier
 		);
-
-		endSingleTimeCommands(commandBuffer);
 	}
 
 }
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "defines.hpp"
+#include "framework/memory/buffer.hpp"
+#include "core/sync_object.hpp"
 
 #include <vulkan/vulkan.h>
 
 #include <vector>
+#include <deque>
+#include <memory>
 
 namespace LIB_NAMESPACE
 {
@@ -18,6 +22,10 @@ namespace LIB_NAMESPACE
 			VkCommandPoolCreateFlags flags = 0;
 			uint32_t queueFamilyIndex = 0;
 			VkQueue queue = VK_NULL_HANDLE;
+
+			// dedicated transfer queue used by uploadBuffer and uploadImage, none when null
+			uint32_t transferQueueFamilyIndex = 0;
+			VkQueue transferQueue = VK_NULL_HANDLE;
 		};
 
 		Command(VkDevice device, const CreateInfo& createInfo);
@@ -25,10 +33,26 @@ namespace LIB_NAMESPACE
 
 		VkCommandBuffer allocateCommandBuffer(VkCommandBufferLevel level);
 		void freeCommandBuffer(VkCommandBuffer commandBuffer);
+		// recycles every command buffer allocated from this pool at once
+		void resetPool(VkCommandPoolResetFlags flags = 0);
 
 		VkCommandBuffer beginSingleTimeCommands();
 		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
+		// Copies and layout transitions are recorded into a shared batch command buffer
+		// that is only submitted on flush(). Batches are tracked with a fence and
+		// identified by a ticket, so callers only wait when they need the result.
+		VkCommandBuffer batchCommandBuffer();
+		// ticket of the batch recording, resources it uses are released once it is complete
+		uint64_t batchTicket();
+		uint64_t flush();
+		void wait(uint64_t ticket);
+		void waitAll();
+		bool isComplete(uint64_t ticket);
+
+		// keep a staging buffer alive until the batch that reads it has completed
+		void keepAlive(Buffer && buffer);
+
 		void queueWaitIdle();
 
 		void submit(
@@ -37,6 +61,26 @@ namespace LIB_NAMESPACE
 			VkFence fence
 		);
 
+		// Uploads into resources the GPU has not used yet. With a dedicated transfer queue the copies
+		// start right away on it, overlapping the frames in flight, and the resources are then released
+		// to the queue of this Command, whose batch acquires them before any later work.
+		void uploadBuffer(
+			VkBuffer srcBuffer,
+			VkBuffer dstBuffer,
+			uint32_t regionCount,
+			const VkBufferCopy *pRegions
+		);
+
+		// the content of the image is discarded, all its mip levels are left in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+		void uploadImage(
+			VkBuffer srcBuffer,
+			VkImage dstImage,
+			VkImageAspectFlags aspectMask,
+			uint32_t mipLevels,
+			uint32_t regionCount,
+			const VkBufferImageCopy *pRegions
+		);
+
 		void copyBufferToBuffer(
 			VkBuffer srcBuffer,
 			VkBuffer dstBuffer,
@@ -75,12 +119,38 @@ namespace LIB_NAMESPACE
 
 	private:
 
+		struct Batch
+		{
+			uint64_t ticket;
+			VkCommandBuffer commandBuffer;
+			std::unique_ptr<core::Fence> fence;
+			std::vector<Buffer> staging_buffers;
+
+			// submitted to the transfer queue first, commandBuffer waits for the semaphore
+			VkCommandBuffer transferCommandBuffer;
+			std::unique_ptr<core::Semaphore> semaphore;
+		};
+
 		VkCommandPool m_commandPool;
+		VkCommandPool m_transferCommandPool = VK_NULL_HANDLE;
 
 		VkDevice m_device;
 		VkQueue m_queue;
+		uint32_t m_queueFamilyIndex;
+		VkQueue m_transferQueue;
+		uint32_t m_transferQueueFamilyIndex;
+
+		Batch m_recording_batch = {};
+		std::deque<Batch> m_pending_batches;
+		std::vector<std::unique_ptr<core::Fence>> m_free_fences;
+		std::vector<std::unique_ptr<core::Semaphore>> m_free_semaphores;
+
+		uint64_t m_next_ticket = 1;
+		uint64_t m_completed_ticket = 0;
 
 		void createCommandPool(const CreateInfo& createInfo);
+		VkCommandBuffer transferCommandBuffer();
+		void collectCompletedBatches();
 	
 	};
 }
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "bindless_texture_table.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	BindlessTextureTable::BindlessTextureTable(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		uint32_t capacity,
+		VkShaderStageFlags stages
+	):
+		m_device(device),
+		m_stages(stages)
+	{
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+		indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 properties = {};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+		auto perStage = [](uint32_t limit)
+		{
+			return limit > 2 * reserved_per_stage ? limit - reserved_per_stage : limit / 2;
+		};
+
+		// a combined image sampler counts as a sampler and as a sampled image
+		m_capacity = std::min({
+			capacity,
+			perStage(indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers),
+			perStage(indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages),
+			perStage(indexingProperties.maxPerStageUpdateAfterBindResources),
+			indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages
+		});
+		if (m_capacity == 0)
+		{
+			throw std::runtime_error("failed to create bindless texture table: the device allows no update after bind samplers");
+		}
+
+		VkDescriptorSetLayoutBinding binding = {};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = m_capacity;
+		binding.stageFlags = m_stages;
+
+		VkDescriptorBindingFlags bindingFlags =
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+		bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		bindingFlagsInfo.bindingCount = 1;
+		bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.pNext = &bindingFlagsInfo;
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+
+		m_layout = std::make_unique<core::DescriptorSetLayout>(m_device, layoutInfo);
+
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSize.descriptorCount = m_capacity;
+
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+
+		m_pool = std::make_unique<core::DescriptorPool>(m_device, poolInfo);
+
+		VkDescriptorSetLayout vkLayout = m_layout->getVk();
+
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_pool->getVk();
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &vkLayout;
+
+		VK_CHECK(
+			vkAllocateDescriptorSets(m_device, &allocInfo, &m_set),
+			"failed to allocate bindless texture set"
+		);
+	}
+
+	BindlessTextureTable::~BindlessTextureTable()
+	{
+		// the set is freed with the pool
+	}
+
+	uint32_t BindlessTextureTable::add(VkImageView view, VkSampler sampler)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		uint32_t index;
+		if (m_free_indices.empty() == false)
+		{
+			index = m_free_indices.back();
+			m_free_indices.pop_back();
+		}
+		else if (m_next_index < m_capacity)
+		{
+			index = m_next_index++;
+		}
+		else
+		{
+			throw std::runtime_error("failed to add texture: bindless texture table is full");
+		}
+
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = view;
+		imageInfo.sampler = sampler;
+
+		VkWriteDescriptorSet write = {};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = m_set;
+		write.dstBinding = 0;
+		write.dstArrayElement = index;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.descriptorCount = 1;
+		write.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+		return index;
+	}
+
+	void BindlessTextureTable::remove(uint32_t index)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// the element keeps its old descriptor, partially bound allows it as long as no shader reads it
+		m_free_indices.push_back(index);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "defines.hpp"
+#include "core/pipeline/descriptor_layout.hpp"
+#include "core/pipeline/descriptor_pool.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// One descriptor set holding every texture in a single combined image sampler array,
+	// so a draw selects its texture with an index instead of binding a set.
+	// In GLSL: layout(set = N, binding = 0) uniform sampler2D textures[];
+	// indexed with nonuniformEXT when the index is not uniform across the draw.
+	// The array is partially bound and updated after bind, adding a texture while frames
+	// reading other elements are in flight is valid.
+	class BindlessTextureTable
+	{
+
+	public:
+
+		static constexpr uint32_t default_capacity = 16384;
+		static constexpr VkShaderStageFlags default_stages = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		// per stage descriptors left to the other sets of the pipeline layouts using the table,
+		// the per stage limits count the descriptors of every set of a pipeline layout
+		static constexpr uint32_t reserved_per_stage = 64;
+
+		// Capped by the update after bind limits of the device, per set and per stage.
+		// Only the given stages may index the array.
+		BindlessTextureTable(
+			VkDevice device,
+			VkPhysicalDevice physicalDevice,
+			uint32_t capacity = default_capacity,
+			VkShaderStageFlags stages = default_stages
+		);
+		BindlessTextureTable(const BindlessTextureTable &) = delete;
+		BindlessTextureTable(BindlessTextureTable && other) = delete;
+		BindlessTextureTable & operator=(const BindlessTextureTable &) = delete;
+		BindlessTextureTable & operator=(BindlessTextureTable && other) = delete;
+		~BindlessTextureTable();
+
+		// index of the texture in the array, throws when it is full
+		uint32_t add(VkImageView view, VkSampler sampler);
+		// no frame in flight may still read the index, it is given to the next texture added
+		void remove(uint32_t index);
+
+		VkDescriptorSetLayout layout() const { return m_layout->getVk(); }
+		VkDescriptorSet set() const { return m_set; }
+
+		uint32_t capacity() const { return m_capacity; }
+		VkShaderStageFlags stages() const { return m_stages; }
+
+	private:
+
+		VkDevice m_device;
+
+		uint32_t m_capacity;
+		VkShaderStageFlags m_stages;
+		std::unique_ptr<core::DescriptorSetLayout> m_layout;
+		std::unique_ptr<core::DescriptorPool> m_pool;
+		VkDescriptorSet m_set;
+
+		uint32_t m_next_index = 0;
+		std::vector<uint32_t> m_free_indices;
+		std::mutex m_mutex;
+
+	};
+}
@@ -0,0 +1,330 @@
+#include "compressed_texture.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	namespace
+	{
+		const unsigned char ktx2_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+		struct Ktx2Header
+		{
+			uint32_t vk_format;
+			uint32_t type_size;
+			uint32_t pixel_width;
+			uint32_t pixel_height;
+			uint32_t pixel_depth;
+			uint32_t layer_count;
+			uint32_t face_count;
+			uint32_t level_count;
+			uint32_t supercompression_scheme;
+
+			uint32_t dfd_byte_offset;
+			uint32_t dfd_byte_length;
+			uint32_t kvd_byte_offset;
+			uint32_t kvd_byte_length;
+			// followed by the 64 bits offset and length of the supercompression global data
+		};
+
+		constexpr size_t ktx2_level_index_offset = 80;
+
+		struct Ktx2Level
+		{
+			uint64_t byte_offset;
+			uint64_t byte_length;
+			uint64_t uncompressed_byte_length;
+		};
+
+		struct DdsPixelFormat
+		{
+			uint32_t size;
+			uint32_t flags;
+			uint32_t four_cc;
+			uint32_t rgb_bit_count;
+			uint32_t bit_masks[4];
+		};
+
+		struct DdsHeader
+		{
+			uint32_t size;
+			uint32_t flags;
+			uint32_t height;
+			uint32_t width;
+			uint32_t pitch_or_linear_size;
+			uint32_t depth;
+			uint32_t mip_map_count;
+			uint32_t reserved1[11];
+			DdsPixelFormat pixel_format;
+			uint32_t caps[4];
+			uint32_t reserved2;
+		};
+
+		struct DdsHeaderDx10
+		{
+			uint32_t dxgi_format;
+			uint32_t resource_dimension;
+			uint32_t misc_flag;
+			uint32_t array_size;
+			uint32_t misc_flags2;
+		};
+
+		constexpr uint32_t dds_magic = 0x20534444; // "DDS "
+		constexpr uint32_t dds_mipmap_count_flag = 0x20000;
+		constexpr uint32_t dds_four_cc_flag = 0x4;
+		constexpr uint32_t dds_resource_dimension_texture2d = 3;
+		constexpr uint32_t dds_cubemap_flag = 0x4;
+
+		constexpr uint32_t fourCC(char a, char b, char c, char d)
+		{
+			return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16 | static_cast<uint32_t>(d) << 24;
+		}
+
+		VkFormat dxgiFormat(uint32_t dxgi_format)
+		{
+			switch (dxgi_format)
+			{
+				case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+				case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+				case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+				case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+				case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+				case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+				case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+				case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+				case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+				case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+				case 95: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+				case 96: return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+				case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+				case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+				default: return VK_FORMAT_UNDEFINED;
+			}
+		}
+
+		bool hasExtension(const std::string & filepath, const std::string & extension)
+		{
+			if (filepath.size() < extension.size())
+			{
+				return false;
+			}
+			return std::equal(extension.rbegin(), extension.rend(), filepath.rbegin(), [](char a, char b)
+			{
+				return a == std::tolower(static_cast<unsigned char>(b));
+			});
+		}
+	}
+
+	CompressedTexture::CompressedTexture(const std::string & filepath, bool srgb):
+		m_file(filepath),
+		m_filepath(filepath)
+	{
+		if (m_file.size() >= sizeof(ktx2_identifier) && std::memcmp(m_file.data(), ktx2_identifier, sizeof(ktx2_identifier)) == 0)
+		{
+			parseKtx2();
+		}
+		else if (m_file.size() >= sizeof(uint32_t) && std::memcmp(m_file.data(), &dds_magic, sizeof(uint32_t)) == 0)
+		{
+			parseDds(srgb);
+		}
+		else
+		{
+			throw std::runtime_error("failed to load texture, not a KTX2 or DDS file: " + filepath);
+		}
+	}
+
+	bool CompressedTexture::isCompressedFile(const std::string & filepath)
+	{
+		return hasExtension(filepath, ".ktx2") || hasExtension(filepath, ".dds");
+	}
+
+	CompressedTexture::BlockInfo CompressedTexture::blockInfo(VkFormat format)
+	{
+		switch (format)
+		{
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			case VK_FORMAT_BC4_UNORM_BLOCK:
+			case VK_FORMAT_BC4_SNORM_BLOCK:
+				return { 4, 4, 8 };
+			case VK_FORMAT_BC2_UNORM_BLOCK:
+			case VK_FORMAT_BC2_SRGB_BLOCK:
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK:
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+			case VK_FORMAT_BC5_SNORM_BLOCK:
+			case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+			case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+				return { 4, 4, 16 };
+			default:
+				break;
+		}
+
+		// every ASTC LDR format is a 16 bytes block, UNORM and sRGB variants are next to each other
+		static const BlockInfo astc_blocks[] = {
+			{ 4, 4, 16 }, { 5, 4, 16 }, { 5, 5, 16 }, { 6, 5, 16 }, { 6, 6, 16 }, { 8, 5, 16 }, { 8, 6, 16 },
+			{ 8, 8, 16 }, { 10, 5, 16 }, { 10, 6, 16 }, { 10, 8, 16 }, { 10, 10, 16 }, { 12, 10, 16 }, { 12, 12, 16 }
+		};
+		if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+		{
+			return astc_blocks[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+		}
+
+		return { 1, 1, 0 };
+	}
+
+	VkDeviceSize CompressedTexture::levelSize(VkFormat format, uint32_t width, uint32_t height)
+	{
+		BlockInfo block = blockInfo(format);
+		VkDeviceSize blocksX = (width + block.width - 1) / block.width;
+		VkDeviceSize blocksY = (height + block.height - 1) / block.height;
+		return blocksX * blocksY * block.bytes;
+	}
+
+	VkDeviceSize CompressedTexture::size() const
+	{
+		VkDeviceSize size = 0;
+		for (auto& level : m_levels)
+		{
+			size += level.size;
+		}
+		return size;
+	}
+
+	void CompressedTexture::parseKtx2()
+	{
+		Ktx2Header header;
+		if (m_file.size() < ktx2_level_index_offset)
+		{
+			throw std::runtime_error("failed to load texture, truncated KTX2 header: " + m_filepath);
+		}
+		std::memcpy(&header, m_file.data() + sizeof(ktx2_identifier), sizeof(header));
+
+		if (header.supercompression_scheme != 0)
+		{
+			throw std::runtime_error("failed to load texture, KTX2 supercompression is not supported: " + m_filepath);
+		}
+		if (header.pixel_depth > 1 || header.layer_count > 1 || header.face_count != 1)
+		{
+			throw std::runtime_error("failed to load texture, only single 2D KTX2 images are supported: " + m_filepath);
+		}
+
+		m_format = static_cast<VkFormat>(header.vk_format);
+		m_width = header.pixel_width;
+		m_height = std::max(header.pixel_height, 1u);
+		if (blockInfo(m_format).bytes == 0)
+		{
+			throw std::runtime_error("failed to load texture, KTX2 format is not block-compressed: " + m_filepath);
+		}
+
+		// a level count of 0 asks the loader to generate the mips, block-compressed levels can not be
+		uint32_t levelCount = std::max(header.level_count, 1u);
+		size_t indexOffset = ktx2_level_index_offset;
+		if (m_file.size() < indexOffset + levelCount * sizeof(Ktx2Level))
+		{
+			throw std::runtime_error("failed to load texture, truncated KTX2 level index: " + m_filepath);
+		}
+
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			Ktx2Level level;
+			std::memcpy(&level, m_file.data() + indexOffset + i * sizeof(Ktx2Level), sizeof(level));
+			addLevel(static_cast<size_t>(level.byte_offset), level.byte_length);
+		}
+	}
+
+	void CompressedTexture::parseDds(bool srgb)
+	{
+		DdsHeader header;
+		size_t offset = sizeof(dds_magic);
+		if (m_file.size() < offset + sizeof(header))
+		{
+			throw std::runtime_error("failed to load texture, truncated DDS header: " + m_filepath);
+		}
+		std::memcpy(&header, m_file.data() + offset, sizeof(header));
+		offset += sizeof(header);
+
+		if ((header.pixel_format.flags & dds_four_cc_flag) == 0)
+		{
+			throw std::runtime_error("failed to load texture, DDS file is not block-compressed: " + m_filepath);
+		}
+
+		switch (header.pixel_format.four_cc)
+		{
+			case fourCC('D', 'X', 'T', '1'): m_format = srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK; break;
+			case fourCC('D', 'X', 'T', '3'): m_format = srgb ? VK_FORMAT_BC2_SRGB_BLOCK : VK_FORMAT_BC2_UNORM_BLOCK; break;
+			case fourCC('D', 'X', 'T', '5'): m_format = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK; break;
+			case fourCC('A', 'T', 'I', '1'):
+			case fourCC('B', 'C', '4', 'U'): m_format = VK_FORMAT_BC4_UNORM_BLOCK; break;
+			case fourCC('A', 'T', 'I', '2'):
+			case fourCC('B', 'C', '5', 'U'): m_format = VK_FORMAT_BC5_UNORM_BLOCK; break;
+			case fourCC('D', 'X', '1', '0'):
+			{
+				DdsHeaderDx10 header10;
+				if (m_file.size() < offset + sizeof(header10))
+				{
+					throw std::runtime_error("failed to load texture, truncated DDS header: " + m_filepath);
+				}
+				std::memcpy(&header10, m_file.data() + offset, sizeof(header10));
+				offset += sizeof(header10);
+
+				if (header10.resource_dimension != dds_resource_dimension_texture2d ||
+					header10.array_size > 1 ||
+					(header10.misc_flag & dds_cubemap_flag))
+				{
+					throw std::runtime_error("failed to load texture, only single 2D DDS images are supported: " + m_filepath);
+				}
+				m_format = dxgiFormat(header10.dxgi_format);
+				break;
+			}
+			default:
+				break;
+		}
+
+		if (m_format == VK_FORMAT_UNDEFINED)
+		{
+			throw std::runtime_error("failed to load texture, unsupported DDS format: " + m_filepath);
+		}
+
+		m_width = header.width;
+		m_height = header.height;
+
+		// the levels follow the header, largest first
+		uint32_t levelCount = (header.flags & dds_mipmap_count_flag) ? std::max(header.mip_map_count, 1u) : 1;
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			VkDeviceSize size = levelSize(m_format, std::max(m_width >> i, 1u), std::max(m_height >> i, 1u));
+			addLevel(offset, size);
+			offset += static_cast<size_t>(size);
+		}
+	}
+
+	void CompressedTexture::addLevel(size_t offset, VkDeviceSize size)
+	{
+		uint32_t index = static_cast<uint32_t>(m_levels.size());
+		if (m_width == 0 || ((m_width >> index) == 0 && (m_height >> index) == 0))
+		{
+			throw std::runtime_error("failed to load texture, invalid mip chain: " + m_filepath);
+		}
+
+		Level level;
+		level.width = std::max(m_width >> index, 1u);
+		level.height = std::max(m_height >> index, 1u);
+		level.size = levelSize(m_format, level.width, level.height);
+
+		if (size < level.size || offset > m_file.size() || level.size > m_file.size() - offset)
+		{
+			throw std::runtime_error("failed to load texture, truncated mip level: " + m_filepath);
+		}
+
+		level.data = reinterpret_cast<const unsigned char *>(m_file.data()) + offset;
+		m_levels.push_back(level);
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "defines.hpp"
+#include "framework/object/mapped_file.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// Block-compressed texture read from a KTX2 or DDS file with the mip levels it stores.
+	// The file is mapped and the levels are copied straight from it into the staging buffer.
+	// Supported: BC1 to BC7 and ASTC LDR, single 2D image, no supercompression.
+	class CompressedTexture
+	{
+
+	public:
+
+		struct Level
+		{
+			const unsigned char *data;
+			VkDeviceSize size;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		struct BlockInfo
+		{
+			uint32_t width;
+			uint32_t height;
+			uint32_t bytes;
+		};
+
+		// srgb picks the sRGB variant of the legacy DDS formats, whose header does not tell
+		CompressedTexture(const std::string & filepath, bool srgb);
+		CompressedTexture(const CompressedTexture &) = delete;
+		CompressedTexture(CompressedTexture && other) = default;
+		CompressedTexture & operator=(const CompressedTexture &) = delete;
+		CompressedTexture & operator=(CompressedTexture && other) = delete;
+
+		// by extension, .ktx2 or .dds
+		static bool isCompressedFile(const std::string & filepath);
+		// zero bytes for a format that is not block-compressed
+		static BlockInfo blockInfo(VkFormat format);
+		static VkDeviceSize levelSize(VkFormat format, uint32_t width, uint32_t height);
+
+		VkFormat format() const { return m_format; }
+		uint32_t width() const { return m_width; }
+		uint32_t height() const { return m_height; }
+		const std::vector<Level> & levels() const { return m_levels; }
+		// bytes of every level
+		VkDeviceSize size() const;
+
+	private:
+
+		MappedFile m_file;
+		std::string m_filepath;
+
+		VkFormat m_format = VK_FORMAT_UNDEFINED;
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+		// level 0 first
+		std::vector<Level> m_levels;
+
+		void parseKtx2();
+		void parseDds(bool srgb);
+
+		// checks the level fits in the file and holds every block of its size
+		void addLevel(size_t offset, VkDeviceSize size);
+
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "defines.hpp"
+#include "framework/descriptor/descriptor_allocator.hpp"
 
 #include <vulkan/vulkan.h>
 
@@ -9,6 +10,8 @@
 
 namespace LIB_NAMESPACE
 {
+	// Sets allocated from the device DescriptorAllocator, the layout is shared with
+	// every descriptor and pipeline using the same bindings and owned by the allocator.
 	class Descriptor
 	{
 
@@ -20,29 +23,28 @@ namespace LIB_NAMESPACE
 			uint32_t descriptor_count;
 		};
 
-		Descriptor(VkDevice device, const CreateInfo & create_info);
+		Descriptor(DescriptorAllocator & allocator, const CreateInfo & create_info);
 		Descriptor(const Descriptor & other) = delete;
 		Descriptor(Descriptor && other);
 		Descriptor & operator=(const Descriptor & other) = delete;
 		Descriptor & operator=(Descriptor && other) = delete;
 		~Descriptor();
 
-		VkDescriptorPool pool() { return m_pool; }
 		VkDescriptorSetLayout layout() { return m_layout; }
-		VkDescriptorSet set(uint32_t index) { return m_sets.at(index); }
-		VkDescriptorSet* pSet(uint32_t index) { return &m_sets.at(index); }
+		// a descriptor with a single set returns it for every index, so it can be bound for any frame
+		VkDescriptorSet set(uint32_t index) { return m_sets.at(m_sets.size() == 1 ? 0 : index); }
+		VkDescriptorSet* pSet(uint32_t index) { return &m_sets.at(m_sets.size() == 1 ? 0 : index); }
+		uint32_t setCount() const { return static_cast<uint32_t>(m_sets.size()); }
 	
 	private:
 
-		VkDescriptorPool m_pool;
+		DescriptorAllocator *m_allocator;
+
 		VkDescriptorSetLayout m_layout;
+		std::vector<DescriptorAllocator::Allocation> m_allocations;
 		std::vector<VkDescriptorSet> m_sets;
 
-		VkDevice m_device;
-
-		void createPool(const CreateInfo & create_info);
-		void createLayout(const CreateInfo & create_info);
-		void createSets(const CreateInfo & create_info);
+		void free();
 
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,298 @@
+#include "descriptor_allocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	namespace
+	{
+		const uint32_t first_pool_max_sets = 64;
+		const uint32_t last_pool_max_sets = 4096;
+
+		// descriptors of each type per set, a pool only runs out of a type the sets use more than this
+		const std::pair<VkDescriptorType, float> pool_ratios[] = {
+			{ VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 0.5f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 0.5f },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f }
+		};
+
+		bool sameBinding(const VkDescriptorSetLayoutBinding & a, const VkDescriptorSetLayoutBinding & b)
+		{
+			return a.binding == b.binding
+				&& a.descriptorType == b.descriptorType
+				&& a.descriptorCount == b.descriptorCount
+				&& a.stageFlags == b.stageFlags
+				&& a.pImmutableSamplers == b.pImmutableSamplers;
+		}
+
+		uint64_t hashBindings(const std::vector<VkDescriptorSetLayoutBinding> & bindings)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			auto mix = [&hash](uint64_t value)
+			{
+				hash ^= value;
+				hash *= 1099511628211ull;
+			};
+
+			for (auto& binding : bindings)
+			{
+				mix(binding.binding);
+				mix(binding.descriptorType);
+				mix(binding.descriptorCount);
+				mix(binding.stageFlags);
+				mix(reinterpret_cast<uintptr_t>(binding.pImmutableSamplers));
+			}
+			return hash;
+		}
+	}
+
+	DescriptorAllocator::DescriptorAllocator(VkDevice device):
+		m_device(device)
+	{
+		m_pools.next_max_sets = first_pool_max_sets;
+		for (auto& frame_pools : m_frame_pools)
+		{
+			frame_pools.next_max_sets = first_pool_max_sets;
+		}
+	}
+
+	DescriptorAllocator::~DescriptorAllocator()
+	{
+		for (auto& pool : m_pools.pools)
+		{
+			vkDestroyDescriptorPool(m_device, pool, nullptr);
+		}
+		for (auto& frame_pools : m_frame_pools)
+		{
+			for (auto& pool : frame_pools.pools)
+			{
+				vkDestroyDescriptorPool(m_device, pool, nullptr);
+			}
+		}
+		for (auto& bucket : m_layouts)
+		{
+			for (auto& layout : bucket.second)
+			{
+				vkDestroyDescriptorSetLayout(m_device, layout.layout, nullptr);
+			}
+		}
+	}
+
+	VkDescriptorSetLayout DescriptorAllocator::layout(const std::vector<VkDescriptorSetLayoutBinding> & bindings)
+	{
+		std::vector<VkDescriptorSetLayoutBinding> sorted = bindings;
+		std::sort(sorted.begin(), sorted.end(), [](const VkDescriptorSetLayoutBinding & a, const VkDescriptorSetLayoutBinding & b)
+		{
+			return a.binding < b.binding;
+		});
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		auto& bucket = m_layouts[hashBindings(sorted)];
+		for (auto& layout : bucket)
+		{
+			if (std::equal(sorted.begin(), sorted.end(), layout.bindings.begin(), layout.bindings.end(), sameBinding))
+			{
+				return layout.layout;
+			}
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(sorted.size());
+		layoutInfo.pBindings = sorted.data();
+
+		VkDescriptorSetLayout layout;
+		VK_CHECK(
+			vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &layout),
+			"failed to create descriptor set layout"
+		);
+
+		std::vector<VkDescriptorPoolSize> & sizes = m_layout_sizes[layout];
+		for (auto& binding : sorted)
+		{
+			auto size = std::find_if(sizes.begin(), sizes.end(), [&binding](const VkDescriptorPoolSize & size)
+			{
+				return size.type == binding.descriptorType;
+			});
+			if (size == sizes.end())
+			{
+				sizes.push_back({ binding.descriptorType, binding.descriptorCount });
+			}
+			else
+			{
+				size->descriptorCount += binding.descriptorCount;
+			}
+		}
+
+		bucket.push_back(Layout{ std::move(sorted), layout });
+		m_layout_count++;
+
+		return layout;
+	}
+
+	DescriptorAllocator::Allocation DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		Allocation allocation = allocateFrom(m_pools, layout, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+		m_set_count++;
+
+		return allocation;
+	}
+
+	void DescriptorAllocator::free(const Allocation & allocation)
+	{
+		if (allocation.set == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		vkFreeDescriptorSets(m_device, allocation.pool, 1, &allocation.set);
+		m_set_count--;
+
+		// the pool has room again, try it first next time
+		auto it = std::find(m_pools.pools.begin(), m_pools.pools.end(), allocation.pool);
+		m_pools.current = std::min(m_pools.current, static_cast<size_t>(it - m_pools.pools.begin()));
+	}
+
+	VkDescriptorSet DescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout, uint32_t frame)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		return allocateFrom(m_frame_pools.at(frame), layout, 0).set;
+	}
+
+	void DescriptorAllocator::resetFrame(uint32_t frame)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		PoolList & frame_pools = m_frame_pools.at(frame);
+		// pools after current were never allocated from since the last reset
+		for (size_t i = 0; i <= frame_pools.current && i < frame_pools.pools.size(); i++)
+		{
+			vkResetDescriptorPool(m_device, frame_pools.pools[i], 0);
+		}
+		frame_pools.current = 0;
+	}
+
+	DescriptorAllocator::Stats DescriptorAllocator::stats()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		Stats stats;
+		stats.layout_count = m_layout_count;
+		stats.pool_count = static_cast<uint32_t>(m_pools.pools.size());
+		for (auto& frame_pools : m_frame_pools)
+		{
+			stats.transient_pool_count += static_cast<uint32_t>(frame_pools.pools.size());
+		}
+		stats.set_count = m_set_count;
+		return stats;
+	}
+
+	VkDescriptorPool DescriptorAllocator::createPool(PoolList & list, VkDescriptorSetLayout layout, VkDescriptorPoolCreateFlags flags)
+	{
+		uint32_t max_sets = list.next_max_sets;
+		list.next_max_sets = std::min(max_sets * 2, last_pool_max_sets);
+
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (auto& ratio : pool_ratios)
+		{
+			poolSizes.push_back({ ratio.first, static_cast<uint32_t>(ratio.second * max_sets) });
+		}
+
+		// enough for max_sets sets of the layout that did not fit, even with types or counts above the ratios
+		auto layout_sizes = m_layout_sizes.find(layout);
+		if (layout_sizes != m_layout_sizes.end())
+		{
+			for (auto& layout_size : layout_sizes->second)
+			{
+				auto size = std::find_if(poolSizes.begin(), poolSizes.end(), [&layout_size](const VkDescriptorPoolSize & size)
+				{
+					return size.type == layout_size.type;
+				});
+				if (size == poolSizes.end())
+				{
+					poolSizes.push_back({ layout_size.type, layout_size.descriptorCount * max_sets });
+				}
+				else
+				{
+					size->descriptorCount = std::max(size->descriptorCount, layout_size.descriptorCount * max_sets);
+				}
+			}
+		}
+
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = flags;
+		poolInfo.maxSets = max_sets;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+
+		VkDescriptorPool pool;
+		VK_CHECK(
+			vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &pool),
+			"failed to create descriptor pool"
+		);
+
+		return pool;
+	}
+
+	DescriptorAllocator::Allocation DescriptorAllocator::allocateFrom(
+		PoolList & list,
+		VkDescriptorSetLayout layout,
+		VkDescriptorPoolCreateFlags flags
+	)
+	{
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		Allocation allocation;
+
+		for (; list.current < list.pools.size(); list.current++)
+		{
+			allocInfo.descriptorPool = list.pools[list.current];
+
+			VkResult result = vkAllocateDescriptorSets(m_device, &allocInfo, &allocation.set);
+			if (result == VK_SUCCESS)
+			{
+				allocation.pool = allocInfo.descriptorPool;
+				return allocation;
+			}
+			if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+			{
+				TROW("failed to allocate descriptor set", result)
+			}
+		}
+
+		// every pool is full, the new one is only kept when the set fits in it
+		allocInfo.descriptorPool = createPool(list, layout, flags);
+
+		VkResult result = vkAllocateDescriptorSets(m_device, &allocInfo, &allocation.set);
+		if (result != VK_SUCCESS)
+		{
+			vkDestroyDescriptorPool(m_device, allocInfo.descriptorPool, nullptr);
+			TROW("failed to allocate descriptor set", result)
+		}
+
+		list.pools.push_back(allocInfo.descriptorPool);
+		list.current = list.pools.size() - 1;
+
+		allocation.pool = allocInfo.descriptorPool;
+		return allocation;
+	}
+}
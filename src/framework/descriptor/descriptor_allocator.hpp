@@ -0,0 +1,92 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// Device-wide descriptor set layouts and pools.
+	// Layouts are cached by their bindings, so descriptors and pipelines with the same bindings share one.
+	// Sets come from pools shared by every descriptor, a new pool twice as large as the last one
+	// is created when they are all full, instead of one pool per descriptor.
+	// Transient sets come from per frame pools reset as a whole when the frame in flight is reused.
+	class DescriptorAllocator
+	{
+
+	public:
+
+		struct Allocation
+		{
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			VkDescriptorPool pool = VK_NULL_HANDLE;
+		};
+
+		struct Stats
+		{
+			uint32_t layout_count = 0;
+			uint32_t pool_count = 0;
+			uint32_t transient_pool_count = 0;
+			uint32_t set_count = 0;
+		};
+
+		DescriptorAllocator(VkDevice device);
+		DescriptorAllocator(const DescriptorAllocator &) = delete;
+		DescriptorAllocator(DescriptorAllocator && other) = delete;
+		DescriptorAllocator & operator=(const DescriptorAllocator &) = delete;
+		DescriptorAllocator & operator=(DescriptorAllocator && other) = delete;
+		~DescriptorAllocator();
+
+		// owned by the allocator, the order of the bindings does not matter
+		VkDescriptorSetLayout layout(const std::vector<VkDescriptorSetLayoutBinding> & bindings);
+
+		// kept until freed
+		Allocation allocate(VkDescriptorSetLayout layout);
+		void free(const Allocation & allocation);
+
+		// valid until resetFrame is called for the same frame
+		VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout, uint32_t frame);
+		// the frame must not be in flight anymore
+		void resetFrame(uint32_t frame);
+
+		Stats stats();
+
+	private:
+
+		struct Layout
+		{
+			std::vector<VkDescriptorSetLayoutBinding> bindings;
+			VkDescriptorSetLayout layout;
+		};
+
+		struct PoolList
+		{
+			std::vector<VkDescriptorPool> pools;
+			// first pool sets are allocated from, the ones before are full
+			size_t current = 0;
+			uint32_t next_max_sets;
+		};
+
+		VkDevice m_device;
+
+		std::unordered_map<uint64_t, std::vector<Layout>> m_layouts;
+		uint32_t m_layout_count = 0;
+		// descriptors of each type in one set of a layout, a new pool has room for its sets
+		std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorPoolSize>> m_layout_sizes;
+
+		PoolList m_pools;
+		std::array<PoolList, MAX_FRAMES_IN_FLIGHT> m_frame_pools;
+		uint32_t m_set_count = 0;
+
+		std::mutex m_mutex;
+
+		VkDescriptorPool createPool(PoolList & list, VkDescriptorSetLayout layout, VkDescriptorPoolCreateFlags flags);
+		Allocation allocateFrom(PoolList & list, VkDescriptorSetLayout layout, VkDescriptorPoolCreateFlags flags);
+
+	};
+}
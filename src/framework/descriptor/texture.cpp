@@ -4,24 +4,164 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
+#include <vector>
 
 namespace LIB_NAMESPACE
 {
+	namespace
+	{
+		bool isSrgb(VkFormat format)
+		{
+			return MipmapGenerator::storageFormat(format) != format;
+		}
+	}
+
 	Texture::Texture(
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
 		Command& command,
+		DescriptorAllocator& descriptorAllocator,
+		BindlessTextureTable* textureTable,
+		MipmapGenerator& mipmapGenerator,
 		CreateInfo& createInfo
-	)
+	):
+		m_texture_table(textureTable)
+	{
+		const CompressedTexture* compressed = createInfo.compressed;
+		std::unique_ptr<CompressedTexture> loadedCompressed;
+
+		if (compressed == nullptr && createInfo.pixels == nullptr && CompressedTexture::isCompressedFile(createInfo.filepath))
+		{
+			loadedCompressed = std::make_unique<CompressedTexture>(createInfo.filepath, isSrgb(createInfo.format));
+			compressed = loadedCompressed.get();
+		}
+
+		if (compressed != nullptr)
+		{
+			uploadCompressed(device, physicalDevice, command, mipmapGenerator, *compressed, createInfo);
+		}
+		else
+		{
+			uploadPixels(device, physicalDevice, command, mipmapGenerator, createInfo);
+		}
+
+		createSampler(device, physicalDevice);
+		createDescriptor(device, descriptorAllocator, createInfo);
+
+		if (m_texture_table != nullptr)
+		{
+			m_bindless_index = m_texture_table->add(m_image->view(), m_sampler->getVk());
+		}
+	}
+
+	Texture::Texture(Texture&& other):
+		m_image(std::move(other.m_image)),
+		m_sampler(std::move(other.m_sampler)),
+		m_descriptor(std::move(other.m_descriptor)),
+		m_texture_table(other.m_texture_table),
+		m_bindless_index(other.m_bindless_index),
+		m_width(other.m_width),
+		m_height(other.m_height),
+		m_mip_levels(other.m_mip_levels)
+	{
+		other.m_bindless_index = no_index;
+	}
+
+	Texture::~Texture()
 	{
+		if (m_bindless_index != no_index)
+		{
+			m_texture_table->remove(m_bindless_index);
+		}
+	}
+
+	Texture::Pixels Texture::decode(const std::string & filepath, VkFormat format)
+	{
+		Pixels pixels;
+		if (CompressedTexture::isCompressedFile(filepath))
+		{
+			pixels.compressed = std::make_unique<CompressedTexture>(filepath, isSrgb(format));
+			pixels.width = static_cast<int>(pixels.compressed->width());
+			pixels.height = static_cast<int>(pixels.compressed->height());
+			return pixels;
+		}
+
 		int texChannels;
-		stbi_uc* pixels = stbi_load(createInfo.filepath.c_str(), &m_width, &m_height, &texChannels, STBI_rgb_alpha);
-		VkDeviceSize imageSize = m_width * m_height * 4;
+		pixels.data = std::unique_ptr<unsigned char, void (*)(void *)>(
+			stbi_load(filepath.c_str(), &pixels.width, &pixels.height, &texChannels, STBI_rgb_alpha),
+			stbi_image_free
+		);
 
-		if (pixels == nullptr)
+		if (pixels.data == nullptr)
 		{
-			throw std::runtime_error("failed to load texture: " + createInfo.filepath);
+			throw std::runtime_error("failed to load texture: " + filepath);
+		}
+		return pixels;
+	}
+
+	void Texture::swap(Texture & other)
+	{
+		std::swap(m_image, other.m_image);
+		std::swap(m_sampler, other.m_sampler);
+		std::swap(m_descriptor, other.m_descriptor);
+		std::swap(m_texture_table, other.m_texture_table);
+		std::swap(m_bindless_index, other.m_bindless_index);
+		std::swap(m_width, other.m_width);
+		std::swap(m_height, other.m_height);
+		std::swap(m_mip_levels, other.m_mip_levels);
+	}
+
+	void Texture::uploadPixels(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		Command& command,
+		MipmapGenerator& mipmapGenerator,
+		CreateInfo& createInfo
+	)
+	{
+		const stbi_uc* pixels = createInfo.pixels;
+		Pixels loadedPixels;
+
+		if (pixels != nullptr)
+		{
+			m_width = createInfo.width;
+			m_height = createInfo.height;
+		}
+		else
+		{
+			loadedPixels = decode(createInfo.filepath);
+			m_width = loadedPixels.width;
+			m_height = loadedPixels.height;
+			pixels = loadedPixels.data.get();
+		}
+
+		m_mip_levels = createInfo.mipLevel;
+		if (m_mip_levels == 0)
+		{
+			m_mip_levels = static_cast<uint32_t>(std::floor(std::log2(std::max(m_width, m_height)))) + 1;
+		}
+
+		MipmapGenerator::Method mipmapMethod = mipmapGenerator.method(createInfo.format);
+
+		// without a device side path every level is box-filtered here and uploaded with level 0
+		std::vector<unsigned char> levels;
+		uint32_t uploadedLevels = 1;
+		VkDeviceSize imageSize = m_width * m_height * 4;
+		if (m_mip_levels > 1 && mipmapMethod == MipmapGenerator::CPU)
+		{
+			levels = MipmapGenerator::downsample(
+				pixels,
+				static_cast<uint32_t>(m_width),
+				static_cast<uint32_t>(m_height),
+				m_mip_levels,
+				MipmapGenerator::storageFormat(createInfo.format) != createInfo.format
+			);
+			pixels = levels.data();
+			uploadedLevels = m_mip_levels;
+			imageSize = levels.size();
 		}
 
 		vk::Buffer stagingBuffer = vk::Buffer::createStagingBuffer(
@@ -33,67 +173,128 @@ namespace LIB_NAMESPACE
 		stagingBuffer.map();
 		stagingBuffer.write((void*)pixels, imageSize);
 		stagingBuffer.unmap();
+		loadedPixels.data.reset();
+		levels = {};
 
-		stbi_image_free(pixels);
+		createImage(device, physicalDevice, createInfo.format, mipmapMethod);
 
-		createImage(device, physicalDevice, createInfo);
+		std::vector<VkBufferImageCopy> regions(uploadedLevels);
+		VkDeviceSize offset = 0;
+		for (uint32_t level = 0; level < uploadedLevels; level++)
+		{
+			uint32_t width = std::max(static_cast<uint32_t>(m_width) >> level, 1u);
+			uint32_t height = std::max(static_cast<uint32_t>(m_height) >> level, 1u);
+
+			VkBufferImageCopy & region = regions[level];
+			region.bufferOffset = offset;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = {0, 0, 0};
+			region.imageExtent = { width, height, 1 };
+
+			offset += static_cast<VkDeviceSize>(width) * height * 4;
+		}
 
-		command.transitionImageLayout(
+		command.uploadImage(
+			stagingBuffer.buffer(),
 			m_image->image(),
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			VK_IMAGE_ASPECT_COLOR_BIT,
 			m_image->mipLevels(),
-			0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT
-		);
-
-		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = 1;
-		region.imageOffset = {0, 0, 0};
-		region.imageExtent = {
-			static_cast<uint32_t>(m_width),
-			static_cast<uint32_t>(m_height),
-			1
-		};
-
-		command.copyBufferToImage(
-			stagingBuffer.buffer(),
-			m_image->image(),
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&region
+			static_cast<uint32_t>(regions.size()),
+			regions.data()
 		);
+		command.keepAlive(std::move(stagingBuffer));
 
-		createSampler(device, physicalDevice, createInfo);
-		createDescriptor(device, createInfo);
+		mipmapGenerator.generate(command, *m_image, mipmapMethod);
 	}
 
-	Texture::Texture(Texture&& other):
-		m_image(std::move(other.m_image)),
-		m_sampler(std::move(other.m_sampler)),
-		m_descriptor(std::move(other.m_descriptor)),
-		m_width(other.m_width),
-		m_height(other.m_height)
+	void Texture::uploadCompressed(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		Command& command,
+		MipmapGenerator& mipmapGenerator,
+		const CompressedTexture& compressed,
+		CreateInfo& createInfo
+	)
 	{
-	}
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, compressed.format(), &formatProperties);
+		if ((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0)
+		{
+			throw std::runtime_error("failed to load texture, format not supported by the device: " + createInfo.filepath);
+		}
 
-	Texture::~Texture()
-	{
+		m_width = static_cast<int>(compressed.width());
+		m_height = static_cast<int>(compressed.height());
+
+		// block-compressed levels can not be generated, only the ones in the file are used
+		const std::vector<CompressedTexture::Level> & levels = compressed.levels();
+		m_mip_levels = static_cast<uint32_t>(levels.size());
+		if (createInfo.mipLevel != 0)
+		{
+			m_mip_levels = std::min(m_mip_levels, createInfo.mipLevel);
+		}
+
+		VkDeviceSize imageSize = 0;
+		for (uint32_t level = 0; level < m_mip_levels; level++)
+		{
+			imageSize += levels[level].size;
+		}
+
+		vk::Buffer stagingBuffer = vk::Buffer::createStagingBuffer(
+			device,
+			physicalDevice,
+			imageSize
+		);
+
+		// the whole chain in one staging buffer, copied with one region per level
+		std::vector<VkBufferImageCopy> regions(m_mip_levels);
+		VkDeviceSize offset = 0;
+		stagingBuffer.map();
+		for (uint32_t level = 0; level < m_mip_levels; level++)
+		{
+			stagingBuffer.write((void*)levels[level].data, levels[level].size, offset);
+
+			VkBufferImageCopy & region = regions[level];
+			region.bufferOffset = offset;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = {0, 0, 0};
+			region.imageExtent = { levels[level].width, levels[level].height, 1 };
+
+			offset += levels[level].size;
+		}
+		stagingBuffer.unmap();
+
+		createImage(device, physicalDevice, compressed.format(), MipmapGenerator::CPU);
+
+		command.uploadImage(
+			stagingBuffer.buffer(),
+			m_image->image(),
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			m_image->mipLevels(),
+			static_cast<uint32_t>(regions.size()),
+			regions.data()
+		);
+		command.keepAlive(std::move(stagingBuffer));
+
+		// every level is uploaded, only the transition to shader read is recorded
+		mipmapGenerator.generate(command, *m_image, MipmapGenerator::CPU);
 	}
 
 	void Texture::createImage(
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
-		CreateInfo& createInfo
+		VkFormat format,
+		MipmapGenerator::Method mipmapMethod
 	)
 	{
 		VkImageCreateInfo imageInfo{};
@@ -102,15 +303,17 @@ namespace LIB_NAMESPACE
 		imageInfo.extent.width = static_cast<uint32_t>(m_width);
 		imageInfo.extent.height = static_cast<uint32_t>(m_height);
 		imageInfo.extent.depth = 1;
-		imageInfo.mipLevels = createInfo.mipLevel;
+		imageInfo.mipLevels = m_mip_levels;
 		imageInfo.arrayLayers = 1;
-		imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+		imageInfo.format = format;
 		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		imageInfo.usage = 
 			VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
 			VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-			VK_IMAGE_USAGE_SAMPLED_BIT;
+			VK_IMAGE_USAGE_SAMPLED_BIT |
+			MipmapGenerator::imageUsage(mipmapMethod);
+		imageInfo.flags = MipmapGenerator::imageFlags(mipmapMethod, format);
 		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 
@@ -118,13 +321,22 @@ namespace LIB_NAMESPACE
 		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 		viewInfo.image = VK_NULL_HANDLE;
 		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		viewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+		viewInfo.format = format;
 		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		viewInfo.subresourceRange.baseMipLevel = 0;
-		viewInfo.subresourceRange.levelCount = createInfo.mipLevel;
+		viewInfo.subresourceRange.levelCount = m_mip_levels;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
 		viewInfo.subresourceRange.layerCount = 1;
 
+		// an sRGB format can not be a storage image, only its UNORM views are
+		VkImageViewUsageCreateInfo viewUsageInfo{};
+		viewUsageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_USAGE_CREATE_INFO;
+		viewUsageInfo.usage = imageInfo.usage & ~VK_IMAGE_USAGE_STORAGE_BIT;
+		if (imageInfo.flags & VK_IMAGE_CREATE_EXTENDED_USAGE_BIT)
+		{
+			viewInfo.pNext = &viewUsageInfo;
+		}
+
 		m_image = std::make_unique<Image>(
 			device,
 			physicalDevice,
@@ -136,8 +348,7 @@ namespace LIB_NAMESPACE
 
 	void Texture::createSampler(
 		VkDevice device,
-		VkPhysicalDevice physicalDevice,
-		CreateInfo& createInfo
+		VkPhysicalDevice physicalDevice
 	)
 	{
 		VkSamplerCreateInfo samplerInfo{};
@@ -165,13 +376,14 @@ namespace LIB_NAMESPACE
 		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 		samplerInfo.mipLodBias = 0.0f;
 		samplerInfo.minLod = 0.0f;
-		samplerInfo.maxLod = static_cast<float>(createInfo.mipLevel);
+		samplerInfo.maxLod = static_cast<float>(m_mip_levels);
 
 		m_sampler = std::make_unique<vk::core::Sampler>(device, samplerInfo);
 	}
 
 	void Texture::createDescriptor(
 		VkDevice device,
+		DescriptorAllocator& descriptorAllocator,
 		CreateInfo& createInfo
 	)
 	{
@@ -183,34 +395,31 @@ namespace LIB_NAMESPACE
 
 		vk::Descriptor::CreateInfo descriptorInfo{};
 		descriptorInfo.bindings = { layoutBinding };
-		descriptorInfo.descriptor_count = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+		descriptorInfo.descriptor_count = 1;
 
-		m_descriptor = std::make_unique<Descriptor>(device, descriptorInfo);
+		m_descriptor = std::make_unique<Descriptor>(descriptorAllocator, descriptorInfo);
 
 
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-		{
-			VkDescriptorImageInfo imageInfo{};
-			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageInfo.imageView = m_image->view();
-			imageInfo.sampler = m_sampler->getVk();
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = m_image->view();
+		imageInfo.sampler = m_sampler->getVk();
 
-			VkWriteDescriptorSet samplerDescriptorWrites{};
-			samplerDescriptorWrites.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			samplerDescriptorWrites.dstSet = m_descriptor->set(i);
-			samplerDescriptorWrites.dstBinding = 0;
-			samplerDescriptorWrites.dstArrayElement = 0;
-			samplerDescriptorWrites.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			samplerDescriptorWrites.descriptorCount = 1;
-			samplerDescriptorWrites.pImageInfo = &imageInfo;
+		VkWriteDescriptorSet samplerDescriptorWrites{};
+		samplerDescriptorWrites.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		samplerDescriptorWrites.dstSet = m_descriptor->set(0);
+		samplerDescriptorWrites.dstBinding = 0;
+		samplerDescriptorWrites.dstArrayElement = 0;
+		samplerDescriptorWrites.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		samplerDescriptorWrites.descriptorCount = 1;
+		samplerDescriptorWrites.pImageInfo = &imageInfo;
 
-			vkUpdateDescriptorSets(
-				device,
-				1,
-				&samplerDescriptorWrites,
-				0, nullptr
-			);
-		}
+		vkUpdateDescriptorSets(
+			device,
+			1,
+			&samplerDescriptorWrites,
+			0, nullptr
+		);
 	}
 
 }
\ No newline at end of file
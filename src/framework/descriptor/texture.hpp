@@ -3,10 +3,14 @@
 #include "defines.hpp"
 #include "framework/memory/image.hpp"
 #include "framework/descriptor/descriptor.hpp"
+#include "framework/descriptor/bindless_texture_table.hpp"
+#include "framework/descriptor/compressed_texture.hpp"
 #include "framework/command.hpp"
+#include "framework/mipmap_generator.hpp"
 #include "core/image/sampler.hpp"
 
 #include <memory>
+#include <string>
 
 namespace LIB_NAMESPACE
 {
@@ -15,29 +19,68 @@ namespace LIB_NAMESPACE
 
 	public:
 
+		static constexpr uint32_t no_index = UINT32_MAX;
+
 		struct CreateInfo
 		{
 			std::string filepath;
+			// 0 for the full mip chain
 			uint32_t mipLevel = 0;
 			VkShaderStageFlags stageFlags;
+
+			// RGBA8 pixels already decoded by the caller, filepath is ignored when set
+			const unsigned char *pixels = nullptr;
+			int width = 0;
+			int height = 0;
+
+			// UNORM for data textures like normal or metallic-roughness maps
+			VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+
+			// KTX2 or DDS file already loaded by the caller, filepath and pixels are ignored when set.
+			// The format and mip levels are the ones of the file, a .ktx2 or .dds filepath is loaded the same way.
+			const CompressedTexture *compressed = nullptr;
 		};
 
 		Texture(
 			VkDevice device,
 			VkPhysicalDevice physicalDevice,
 			Command& command,
+			DescriptorAllocator& descriptorAllocator,
+			BindlessTextureTable* textureTable,
+			MipmapGenerator& mipmapGenerator,
 			CreateInfo& createInfo
 		);
+		// RGBA8 pixels of an image file, decoded without touching the device so it can run on any thread.
+		// KTX2 and DDS files are mapped and parsed into compressed instead.
+		struct Pixels
+		{
+			std::unique_ptr<unsigned char, void (*)(void *)> data{ nullptr, nullptr };
+			int width = 0;
+			int height = 0;
+
+			std::unique_ptr<CompressedTexture> compressed;
+		};
+
 		Texture(const Texture & other) = delete;
 		Texture(Texture && other);
 		Texture & operator=(const Texture & other) = delete;
 		Texture & operator=(Texture && other) = delete;
 		~Texture();
 
+		// throws when the file can not be decoded, format picks the sRGB variant of legacy DDS formats
+		static Pixels decode(const std::string & filepath, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+
+		// exchange every resource with other, RenderAPI swaps a placeholder with the loaded texture
+		void swap(Texture & other);
+
 		Image& image() const { return *m_image.get(); }
 		VkSampler sampler() const { return m_sampler->getVk(); }
+		// a single set, the texture is the same for every frame
 		Descriptor* descriptor() const { return m_descriptor.get(); }
 
+		// index in the bindless texture table, no_index without one
+		uint32_t bindlessIndex() const { return m_bindless_index; }
+
 		int width() const { return m_width; }
 		int height() const { return m_height; }
 
@@ -47,23 +90,45 @@ namespace LIB_NAMESPACE
 		std::unique_ptr<core::Sampler> m_sampler;
 		std::unique_ptr<Descriptor> m_descriptor;
 
+		BindlessTextureTable *m_texture_table;
+		uint32_t m_bindless_index = no_index;
+
 		int m_width;
 		int m_height;
+		uint32_t m_mip_levels;
 
-		void createImage(
+		void uploadPixels(
 			VkDevice device,
 			VkPhysicalDevice physicalDevice,
+			Command& command,
+			MipmapGenerator& mipmapGenerator,
 			CreateInfo& createInfo
 		);
 
-		void createSampler(
+		void uploadCompressed(
 			VkDevice device,
 			VkPhysicalDevice physicalDevice,
+			Command& command,
+			MipmapGenerator& mipmapGenerator,
+			const CompressedTexture& compressed,
 			CreateInfo& createInfo
 		);
 
+		void createImage(
+			VkDevice device,
+			VkPhysicalDevice physicalDevice,
+			VkFormat format,
+			MipmapGenerator::Method mipmapMethod
+		);
+
+		void createSampler(
+			VkDevice device,
+			VkPhysicalDevice physicalDevice
+		);
+
 		void createDescriptor(
 			VkDevice device,
+			DescriptorAllocator& descriptorAllocator,
 			CreateInfo& createInfo
 		);
 
@@ -7,11 +7,12 @@ namespace LIB_NAMESPACE
 	UniformBuffer::UniformBuffer(
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
+		DescriptorAllocator & descriptorAllocator,
 		const CreateInfo & createInfo
 	)
 	{
 		createBuffer(device, physicalDevice, createInfo);
-		createDescriptor(device, createInfo);
+		createDescriptor(device, descriptorAllocator, createInfo);
 	}
 
 	UniformBuffer::UniformBuffer(UniformBuffer && other)
@@ -53,6 +54,7 @@ namespace LIB_NAMESPACE
 
 	void UniformBuffer::createDescriptor(
 		VkDevice device,
+		DescriptorAllocator & descriptorAllocator,
 		const CreateInfo & createInfo
 	)
 	{
@@ -66,7 +68,7 @@ namespace LIB_NAMESPACE
 		descriptorInfo.bindings = { layoutBinding };
 		descriptorInfo.descriptor_count = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
-		m_descriptor = std::make_unique<Descriptor>(device, descriptorInfo);
+		m_descriptor = std::make_unique<Descriptor>(descriptorAllocator, descriptorInfo);
 
 
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
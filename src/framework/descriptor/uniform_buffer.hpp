@@ -23,6 +23,7 @@ namespace LIB_NAMESPACE
 		UniformBuffer(
 			VkDevice device,
 			VkPhysicalDevice physicalDevice,
+			DescriptorAllocator & descriptorAllocator,
 			const CreateInfo & createInfo
 		);
 		UniformBuffer(const UniformBuffer & other) = delete;
@@ -51,6 +52,7 @@ namespace LIB_NAMESPACE
 
 		void createDescriptor(
 			VkDevice device,
+			DescriptorAllocator & descriptorAllocator,
 			const CreateInfo & createInfo
 		);
 
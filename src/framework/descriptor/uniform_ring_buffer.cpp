@@ -0,0 +1,140 @@
+#include "uniform_ring_buffer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	UniformRingBuffer::UniformRingBuffer(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		DescriptorAllocator & descriptorAllocator,
+		const CreateInfo & createInfo
+	)
+	{
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		m_uniform_alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+		m_storage_alignment = std::max<VkDeviceSize>(properties.limits.minStorageBufferOffsetAlignment, 1);
+		m_uniform_range = std::min(createInfo.uniform_range, properties.limits.maxUniformBufferRange);
+		m_storage_range = std::min(createInfo.storage_range, properties.limits.maxStorageBufferRange);
+
+		// every region starts aligned for both kinds of data
+		VkDeviceSize alignment = std::max(m_uniform_alignment, m_storage_alignment);
+		m_frame_size = (createInfo.frame_size + alignment - 1) / alignment * alignment;
+
+		// the range bound from the last allocation may run past the last region
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = m_frame_size * MAX_FRAMES_IN_FLIGHT + std::max(m_uniform_range, m_storage_range);
+		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		m_buffer = std::make_unique<Buffer>(
+			device,
+			physicalDevice,
+			bufferInfo,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+		VK_CHECK(m_buffer->map(), "failed to map uniform ring buffer");
+
+		createDescriptor(
+			device, descriptorAllocator, m_uniform_descriptor,
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, m_uniform_range, createInfo.stageFlags
+		);
+		createDescriptor(
+			device, descriptorAllocator, m_storage_descriptor,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, m_storage_range, createInfo.stageFlags
+		);
+	}
+
+	UniformRingBuffer::~UniformRingBuffer()
+	{
+	}
+
+	void UniformRingBuffer::beginFrame(uint32_t frame)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		m_frame_begin = m_frame_size * frame;
+		m_head = m_frame_begin;
+	}
+
+	UniformRingBuffer::Allocation UniformRingBuffer::allocateUniform(uint32_t size)
+	{
+		return allocate(size, m_uniform_range, m_uniform_alignment);
+	}
+
+	UniformRingBuffer::Allocation UniformRingBuffer::allocateStorage(uint32_t size)
+	{
+		return allocate(size, m_storage_range, m_storage_alignment);
+	}
+
+	VkDeviceSize UniformRingBuffer::frameUsage()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		return m_head - m_frame_begin;
+	}
+
+	UniformRingBuffer::Allocation UniformRingBuffer::allocate(uint32_t size, uint32_t range, VkDeviceSize alignment)
+	{
+		if (size > range)
+		{
+			throw std::runtime_error("failed to allocate uniform data: larger than the range of the descriptor");
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		VkDeviceSize offset = (m_head + alignment - 1) / alignment * alignment;
+		if (offset + size > m_frame_begin + m_frame_size)
+		{
+			throw std::runtime_error("failed to allocate uniform data: uniform ring buffer frame is full");
+		}
+		m_head = offset + size;
+
+		Allocation allocation;
+		allocation.data = static_cast<char *>(m_buffer->mapped()) + offset;
+		allocation.offset = static_cast<uint32_t>(offset);
+		return allocation;
+	}
+
+	void UniformRingBuffer::createDescriptor(
+		VkDevice device,
+		DescriptorAllocator & descriptorAllocator,
+		std::unique_ptr<Descriptor> & descriptor,
+		VkDescriptorType type,
+		uint32_t range,
+		VkShaderStageFlags stageFlags
+	)
+	{
+		VkDescriptorSetLayoutBinding layoutBinding{};
+		layoutBinding.binding = 0;
+		layoutBinding.descriptorType = type;
+		layoutBinding.descriptorCount = 1;
+		layoutBinding.stageFlags = stageFlags;
+
+		vk::Descriptor::CreateInfo descriptorInfo{};
+		descriptorInfo.bindings = { layoutBinding };
+		descriptorInfo.descriptor_count = 1;
+
+		descriptor = std::make_unique<Descriptor>(descriptorAllocator, descriptorInfo);
+
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = m_buffer->buffer();
+		bufferInfo.offset = 0;
+		bufferInfo.range = range;
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = descriptor->set(0);
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = type;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pBufferInfo = &bufferInfo;
+
+		vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "defines.hpp"
+#include "framework/memory/buffer.hpp"
+#include "framework/descriptor/descriptor.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+
+namespace LIB_NAMESPACE
+{
+	// Transient uniform and storage data written by the CPU for the frame being recorded.
+	// One persistently mapped buffer is split in MAX_FRAMES_IN_FLIGHT regions, allocations bump a
+	// head in the region of the current frame and the whole region is recycled by beginFrame.
+	// Data is bound through a single UNIFORM_BUFFER_DYNAMIC (or STORAGE_BUFFER_DYNAMIC) set
+	// with the offset of the allocation as dynamic offset, so per-object blocks need no buffer
+	// and no descriptor of their own.
+	class UniformRingBuffer
+	{
+
+	public:
+
+		struct CreateInfo
+		{
+			// bytes per frame in flight
+			VkDeviceSize frame_size = 4 * 1024 * 1024;
+			// size of the block a shader sees from the dynamic offset, larger allocations are refused,
+			// capped by maxUniformBufferRange and maxStorageBufferRange
+			uint32_t uniform_range = 65536;
+			uint32_t storage_range = 65536;
+			VkShaderStageFlags stageFlags = VK_SHADER_STAGE_ALL;
+		};
+
+		struct Allocation
+		{
+			// write the data here, the memory is host coherent
+			void *data;
+			// dynamic offset to bind the set with
+			uint32_t offset;
+		};
+
+		UniformRingBuffer(
+			VkDevice device,
+			VkPhysicalDevice physicalDevice,
+			DescriptorAllocator & descriptorAllocator,
+			const CreateInfo & createInfo
+		);
+		UniformRingBuffer(const UniformRingBuffer &) = delete;
+		UniformRingBuffer(UniformRingBuffer && other) = delete;
+		UniformRingBuffer & operator=(const UniformRingBuffer &) = delete;
+		UniformRingBuffer & operator=(UniformRingBuffer && other) = delete;
+		~UniformRingBuffer();
+
+		// the frame must not be in flight anymore, previous allocations of the frame are discarded
+		void beginFrame(uint32_t frame);
+
+		// aligned to minUniformBufferOffsetAlignment, throws when the frame region is full
+		Allocation allocateUniform(uint32_t size);
+		// aligned to minStorageBufferOffsetAlignment
+		Allocation allocateStorage(uint32_t size);
+
+		// binding 0 of one set, bound with the offset of an allocation
+		Descriptor & uniformDescriptor() { return *m_uniform_descriptor; }
+		Descriptor & storageDescriptor() { return *m_storage_descriptor; }
+
+		// bytes allocated in the current frame, alignment padding included
+		VkDeviceSize frameUsage();
+
+	private:
+
+		std::unique_ptr<Buffer> m_buffer;
+		std::unique_ptr<Descriptor> m_uniform_descriptor;
+		std::unique_ptr<Descriptor> m_storage_descriptor;
+
+		VkDeviceSize m_frame_size;
+		uint32_t m_uniform_range;
+		uint32_t m_storage_range;
+		VkDeviceSize m_uniform_alignment;
+		VkDeviceSize m_storage_alignment;
+
+		VkDeviceSize m_frame_begin = 0;
+		VkDeviceSize m_head = 0;
+		std::mutex m_mutex;
+
+		Allocation allocate(uint32_t size, uint32_t range, VkDeviceSize alignment);
+		void createDescriptor(
+			VkDevice device,
+			DescriptorAllocator & descriptorAllocator,
+			std::unique_ptr<Descriptor> & descriptor,
+			VkDescriptorType type,
+			uint32_t range,
+			VkShaderStageFlags stageFlags
+		);
+
+	};
+}
@@ -6,33 +6,65 @@
 
 namespace LIB_NAMESPACE
 {
-	Device::Device(GLFWwindow *glfwWindow):
+	Device::Device(GLFWwindow *glfwWindow, const std::string & pipeline_cache_path):
 		glfwWindow(glfwWindow),
 		m_instance(validation_layers, getRequiredExtensions()),
 		#ifndef NDEBUG
 			m_debug_messenger(m_instance.getVk()),
 		#endif
-		m_surface(m_instance.getVk(), glfwWindow),
-		m_physical_device(m_instance.getVk(), device_extensions, m_surface.getVk()),
-		m_device(m_physical_device, validation_layers, device_extensions),
+		m_surface(createSurface()),
+		m_physical_device(m_instance.getVk(), deviceExtensions(), m_surface ? m_surface->getVk() : VK_NULL_HANDLE),
+		m_device(m_physical_device, validation_layers, deviceExtensions()),
 		m_graphicsQueue(m_device.getVk(), m_physical_device.queueFamilyIndices().graphicsFamily.value()),
-		m_presentQueue(m_device.getVk(), m_physical_device.queueFamilyIndices().presentFamily.value())
+		m_presentQueue(m_device.getVk(), m_physical_device.queueFamilyIndices().presentFamily.value_or(
+			m_physical_device.queueFamilyIndices().graphicsFamily.value()
+		)),
+		m_transferQueue(m_device.getVk(), transferFamily()),
+		m_computeQueue(m_device.getVk(), computeFamily()),
+		m_pipeline_cache(std::make_unique<PipelineCache>(m_device.getVk(), m_physical_device.getVk(), pipeline_cache_path)),
+		m_shader_module_cache(std::make_unique<ShaderModuleCache>(m_device.getVk())),
+		m_descriptor_allocator(std::make_unique<DescriptorAllocator>(m_device.getVk()))
 	{
-
+		if (m_device.descriptorIndexingEnabled())
+		{
+			m_texture_table = std::make_unique<BindlessTextureTable>(m_device.getVk(), m_physical_device.getVk());
+		}
 	}
 
 	Device::~Device()
 	{
+		// a failed save only costs the next startup its warm cache
+		try
+		{
+			m_pipeline_cache->save();
+		}
+		catch (const std::exception &)
+		{
+		}
+	}
 
+
+	uint32_t Device::transferFamily() const
+	{
+		return m_physical_device.queueFamilyIndices().transferFamily.value_or(graphicsFamily());
 	}
 
+	uint32_t Device::computeFamily() const
+	{
+		return m_physical_device.queueFamilyIndices().computeFamily.value_or(graphicsFamily());
+	}
 
 	std::vector<const char*> Device::getRequiredExtensions()
 	{
-		uint32_t glfwExtensionCount = 0;
-		const char ** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		std::vector<const char *> extensions;
+
+		if (headless() == false)
+		{
+			uint32_t glfwExtensionCount = 0;
+			const char ** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-		std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
 		#ifndef NDEBUG
 			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -41,9 +73,24 @@ namespace LIB_NAMESPACE
 		return extensions;
 	}
 
+	std::unique_ptr<Surface> Device::createSurface()
+	{
+		if (headless())
+		{
+			return nullptr;
+		}
+
+		return std::make_unique<Surface>(m_instance.getVk(), glfwWindow);
+	}
+
+	const std::vector<const char*> & Device::deviceExtensions() const
+	{
+		return headless() ? headless_device_extensions : device_extensions;
+	}
+
 	Swapchain::SupportDetails Device::querySwapChainSupport(const VkPhysicalDevice & physical_device)
 	{
-		return core::PhysicalDevice::querySwapChainSupport(physical_device, m_surface.getVk());
+		return core::PhysicalDevice::querySwapChainSupport(physical_device, m_surface->getVk());
 	}
 
 }
\ No newline at end of file
@@ -7,10 +7,15 @@
 #include "core/physical_device.hpp"
 #include "core/logical_device.hpp"
 #include "swapchain.hpp"
+#include "pipeline_cache.hpp"
+#include "shader_module_cache.hpp"
+#include "descriptor/descriptor_allocator.hpp"
+#include "descriptor/bindless_texture_table.hpp"
 #include "queue.hpp"
 
 #include <memory>
 #include <optional>
+#include <string>
 
 namespace LIB_NAMESPACE
 {
@@ -29,8 +34,16 @@ namespace LIB_NAMESPACE
 			VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME
 		};
 
-		Surface & surface() { return m_surface; }
-		const Surface & surface() const { return m_surface; }
+		// a headless device never presents, so it does not need the swapchain extension
+		const std::vector<const char*> headless_device_extensions = {
+			VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME
+		};
+
+		// relative to the working directory, see PipelineCache
+		static constexpr const char *default_pipeline_cache_path = "pipeline_cache.bin";
+
+		Surface & surface() { return *m_surface; }
+		const Surface & surface() const { return *m_surface; }
 
 		core::PhysicalDevice & physicalDevice() { return m_physical_device; }
 		const core::PhysicalDevice & physicalDevice() const { return m_physical_device; }
@@ -44,9 +57,39 @@ namespace LIB_NAMESPACE
 		core::Queue & presentQueue() { return m_presentQueue; }
 		const core::Queue & presentQueue() const { return m_presentQueue; }
 
-		Device(GLFWwindow *glfwWindow);
+		// the graphics queue when the device has no dedicated family, see transferFamily() and computeFamily()
+		core::Queue & transferQueue() { return m_transferQueue; }
+		const core::Queue & transferQueue() const { return m_transferQueue; }
+
+		core::Queue & computeQueue() { return m_computeQueue; }
+		const core::Queue & computeQueue() const { return m_computeQueue; }
+
+		uint32_t graphicsFamily() const { return m_physical_device.queueFamilyIndices().graphicsFamily.value(); }
+		uint32_t transferFamily() const;
+		uint32_t computeFamily() const;
+		bool hasDedicatedTransferQueue() const { return transferFamily() != graphicsFamily(); }
+		bool hasDedicatedComputeQueue() const { return computeFamily() != graphicsFamily(); }
+
+		PipelineCache & pipelineCache() { return *m_pipeline_cache; }
+		const PipelineCache & pipelineCache() const { return *m_pipeline_cache; }
+
+		ShaderModuleCache & shaderModuleCache() { return *m_shader_module_cache; }
+		const ShaderModuleCache & shaderModuleCache() const { return *m_shader_module_cache; }
+
+		DescriptorAllocator & descriptorAllocator() { return *m_descriptor_allocator; }
+		const DescriptorAllocator & descriptorAllocator() const { return *m_descriptor_allocator; }
+
+		// null when the device lacks the descriptor indexing features
+		BindlessTextureTable * textureTable() { return m_texture_table.get(); }
+		const BindlessTextureTable * textureTable() const { return m_texture_table.get(); }
+
+		// a null window creates a headless device: no surface and no present queue family
+		// the pipeline cache is loaded from pipeline_cache_path and saved back on destruction
+		Device(GLFWwindow *glfwWindow, const std::string & pipeline_cache_path = default_pipeline_cache_path);
 		~Device();
 
+		bool headless() const { return glfwWindow == nullptr; }
+
 		Swapchain::SupportDetails querySwapChainSupport(const VkPhysicalDevice&  physical_device);
 
 		GLFWwindow *glfwWindow;
@@ -58,15 +101,24 @@ namespace LIB_NAMESPACE
 		core::DebugMessenger m_debug_messenger;
 #endif
 
-		Surface m_surface;
+		std::unique_ptr<Surface> m_surface;
 
 		core::PhysicalDevice m_physical_device;
 
 		core::Device m_device;
 		core::Queue m_graphicsQueue;
 		core::Queue m_presentQueue;
+		core::Queue m_transferQueue;
+		core::Queue m_computeQueue;
+
+		std::unique_ptr<PipelineCache> m_pipeline_cache;
+		std::unique_ptr<ShaderModuleCache> m_shader_module_cache;
+		std::unique_ptr<DescriptorAllocator> m_descriptor_allocator;
+		std::unique_ptr<BindlessTextureTable> m_texture_table;
 
 		std::vector<const char*> getRequiredExtensions();
+		std::unique_ptr<Surface> createSurface();
+		const std::vector<const char*> & deviceExtensions() const;
 
 	};
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "gpu_profiler.hpp"
+#include "core/physical_device.hpp"
+
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	GpuProfiler::GpuProfiler(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		uint32_t queueFamilyIndex,
+		uint32_t max_scope_count
+	):
+		m_max_scope_count(max_scope_count)
+	{
+		uint32_t validBits = core::PhysicalDevice::getQueueFamilyProperties(physicalDevice).at(queueFamilyIndex).timestampValidBits;
+
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		if (validBits == 0 || properties.limits.timestampPeriod <= 0.0f)
+		{
+			return;
+		}
+		m_timestamp_mask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+		m_timestamp_period = properties.limits.timestampPeriod;
+
+		core::QueryPool::CreateInfo poolInfo{};
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = m_max_scope_count * 2;
+
+		for (auto& frame : m_frames)
+		{
+			frame.pool = std::make_unique<core::QueryPool>(device, poolInfo);
+			// the first reset is recorded by beginFrame, before any result is read
+		}
+	}
+
+	GpuProfiler::~GpuProfiler()
+	{
+	}
+
+	void GpuProfiler::beginFrame(VkCommandBuffer cmd, uint32_t frame)
+	{
+		if (supported() == false)
+		{
+			return;
+		}
+
+		FrameQueries & queries = m_frames.at(frame);
+		readResults(queries);
+		queries.scopes.clear();
+
+		vkCmdResetQueryPool(cmd, queries.pool->getVk(), 0, m_max_scope_count * 2);
+
+		m_recording = &queries;
+		m_open_scopes.clear();
+		beginScope(cmd, "frame");
+	}
+
+	void GpuProfiler::endFrame(VkCommandBuffer cmd)
+	{
+		if (m_recording == nullptr)
+		{
+			return;
+		}
+
+		while (m_open_scopes.empty() == false)
+		{
+			endScope(cmd);
+		}
+		m_recording = nullptr;
+	}
+
+	void GpuProfiler::beginScope(VkCommandBuffer cmd, const std::string & name)
+	{
+		if (m_recording == nullptr || m_recording->scopes.size() >= m_max_scope_count)
+		{
+			return;
+		}
+
+		Scope scope;
+		scope.name = name;
+		scope.depth = static_cast<uint32_t>(m_open_scopes.size());
+		scope.begin_query = static_cast<uint32_t>(m_recording->scopes.size() * 2);
+
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_recording->pool->getVk(), scope.begin_query);
+
+		m_open_scopes.push_back(m_recording->scopes.size());
+		m_recording->scopes.push_back(std::move(scope));
+	}
+
+	void GpuProfiler::endScope(VkCommandBuffer cmd)
+	{
+		if (m_recording == nullptr || m_open_scopes.empty())
+		{
+			return;
+		}
+
+		Scope & scope = m_recording->scopes[m_open_scopes.back()];
+		m_open_scopes.pop_back();
+
+		scope.end_query = scope.begin_query + 1;
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_recording->pool->getVk(), scope.end_query);
+	}
+
+	void GpuProfiler::readResults(FrameQueries & frame)
+	{
+		if (frame.scopes.empty())
+		{
+			return;
+		}
+
+		// value then availability for each query
+		uint32_t queryCount = static_cast<uint32_t>(frame.scopes.size() * 2);
+		std::vector<uint64_t> results(queryCount * 2);
+
+		VkResult result = frame.pool->getResults(
+			0, queryCount,
+			results.size() * sizeof(uint64_t), results.data(),
+			2 * sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+		);
+		if (result != VK_SUCCESS && result != VK_NOT_READY)
+		{
+			TROW("failed to read timestamp queries", result)
+		}
+
+		m_timings.clear();
+		std::map<std::string, uint32_t> ranks;
+
+		for (auto& scope : frame.scopes)
+		{
+			if (scope.end_query == no_query
+				|| results[scope.begin_query * 2 + 1] == 0
+				|| results[scope.end_query * 2 + 1] == 0)
+			{
+				continue;
+			}
+
+			uint64_t ticks = (results[scope.end_query * 2] - results[scope.begin_query * 2]) & m_timestamp_mask;
+
+			Timing timing;
+			timing.name = scope.name;
+			timing.depth = scope.depth;
+			timing.milliseconds = ticks * m_timestamp_period / 1000000.0;
+			timing.average_milliseconds = m_averages[{ scope.name, ranks[scope.name]++ }].add(timing.milliseconds);
+			m_timings.push_back(std::move(timing));
+		}
+	}
+
+	double GpuProfiler::Average::add(double sample)
+	{
+		sum -= samples[next];
+		samples[next] = sample;
+		sum += sample;
+		next = (next + 1) % average_frame_count;
+		if (count < average_frame_count)
+		{
+			count++;
+		}
+		return sum / count;
+	}
+}
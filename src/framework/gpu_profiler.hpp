@@ -0,0 +1,113 @@
+#pragma once
+
+#include "defines.hpp"
+#include "core/query_pool.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// GPU time of named, nestable scopes of the frame command buffer, from timestamp queries.
+	// Each frame in flight has its own query pool, read back when the frame slot is reused:
+	// its fence has signaled by then, so the results are available and reading them never stalls.
+	// Timings are reported for the last frame read back and averaged over the last frames.
+	class GpuProfiler
+	{
+
+	public:
+
+		static constexpr uint32_t default_max_scope_count = 256;
+		// frames the rolling averages are taken over
+		static constexpr uint32_t average_frame_count = 64;
+
+		struct Timing
+		{
+			std::string name;
+			// nesting level, 0 for the whole frame
+			uint32_t depth;
+			double milliseconds;
+			// of the scope with the same name and the same rank among the scopes of that name
+			double average_milliseconds;
+		};
+
+		// scopes past max_scope_count in a frame are not measured
+		GpuProfiler(
+			VkDevice device,
+			VkPhysicalDevice physicalDevice,
+			uint32_t queueFamilyIndex,
+			uint32_t max_scope_count = default_max_scope_count
+		);
+		GpuProfiler(const GpuProfiler &) = delete;
+		GpuProfiler(GpuProfiler && other) = delete;
+		GpuProfiler & operator=(const GpuProfiler &) = delete;
+		GpuProfiler & operator=(GpuProfiler && other) = delete;
+		~GpuProfiler();
+
+		// false when the queue family has no timestamps, every call is then ignored
+		bool supported() const { return m_timestamp_mask != 0; }
+
+		// the fence of the frame slot must have signaled, the previous results of the slot are read back
+		// and its queries reset, then the "frame" scope begins
+		void beginFrame(VkCommandBuffer cmd, uint32_t frame);
+		// ends the scopes left open and the frame scope
+		void endFrame(VkCommandBuffer cmd);
+
+		// not inside a rendering recorded with secondary command buffers
+		void beginScope(VkCommandBuffer cmd, const std::string & name);
+		void endScope(VkCommandBuffer cmd);
+
+		// scopes of the last frame read back, in the order they began, the frame first
+		const std::vector<Timing> & timings() const { return m_timings; }
+
+	private:
+
+		static constexpr uint32_t no_query = UINT32_MAX;
+
+		struct Scope
+		{
+			std::string name;
+			uint32_t depth;
+			uint32_t begin_query;
+			uint32_t end_query = no_query;
+		};
+
+		struct FrameQueries
+		{
+			std::unique_ptr<core::QueryPool> pool;
+			std::vector<Scope> scopes;
+		};
+
+		struct Average
+		{
+			std::array<double, average_frame_count> samples = {};
+			uint32_t count = 0;
+			uint32_t next = 0;
+			double sum = 0.0;
+
+			double add(double sample);
+		};
+
+		uint32_t m_max_scope_count;
+		uint64_t m_timestamp_mask = 0;
+		// nanoseconds per tick
+		double m_timestamp_period = 0.0;
+
+		std::array<FrameQueries, MAX_FRAMES_IN_FLIGHT> m_frames;
+		FrameQueries *m_recording = nullptr;
+		// indices in the scopes of the recording frame
+		std::vector<size_t> m_open_scopes;
+
+		std::vector<Timing> m_timings;
+		std::map<std::pair<std::string, uint32_t>, Average> m_averages;
+
+		void readResults(FrameQueries & frame);
+
+	};
+}
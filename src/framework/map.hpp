@@ -5,24 +5,54 @@
 #include <vulkan/vulkan.h>
 
 #include <stdexcept>
-#include <map>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
 
 namespace LIB_NAMESPACE
 {
+	// Generational slot map.
+	// An id packs a slot index (low 32 bits) and the generation of the slot
+	// (high 32 bits), so get() is a single indexed load plus a generation check
+	// and a removed id is detected instead of aliasing the next value stored in its slot.
+	// Slots live in pages that are never moved or freed before the map is destroyed:
+	// get() does not lock and can run concurrently with insert() and remove() of other ids,
+	// but not with replace() of the same id.
+	// Writers are serialized with a mutex.
 	template<typename Value>
 	class Map
 	{
-	
+
 	public:
 
 		Map():
-			m_map(),
-			m_next_id(1)
+			m_pages(),
+			m_free_slots(),
+			m_slot_count(0),
+			m_size(0)
 		{
 		}
 
 		~Map()
 		{
+			for (uint32_t page = 0; page < page_count; page++)
+			{
+				Slot *slots = m_pages[page].load(std::memory_order_relaxed);
+				if (slots == nullptr)
+				{
+					continue;
+				}
+
+				for (uint32_t i = 0; i < pageSize(page); i++)
+				{
+					if (isAlive(slots[i].generation.load(std::memory_order_relaxed)))
+					{
+						slots[i].value()->~Value();
+					}
+				}
+				delete[] slots;
+			}
 		}
 
 		Map(Map & map) = delete;
@@ -30,37 +60,173 @@ namespace LIB_NAMESPACE
 		Map & operator=(Map & map) = delete;
 		Map & operator=(Map && map) = delete;
 
-		size_t size() const { return m_map.size(); }
+		size_t size() const { return m_size.load(std::memory_order_relaxed); }
 
 		uint64_t insert(Value && value)
 		{
-			m_map.insert(std::make_pair(m_next_id, std::move(value)));
-			return m_next_id++;
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			uint32_t index;
+			if (m_free_slots.empty() == false)
+			{
+				index = m_free_slots.back();
+				m_free_slots.pop_back();
+			}
+			else
+			{
+				index = m_slot_count;
+				allocateSlot(index);
+				m_slot_count++;
+			}
+
+			Slot & slot = *findSlot(index);
+			new (slot.storage) Value(std::move(value));
+
+			// publish the value before the id becomes valid
+			uint32_t generation = slot.generation.load(std::memory_order_relaxed) + 1;
+			slot.generation.store(generation, std::memory_order_release);
+
+			m_size.fetch_add(1, std::memory_order_relaxed);
+
+			return makeId(index, generation);
 		}
 
-		Value & get(uint64_t key) { return m_map.at(key); }
-		const Value & get(uint64_t key) const { return m_map.at(key); }
+		Value & get(uint64_t key) { return *aliveSlot(key)->value(); }
+		const Value & get(uint64_t key) const { return *aliveSlot(key)->value(); }
 
-		void remove(uint64_t key) { m_map.erase(key); }
+		bool contains(uint64_t key) const
+		{
+			Slot *slot = findSlot(indexOf(key));
+			return slot != nullptr && slot->generation.load(std::memory_order_acquire) == generationOf(key);
+		}
 
-		void replace(uint64_t key, Value && value)
+		// removing an id that is not (or no longer) in the map does nothing
+		void remove(uint64_t key)
 		{
-			m_map.erase(key);
-			m_map.insert(std::make_pair(key, std::move(value)));
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			if (contains(key) == false)
+			{
+				return;
+			}
+
+			Slot & slot = *findSlot(indexOf(key));
+			slot.generation.store(generationOf(key) + 1, std::memory_order_release);
+			slot.value()->~Value();
+
+			m_free_slots.push_back(indexOf(key));
+			m_size.fetch_sub(1, std::memory_order_relaxed);
 		}
 
-		auto begin() { return m_map.begin(); }
-		auto end() { return m_map.end(); }
+		// The id stays valid, only the value behind it changes.
+		// Unlike insert and remove, this is not safe against a concurrent get() of the same id,
+		// which could see the old value being destroyed: the caller must keep readers of that id out,
+		// as RenderAPI does by replacing targets under its global lock after the device is idle.
+		void replace(uint64_t key, Value && value)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			Slot & slot = *aliveSlot(key);
+			slot.value()->~Value();
+			new (slot.storage) Value(std::move(value));
+		}
 
-		auto cbegin() const { return m_map.cbegin(); }
-		auto cend() const { return m_map.cend(); }
+		std::vector<uint64_t> ids() const
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			std::vector<uint64_t> ids;
+			ids.reserve(size());
+			for (uint32_t index = 0; index < m_slot_count; index++)
+			{
+				uint32_t generation = findSlot(index)->generation.load(std::memory_order_relaxed);
+				if (isAlive(generation))
+				{
+					ids.push_back(makeId(index, generation));
+				}
+			}
+			return ids;
+		}
 
 		static const uint64_t no_id = 0;
 
 	private:
 
-		std::map<uint64_t, Value> m_map;
-		uint64_t m_next_id;
+		struct Slot
+		{
+			// even when the slot is free, odd while it holds a value, so a live id is never 0
+			std::atomic<uint32_t> generation{0};
+			alignas(Value) unsigned char storage[sizeof(Value)];
+
+			Value *value() { return std::launder(reinterpret_cast<Value *>(storage)); }
+		};
+
+		// page i holds first_page_size << i slots, 32 pages are enough for any 32 bits index
+		static const uint32_t first_page_shift = 6;
+		static const uint32_t page_count = 32 - first_page_shift;
+
+		std::atomic<Slot *> m_pages[page_count];
+
+		std::vector<uint32_t> m_free_slots;
+		uint32_t m_slot_count;
+		std::atomic<size_t> m_size;
+
+		mutable std::mutex m_mutex;
+
+		static uint64_t makeId(uint32_t index, uint32_t generation) { return (static_cast<uint64_t>(generation) << 32) | index; }
+		static uint32_t indexOf(uint64_t key) { return static_cast<uint32_t>(key); }
+		static uint32_t generationOf(uint64_t key) { return static_cast<uint32_t>(key >> 32); }
+		static bool isAlive(uint32_t generation) { return generation & 1; }
+
+		static uint32_t pageSize(uint32_t page) { return 1u << (page + first_page_shift); }
+
+		static void locate(uint32_t index, uint32_t & page, uint32_t & offset)
+		{
+			uint64_t biased = static_cast<uint64_t>(index) + (1u << first_page_shift);
+			uint32_t high_bit = 63 - __builtin_clzll(biased);
+			page = high_bit - first_page_shift;
+			offset = static_cast<uint32_t>(biased - (1ull << high_bit));
+		}
+
+		Slot *findSlot(uint32_t index) const
+		{
+			uint32_t page, offset;
+			locate(index, page, offset);
+
+			if (page >= page_count)
+			{
+				return nullptr;
+			}
+
+			Slot *slots = m_pages[page].load(std::memory_order_acquire);
+			return slots == nullptr ? nullptr : slots + offset;
+		}
+
+		Slot *aliveSlot(uint64_t key) const
+		{
+			Slot *slot = findSlot(indexOf(key));
+			if (slot == nullptr || slot->generation.load(std::memory_order_acquire) != generationOf(key))
+			{
+				throw std::out_of_range("invalid or removed map id");
+			}
+			return slot;
+		}
+
+		void allocateSlot(uint32_t index)
+		{
+			uint32_t page, offset;
+			locate(index, page, offset);
+
+			if (page >= page_count)
+			{
+				throw std::length_error("map is full");
+			}
+
+			if (offset == 0)
+			{
+				m_pages[page].store(new Slot[pageSize(page)], std::memory_order_release);
+			}
+		}
 
 	};
-}
\ No newline at end of file
+}
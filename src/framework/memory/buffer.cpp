@@ -14,7 +14,7 @@ namespace LIB_NAMESPACE
 		m_buffer(device, bufferInfo),
 		m_memory(device, physicalDevice, properties, m_buffer.getMemoryRequirements())
 	{
-		vkBindBufferMemory(device, m_buffer.getVk(), m_memory.getVk(), 0);
+		vkBindBufferMemory(device, m_buffer.getVk(), m_memory.getVk(), m_memory.offset());
 	}
 
 	Buffer::Buffer(Buffer&& other):
@@ -42,9 +42,9 @@ namespace LIB_NAMESPACE
 		m_memory.unmap();
 	}
 
-	void Buffer::write(void *data, uint32_t size)
+	void Buffer::write(void *data, uint32_t size, VkDeviceSize offset)
 	{
-		m_memory.write(data, size);
+		m_memory.write(data, size, offset);
 	}
 
 
@@ -109,4 +109,25 @@ namespace LIB_NAMESPACE
 		);
 	}
 
+	Buffer Buffer::createDeviceLocalBuffer(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		VkDeviceSize size,
+		VkBufferUsageFlags usage
+	)
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		return Buffer(
+			device,
+			physicalDevice,
+			bufferInfo,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+	}
+
 }
\ No newline at end of file
@@ -35,7 +35,8 @@ namespace LIB_NAMESPACE
 		);
 		void unmap();
 
-		void write(void *data, uint32_t size);
+		void write(void *data, uint32_t size, VkDeviceSize offset = 0);
+		void *mapped() { return m_memory.mapped(); }
 
 		static Buffer createStagingBuffer(
 			VkDevice device,
@@ -55,6 +56,14 @@ namespace LIB_NAMESPACE
 			VkDeviceSize size
 		);
 
+		// device local buffer filled with transfers, for instance data or indirect draw commands
+		static Buffer createDeviceLocalBuffer(
+			VkDevice device,
+			VkPhysicalDevice physicalDevice,
+			VkDeviceSize size,
+			VkBufferUsageFlags usage
+		);
+
 	private:
 
 		core::Buffer m_buffer;
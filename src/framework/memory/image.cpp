@@ -13,7 +13,7 @@ namespace LIB_NAMESPACE
 		VkImageViewCreateInfo viewInfo
 	):
 		m_image(device, imageInfo),
-		m_memory(device, physicalDevice, properties, m_image.getMemoryRequirements()),
+		m_memory(device, physicalDevice, properties, m_image.getMemoryRequirements(), imageInfo.tiling == VK_IMAGE_TILING_LINEAR),
 		m_image_view(device, setupImageViewCreateInfo(device, viewInfo)),
 		m_width(imageInfo.extent.width),
 		m_height(imageInfo.extent.height),
@@ -42,7 +42,7 @@ namespace LIB_NAMESPACE
 		VkImageViewCreateInfo & viewInfo
 	)
 	{
-		vkBindImageMemory(device, m_image.getVk(), m_memory.getVk(), 0);
+		vkBindImageMemory(device, m_image.getVk(), m_memory.getVk(), m_memory.offset());
 
 		viewInfo.image = m_image.getVk();
 
@@ -126,4 +126,44 @@ namespace LIB_NAMESPACE
 		return Image(device, physicalDevice, imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, viewInfo);
 	}
 
+	Image Image::createStorageImage(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		VkExtent2D extent,
+		VkFormat format
+	)
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent.width = extent.width;
+		imageInfo.extent.height = extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage =
+			VK_IMAGE_USAGE_STORAGE_BIT |
+			VK_IMAGE_USAGE_SAMPLED_BIT |
+			VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = VK_NULL_HANDLE;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		return Image(device, physicalDevice, imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, viewInfo);
+	}
+
 }
\ No newline at end of file
@@ -53,6 +53,14 @@ namespace LIB_NAMESPACE
 			VkFormat format
 		);
 
+		// written by compute shaders, can also be sampled and copied
+		static Image createStorageImage(
+			VkDevice device,
+			VkPhysicalDevice physicalDevice,
+			VkExtent2D extent,
+			VkFormat format
+		);
+
 	private:
 
 		core::Image m_image;
@@ -0,0 +1,622 @@
+#include "mipmap_generator.hpp"
+#include "trace.hpp"
+#include "core/pipeline/shader_module.hpp"
+
+#ifdef CPPVULKANAPI_MIPMAP_SHADER
+#include "mipmap_downsample.spv.hpp"
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	MipmapGenerator::MipmapGenerator(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		const VkPhysicalDeviceFeatures & enabled_features,
+		DescriptorAllocator & descriptor_allocator,
+		VkPipelineCache pipeline_cache
+	):
+		m_device(device),
+		m_physical_device(physicalDevice),
+		m_descriptor_allocator(descriptor_allocator)
+	{
+#ifdef CPPVULKANAPI_MIPMAP_SHADER
+		if (enabled_features.shaderStorageImageWriteWithoutFormat && enabled_features.shaderStorageImageArrayDynamicIndexing)
+		{
+			createPipeline(pipeline_cache);
+		}
+#else
+		(void)enabled_features;
+		(void)pipeline_cache;
+#endif
+	}
+
+	MipmapGenerator::~MipmapGenerator()
+	{
+		// the device is idle when the generator is destroyed
+		for (auto& job : m_jobs)
+		{
+			for (auto& set : job.sets)
+			{
+				m_descriptor_allocator.free(set);
+			}
+		}
+	}
+
+	void MipmapGenerator::createPipeline(VkPipelineCache pipeline_cache)
+	{
+#ifdef CPPVULKANAPI_MIPMAP_SHADER
+		VkDescriptorSetLayoutBinding source{};
+		source.binding = 0;
+		source.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		source.descriptorCount = 1;
+		source.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkDescriptorSetLayoutBinding destination = source;
+		destination.binding = 1;
+		destination.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		destination.descriptorCount = levels_per_dispatch;
+
+		VkDescriptorSetLayoutBinding scratch = source;
+		scratch.binding = 2;
+		scratch.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+		m_set_layout = m_descriptor_allocator.layout({ source, destination, scratch });
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(PushConstants);
+
+		core::PipelineLayout::CreateInfo layoutInfo{};
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &m_set_layout;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		m_pipeline_layout = std::make_unique<core::PipelineLayout>(m_device, layoutInfo);
+
+		core::ShaderModule::CreateInfo shaderInfo{};
+		shaderInfo.codeSize = sizeof(mipmap_downsample_spv);
+		shaderInfo.pCode = mipmap_downsample_spv;
+		core::ShaderModule shaderModule(m_device, shaderInfo);
+
+		core::Pipeline::ComputeCreateInfo pipelineInfo{};
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = shaderModule.getVk();
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = m_pipeline_layout->getVk();
+
+		m_pipeline = std::make_unique<core::Pipeline>(m_device, pipelineInfo, pipeline_cache);
+
+		// counter and one texel per tile of a 4096x4096 base level
+		m_scratch = std::make_unique<Buffer>(Buffer::createDeviceLocalBuffer(
+			m_device,
+			m_physical_device,
+			16 + tile_size * tile_size * 4 * sizeof(float),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+		));
+#else
+		(void)pipeline_cache;
+#endif
+	}
+
+	MipmapGenerator::Method MipmapGenerator::method(VkFormat format) const
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(m_physical_device, format, &properties);
+		VkFormatFeatureFlags features = properties.optimalTilingFeatures;
+
+		if (computeSupported() && (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+		{
+			VkFormatProperties storageProperties;
+			vkGetPhysicalDeviceFormatProperties(m_physical_device, storageFormat(format), &storageProperties);
+			if (storageProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)
+			{
+				return COMPUTE;
+			}
+		}
+
+		VkFormatFeatureFlags blitFeatures =
+			VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+			VK_FORMAT_FEATURE_BLIT_DST_BIT |
+			VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		if ((features & blitFeatures) == blitFeatures)
+		{
+			return BLIT;
+		}
+
+		return CPU;
+	}
+
+	VkImageUsageFlags MipmapGenerator::imageUsage(Method method)
+	{
+		return method == COMPUTE ? VK_IMAGE_USAGE_STORAGE_BIT : 0;
+	}
+
+	VkImageCreateFlags MipmapGenerator::imageFlags(Method method, VkFormat format)
+	{
+		// the sRGB image is stored to through UNORM views, its own views can not have the storage usage
+		if (method == COMPUTE && storageFormat(format) != format)
+		{
+			return VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+		}
+		return 0;
+	}
+
+	VkFormat MipmapGenerator::storageFormat(VkFormat format)
+	{
+		switch (format)
+		{
+			case VK_FORMAT_R8G8B8A8_SRGB: return VK_FORMAT_R8G8B8A8_UNORM;
+			case VK_FORMAT_B8G8R8A8_SRGB: return VK_FORMAT_B8G8R8A8_UNORM;
+			case VK_FORMAT_A8B8G8R8_SRGB_PACK32: return VK_FORMAT_A8B8G8R8_UNORM_PACK32;
+			default: return format;
+		}
+	}
+
+	void MipmapGenerator::generate(Command & command, Image & image, Method method)
+	{
+		TRACE_ZONE("generate mipmaps");
+
+		releaseCompletedJobs(command);
+
+		if (image.mipLevels() == 1 || method == CPU)
+		{
+			command.transitionImageLayout(
+				image.image(),
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				image.mipLevels(),
+				VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+			);
+		}
+		else if (method == COMPUTE)
+		{
+			generateCompute(command, image);
+		}
+		else
+		{
+			generateBlit(command, image);
+		}
+	}
+
+	void MipmapGenerator::generateCompute(Command & command, Image & image)
+	{
+		VkCommandBuffer commandBuffer = command.batchCommandBuffer();
+
+		Job job;
+		job.ticket = command.batchTicket();
+
+		if (m_scratch_cleared == false)
+		{
+			vkCmdFillBuffer(commandBuffer, m_scratch->buffer(), 0, VK_WHOLE_SIZE, 0);
+			m_scratch_cleared = true;
+		}
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.image = image.image();
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = image.mipLevels();
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		// the scratch buffer is also written by the clear and the dispatches of the previous textures
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			1, &memoryBarrier,
+			0, nullptr,
+			1, &barrier
+		);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline->getVk());
+
+		VkFormat format = storageFormat(image.format());
+		bool srgb = format != image.format();
+
+		uint32_t baseLevel = 0;
+		while (baseLevel + 1 < image.mipLevels())
+		{
+			uint32_t width = std::max(image.width() >> baseLevel, 1u);
+			uint32_t height = std::max(image.height() >> baseLevel, 1u);
+			uint32_t groupCountX = (width + tile_size - 1) / tile_size;
+			uint32_t groupCountY = (height + tile_size - 1) / tile_size;
+
+			uint32_t levelCount = std::min(image.mipLevels() - 1 - baseLevel, levels_per_dispatch);
+			if (groupCountX > tile_size || groupCountY > tile_size)
+			{
+				// one tile result per workgroup would not fit the scratch buffer, no last workgroup pass
+				levelCount = std::min(levelCount, levels_per_dispatch / 2);
+			}
+
+			std::array<VkDescriptorImageInfo, levels_per_dispatch> destinationInfos{};
+			for (uint32_t i = 0; i < levels_per_dispatch; i++)
+			{
+				// the unused elements repeat the last level, the shader never stores to them
+				if (i < levelCount)
+				{
+					VkImageViewCreateInfo viewInfo{};
+					viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+					viewInfo.image = image.image();
+					viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+					viewInfo.format = format;
+					viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					viewInfo.subresourceRange.baseMipLevel = baseLevel + 1 + i;
+					viewInfo.subresourceRange.levelCount = 1;
+					viewInfo.subresourceRange.baseArrayLayer = 0;
+					viewInfo.subresourceRange.layerCount = 1;
+
+					job.views.push_back(std::make_unique<core::ImageView>(m_device, viewInfo));
+				}
+				destinationInfos[i].imageView = job.views.back()->getVk();
+				destinationInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			}
+
+			DescriptorAllocator::Allocation set = m_descriptor_allocator.allocate(m_set_layout);
+			job.sets.push_back(set);
+
+			VkDescriptorImageInfo sourceInfo{};
+			sourceInfo.imageView = image.view();
+			sourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			VkDescriptorBufferInfo scratchInfo{};
+			scratchInfo.buffer = m_scratch->buffer();
+			scratchInfo.offset = 0;
+			scratchInfo.range = VK_WHOLE_SIZE;
+
+			std::array<VkWriteDescriptorSet, 3> writes{};
+			for (uint32_t i = 0; i < writes.size(); i++)
+			{
+				writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[i].dstSet = set.set;
+				writes[i].dstBinding = i;
+				writes[i].dstArrayElement = 0;
+				writes[i].descriptorCount = 1;
+			}
+			writes[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			writes[0].pImageInfo = &sourceInfo;
+			writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			writes[1].descriptorCount = levels_per_dispatch;
+			writes[1].pImageInfo = destinationInfos.data();
+			writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[2].pBufferInfo = &scratchInfo;
+
+			vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+			PushConstants constants{};
+			constants.base_width = static_cast<int32_t>(width);
+			constants.base_height = static_cast<int32_t>(height);
+			constants.base_level = static_cast<int32_t>(baseLevel);
+			constants.level_count = static_cast<int32_t>(levelCount);
+			constants.srgb = srgb ? 1 : 0;
+			constants.group_count = static_cast<int32_t>(groupCountX * groupCountY);
+
+			vkCmdBindDescriptorSets(
+				commandBuffer,
+				VK_PIPELINE_BIND_POINT_COMPUTE,
+				m_pipeline_layout->getVk(),
+				0, 1, &set.set,
+				0, nullptr
+			);
+			vkCmdPushConstants(
+				commandBuffer,
+				m_pipeline_layout->getVk(),
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				0, sizeof(constants),
+				&constants
+			);
+			vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+
+			baseLevel += levelCount;
+			if (baseLevel + 1 < image.mipLevels())
+			{
+				// the next dispatch reads the last level written by this one
+				memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+				vkCmdPipelineBarrier(
+					commandBuffer,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					0,
+					1, &memoryBarrier,
+					0, nullptr,
+					0, nullptr
+				);
+			}
+		}
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+
+		m_jobs.push_back(std::move(job));
+	}
+
+	void MipmapGenerator::generateBlit(Command & command, Image & image)
+	{
+		VkCommandBuffer commandBuffer = command.batchCommandBuffer();
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.image = image.image();
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.subresourceRange.levelCount = 1;
+
+		int32_t mipWidth = static_cast<int32_t>(image.width());
+		int32_t mipHeight = static_cast<int32_t>(image.height());
+		uint32_t mipLevels = image.mipLevels();
+
+		for (uint32_t i = 1; i < mipLevels; i++)
+		{
+			barrier.subresourceRange.baseMipLevel = i - 1;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier
+			);
+
+			VkImageBlit blit{};
+			blit.srcOffsets[0] = {0, 0, 0};
+			blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = i - 1;
+			blit.srcSubresource.baseArrayLayer = 0;
+			blit.srcSubresource.layerCount = 1;
+
+			blit.dstOffsets[0] = {0, 0, 0};
+			blit.dstOffsets[1] = {
+				mipWidth > 1 ? mipWidth / 2 : 1,
+				mipHeight > 1 ? mipHeight / 2 : 1,
+				1
+			};
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = i;
+			blit.dstSubresource.baseArrayLayer = 0;
+			blit.dstSubresource.layerCount = 1;
+
+			vkCmdBlitImage(
+				commandBuffer,
+				image.image(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				image.image(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit,
+				VK_FILTER_LINEAR
+			);
+
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier
+			);
+
+			if (mipWidth > 1) mipWidth /= 2;
+			if (mipHeight > 1) mipHeight /= 2;
+		}
+
+		barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+	}
+
+	void MipmapGenerator::releaseCompletedJobs(Command & command)
+	{
+		while (m_jobs.empty() == false && command.isComplete(m_jobs.front().ticket))
+		{
+			for (auto& set : m_jobs.front().sets)
+			{
+				m_descriptor_allocator.free(set);
+			}
+			m_jobs.pop_front();
+		}
+	}
+
+	std::vector<unsigned char> MipmapGenerator::downsample(
+		const unsigned char *pixels,
+		uint32_t width,
+		uint32_t height,
+		uint32_t mip_levels,
+		bool srgb
+	)
+	{
+		TRACE_ZONE("downsample mipmaps");
+
+		VkDeviceSize size = 0;
+		for (uint32_t level = 0; level < mip_levels; level++)
+		{
+			size += static_cast<VkDeviceSize>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+		}
+
+		std::vector<unsigned char> levels(size);
+		std::copy(pixels, pixels + static_cast<size_t>(width) * height * 4, levels.begin());
+
+		unsigned char *src = levels.data();
+		for (uint32_t level = 1; level < mip_levels; level++)
+		{
+			uint32_t srcWidth = std::max(width >> (level - 1), 1u);
+			uint32_t srcHeight = std::max(height >> (level - 1), 1u);
+			unsigned char *dst = src + static_cast<size_t>(srcWidth) * srcHeight * 4;
+
+			downsampleLevel(src, srcWidth, srcHeight, dst, srgb);
+			src = dst;
+		}
+
+		return levels;
+	}
+
+	namespace
+	{
+		// sRGB to 16 bits linear, and 12 bits linear back to sRGB, each entry of to_srgb converts the middle of its range
+		struct SrgbTables
+		{
+			std::array<uint16_t, 256> to_linear;
+			std::array<uint8_t, 4096> to_srgb;
+
+			SrgbTables()
+			{
+				for (uint32_t i = 0; i < to_linear.size(); i++)
+				{
+					float c = i / 255.0f;
+					float linear = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+					to_linear[i] = static_cast<uint16_t>(std::lround(linear * 65535.0f));
+				}
+				for (uint32_t i = 0; i < to_srgb.size(); i++)
+				{
+					float linear = (i + 0.5f) / to_srgb.size();
+					float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+					to_srgb[i] = static_cast<uint8_t>(std::lround(std::min(c, 1.0f) * 255.0f));
+				}
+			}
+		};
+	}
+
+	void MipmapGenerator::downsampleLevel(
+		const unsigned char *src,
+		uint32_t width,
+		uint32_t height,
+		unsigned char *dst,
+		bool srgb
+	)
+	{
+		static const SrgbTables tables;
+
+		uint32_t dstWidth = std::max(width >> 1, 1u);
+		uint32_t dstHeight = std::max(height >> 1, 1u);
+
+		for (uint32_t y = 0; y < dstHeight; y++)
+		{
+			// an odd last row or column is dropped, a single one is repeated
+			const unsigned char *row0 = src + static_cast<size_t>(2 * y) * width * 4;
+			const unsigned char *row1 = height > 1 ? row0 + static_cast<size_t>(width) * 4 : row0;
+			uint32_t step = width > 1 ? 4 : 0;
+			unsigned char *out = dst + static_cast<size_t>(y) * dstWidth * 4;
+
+			uint32_t x = 0;
+#if defined(__SSE2__)
+			// 4 output pixels from 8x2 input pixels, rounded like the scalar path
+			// sRGB stays scalar: its cost is the 15 table lookups per pixel, which SSE2 can not gather
+			if (srgb == false && width > 1)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i two = _mm_set1_epi16(2);
+				for (; x + 4 <= dstWidth; x += 4)
+				{
+					__m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + x * 8));
+					__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + x * 8 + 16));
+					__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + x * 8));
+					__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + x * 8 + 16));
+
+					// vertical sums, two pixels per register
+					__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+					__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+					__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+					__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+					// horizontal sums in the low half
+					s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+					s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+					s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+					s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+
+					__m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s0, s1), two), 2);
+					__m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s2, s3), two), 2);
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(out + x * 4), _mm_packus_epi16(lo, hi));
+				}
+			}
+#endif
+			if (srgb)
+			{
+				for (; x < dstWidth; x++)
+				{
+					const unsigned char *p0 = row0 + x * 8;
+					const unsigned char *p1 = row1 + x * 8;
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						// the sum of 4 16 bits values, its top 12 bits select the range, at most 4095
+						uint32_t sum =
+							tables.to_linear[p0[c]] + tables.to_linear[p0[c + step]] +
+							tables.to_linear[p1[c]] + tables.to_linear[p1[c + step]];
+						out[x * 4 + c] = tables.to_srgb[sum >> 6];
+					}
+					out[x * 4 + 3] = static_cast<unsigned char>((p0[3] + p0[3 + step] + p1[3] + p1[3 + step] + 2) >> 2);
+				}
+			}
+			for (; x < dstWidth; x++)
+			{
+				const unsigned char *p0 = row0 + x * 8;
+				const unsigned char *p1 = row1 + x * 8;
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					out[x * 4 + c] = static_cast<unsigned char>((p0[c] + p0[c + step] + p1[c] + p1[c + step] + 2) >> 2);
+				}
+			}
+		}
+	}
+}
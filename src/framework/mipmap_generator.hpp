@@ -0,0 +1,129 @@
+#pragma once
+
+#include "defines.hpp"
+#include "command.hpp"
+#include "memory/image.hpp"
+#include "memory/buffer.hpp"
+#include "descriptor/descriptor_allocator.hpp"
+#include "core/pipeline/graphic_pipeline.hpp"
+#include "core/pipeline/pipeline_layout.hpp"
+#include "core/image/image_view.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// Mip chains of textures, recorded in the upload batch of a Command so every texture loaded
+	// before a flush is processed by the same submit.
+	// COMPUTE builds up to 12 levels per dispatch, see shaders/mipmap_downsample.comp, for formats
+	// with storage image support, sRGB ones through a UNORM alias of the image.
+	// BLIT issues one blit per level, for formats that can not be stored but can be filtered.
+	// CPU box-filters RGBA8 pixels before the upload, for formats that can be neither.
+	class MipmapGenerator
+	{
+
+	public:
+
+		enum Method
+		{
+			COMPUTE,
+			BLIT,
+			CPU
+		};
+
+		// compute is only used when the library was built with the shader and the device enabled
+		// shaderStorageImageWriteWithoutFormat and shaderStorageImageArrayDynamicIndexing
+		MipmapGenerator(
+			VkDevice device,
+			VkPhysicalDevice physicalDevice,
+			const VkPhysicalDeviceFeatures & enabled_features,
+			DescriptorAllocator & descriptor_allocator,
+			VkPipelineCache pipeline_cache = VK_NULL_HANDLE
+		);
+		MipmapGenerator(const MipmapGenerator &) = delete;
+		MipmapGenerator(MipmapGenerator && other) = delete;
+		MipmapGenerator & operator=(const MipmapGenerator &) = delete;
+		MipmapGenerator & operator=(MipmapGenerator && other) = delete;
+		~MipmapGenerator();
+
+		bool computeSupported() const { return m_pipeline != nullptr; }
+
+		Method method(VkFormat format) const;
+		// the image of a texture generated with COMPUTE needs them
+		static VkImageUsageFlags imageUsage(Method method);
+		static VkImageCreateFlags imageFlags(Method method, VkFormat format);
+		// format the compute shader stores to, the UNORM alias of an sRGB format
+		static VkFormat storageFormat(VkFormat format);
+
+		// Every level of the image must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL with level 0 uploaded,
+		// every level of it for CPU. They are all left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+		void generate(Command & command, Image & image, Method method);
+
+		// level 0 followed by each smaller level of RGBA8 pixels, 2x2 box filter
+		// sRGB pixels are averaged in linear space
+		static std::vector<unsigned char> downsample(
+			const unsigned char *pixels,
+			uint32_t width,
+			uint32_t height,
+			uint32_t mip_levels,
+			bool srgb
+		);
+
+	private:
+
+		// up to 12 levels per dispatch, 64x64 tiles of the base level
+		static constexpr uint32_t levels_per_dispatch = 12;
+		static constexpr uint32_t tile_size = 64;
+
+		struct PushConstants
+		{
+			int32_t base_width;
+			int32_t base_height;
+			int32_t base_level;
+			int32_t level_count;
+			int32_t srgb;
+			int32_t group_count;
+		};
+
+		// views and sets of the dispatches of one batch, released once it has completed
+		struct Job
+		{
+			uint64_t ticket;
+			std::vector<std::unique_ptr<core::ImageView>> views;
+			std::vector<DescriptorAllocator::Allocation> sets;
+		};
+
+		VkDevice m_device;
+		VkPhysicalDevice m_physical_device;
+		DescriptorAllocator & m_descriptor_allocator;
+
+		VkDescriptorSetLayout m_set_layout = VK_NULL_HANDLE;
+		std::unique_ptr<core::PipelineLayout> m_pipeline_layout;
+		std::unique_ptr<core::Pipeline> m_pipeline;
+
+		// finished workgroup counter and the level 6 results of every tile
+		std::unique_ptr<Buffer> m_scratch;
+		bool m_scratch_cleared = false;
+
+		std::deque<Job> m_jobs;
+
+		void createPipeline(VkPipelineCache pipeline_cache);
+		void releaseCompletedJobs(Command & command);
+
+		void generateCompute(Command & command, Image & image);
+		void generateBlit(Command & command, Image & image);
+
+		static void downsampleLevel(
+			const unsigned char *src,
+			uint32_t width,
+			uint32_t height,
+			unsigned char *dst,
+			bool srgb
+		);
+
+	};
+}
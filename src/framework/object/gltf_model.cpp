@@ -0,0 +1,592 @@
+#include "gltf_model.hpp"
+
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#include <tiny_gltf.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <stdexcept>
+#include <cstring>
+
+namespace LIB_NAMESPACE
+{
+	namespace
+	{
+		// every glTF buffer starts on this alignment in the GPU buffer, enough for any vertex or index format
+		const VkDeviceSize buffer_alignment = 16;
+
+		VkDeviceSize align(VkDeviceSize value)
+		{
+			return (value + buffer_alignment - 1) / buffer_alignment * buffer_alignment;
+		}
+
+		class Reader
+		{
+
+		public:
+
+			Reader(tinygltf::Model & model, GltfModel::CreateInfo & createInfo):
+				m_model(model),
+				m_createInfo(createInfo)
+			{
+				// the glTF buffers keep their bytes, only their position in the GPU buffer is decided here
+				VkDeviceSize offset = 0;
+				for (auto& buffer : m_model.buffers)
+				{
+					m_buffer_offsets.push_back(offset);
+					offset = align(offset + buffer.data.size());
+				}
+				m_converted_offset = offset;
+
+				// zeros read with a stride of 0 stand in for missing attributes
+				m_converted.resize(buffer_alignment, 0);
+			}
+
+			void read()
+			{
+				readImages();
+				readMaterials();
+				readMeshes();
+				readNodes();
+
+				for (auto& buffer : m_model.buffers)
+				{
+					m_createInfo.buffers.push_back(std::move(buffer.data));
+				}
+				m_createInfo.buffers.push_back(std::move(m_converted));
+				m_createInfo.buffer_offsets = m_buffer_offsets;
+				m_createInfo.buffer_offsets.push_back(m_converted_offset);
+			}
+
+		private:
+
+			tinygltf::Model & m_model;
+			GltfModel::CreateInfo & m_createInfo;
+
+			std::vector<VkDeviceSize> m_buffer_offsets;
+			VkDeviceSize m_converted_offset;
+			std::vector<unsigned char> m_converted;
+
+			void readImages()
+			{
+				for (auto& image : m_model.images)
+				{
+					GltfModel::Image gltfImage;
+					gltfImage.width = image.width;
+					gltfImage.height = image.height;
+
+					size_t pixel_count = static_cast<size_t>(image.width) * image.height;
+					if (image.image.empty() || image.component <= 0)
+					{
+						throw std::runtime_error("failed to load gltf image: " + image.uri);
+					}
+
+					if (image.bits == 8 && image.component == 4)
+					{
+						gltfImage.pixels = std::move(image.image);
+					}
+					else
+					{
+						// 16 bits or less than 4 channels, keep the high byte and fill alpha
+						size_t channel_size = image.bits / 8;
+						gltfImage.pixels.resize(pixel_count * 4);
+						for (size_t i = 0; i < pixel_count; i++)
+						{
+							for (int c = 0; c < 4; c++)
+							{
+								unsigned char value = 255;
+								if (c < image.component)
+								{
+									size_t byte = (i * image.component + c) * channel_size + channel_size - 1;
+									value = image.image[byte];
+								}
+								gltfImage.pixels[i * 4 + c] = value;
+							}
+						}
+					}
+
+					m_createInfo.images.push_back(std::move(gltfImage));
+				}
+			}
+
+			int32_t textureImage(int texture_index)
+			{
+				if (texture_index < 0 || texture_index >= static_cast<int>(m_model.textures.size()))
+				{
+					return -1;
+				}
+				int32_t image_index = m_model.textures[texture_index].source;
+				return image_index < static_cast<int>(m_model.images.size()) ? image_index : -1;
+			}
+
+			void readMaterials()
+			{
+				for (auto& material : m_model.materials)
+				{
+					auto& pbr = material.pbrMetallicRoughness;
+
+					GltfModel::Material gltfMaterial;
+					gltfMaterial.base_color_factor = glm::vec4(
+						static_cast<float>(pbr.baseColorFactor[0]),
+						static_cast<float>(pbr.baseColorFactor[1]),
+						static_cast<float>(pbr.baseColorFactor[2]),
+						static_cast<float>(pbr.baseColorFactor[3])
+					);
+					gltfMaterial.metallic_factor = static_cast<float>(pbr.metallicFactor);
+					gltfMaterial.roughness_factor = static_cast<float>(pbr.roughnessFactor);
+
+					gltfMaterial.base_color_image = textureImage(pbr.baseColorTexture.index);
+					gltfMaterial.metallic_roughness_image = textureImage(pbr.metallicRoughnessTexture.index);
+					gltfMaterial.normal_image = textureImage(material.normalTexture.index);
+
+					if (gltfMaterial.base_color_image >= 0)
+					{
+						m_createInfo.images[gltfMaterial.base_color_image].srgb = true;
+					}
+
+					m_createInfo.materials.push_back(gltfMaterial);
+				}
+			}
+
+			const tinygltf::Accessor & accessor(int index)
+			{
+				if (index < 0 || index >= static_cast<int>(m_model.accessors.size()))
+				{
+					throw std::runtime_error("failed to load gltf: invalid accessor.");
+				}
+
+				const tinygltf::Accessor & accessor = m_model.accessors[index];
+				if (accessor.sparse.isSparse || accessor.bufferView < 0)
+				{
+					throw std::runtime_error("failed to load gltf: sparse accessors are not supported.");
+				}
+
+				// the GPU reads these bytes directly, make sure they are inside the buffer
+				const tinygltf::BufferView & view = m_model.bufferViews.at(accessor.bufferView);
+				int stride = accessor.ByteStride(view);
+				size_t element_size = tinygltf::GetComponentSizeInBytes(accessor.componentType)
+					* tinygltf::GetNumComponentsInType(accessor.type);
+				if (
+					stride <= 0
+					|| view.buffer < 0 || view.buffer >= static_cast<int>(m_model.buffers.size())
+					|| (accessor.count > 0 && view.byteOffset + accessor.byteOffset + (accessor.count - 1) * stride + element_size
+						> m_model.buffers[view.buffer].data.size())
+				)
+				{
+					throw std::runtime_error("failed to load gltf: accessor out of its buffer.");
+				}
+				return accessor;
+			}
+
+			VkDeviceSize accessorOffset(const tinygltf::Accessor & accessor)
+			{
+				const tinygltf::BufferView & view = m_model.bufferViews[accessor.bufferView];
+				return m_buffer_offsets[view.buffer] + view.byteOffset + accessor.byteOffset;
+			}
+
+			const unsigned char *accessorData(const tinygltf::Accessor & accessor)
+			{
+				const tinygltf::BufferView & view = m_model.bufferViews[accessor.bufferView];
+				return m_model.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset;
+			}
+
+			VkDeviceSize appendConverted(const void *data, size_t size)
+			{
+				size_t offset = align(m_converted.size());
+				m_converted.resize(offset + size);
+				std::memcpy(m_converted.data() + offset, data, size);
+				return m_converted_offset + offset;
+			}
+
+			static float readComponent(const unsigned char *data, int component_type, bool normalized)
+			{
+				switch (component_type)
+				{
+					case TINYGLTF_COMPONENT_TYPE_FLOAT:
+					{
+						float value;
+						std::memcpy(&value, data, sizeof(value));
+						return value;
+					}
+					case TINYGLTF_COMPONENT_TYPE_BYTE:
+					{
+						float value = static_cast<float>(*reinterpret_cast<const int8_t *>(data));
+						return normalized ? std::max(value / 127.0f, -1.0f) : value;
+					}
+					case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+					{
+						float value = static_cast<float>(*data);
+						return normalized ? value / 255.0f : value;
+					}
+					case TINYGLTF_COMPONENT_TYPE_SHORT:
+					{
+						int16_t raw;
+						std::memcpy(&raw, data, sizeof(raw));
+						float value = static_cast<float>(raw);
+						return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+					}
+					case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+					{
+						uint16_t raw;
+						std::memcpy(&raw, data, sizeof(raw));
+						float value = static_cast<float>(raw);
+						return normalized ? value / 65535.0f : value;
+					}
+					default:
+						throw std::runtime_error("failed to load gltf: unsupported attribute component type.");
+				}
+			}
+
+			// float attributes are read in place, anything else is converted to floats once
+			void readAttribute(
+				const tinygltf::Primitive & primitive,
+				const char *name,
+				int component_count,
+				GltfModel::Attribute attribute,
+				GltfModel::Primitive & gltfPrimitive
+			)
+			{
+				auto it = primitive.attributes.find(name);
+				if (it == primitive.attributes.end())
+				{
+					gltfPrimitive.attribute_offsets[attribute] = m_converted_offset;
+					gltfPrimitive.attribute_strides[attribute] = 0;
+					return;
+				}
+
+				const tinygltf::Accessor & attributeAccessor = accessor(it->second);
+				const tinygltf::BufferView & view = m_model.bufferViews[attributeAccessor.bufferView];
+				int stride = attributeAccessor.ByteStride(view);
+
+				if (tinygltf::GetNumComponentsInType(attributeAccessor.type) != component_count)
+				{
+					throw std::runtime_error("failed to load gltf: unexpected " + std::string(name) + " type.");
+				}
+				// every stream is read for vertex_count vertices
+				if (attributeAccessor.count != gltfPrimitive.vertex_count)
+				{
+					throw std::runtime_error("failed to load gltf: " + std::string(name) + " count differs from POSITION count.");
+				}
+
+				if (attributeAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+				{
+					gltfPrimitive.attribute_offsets[attribute] = accessorOffset(attributeAccessor);
+					gltfPrimitive.attribute_strides[attribute] = stride;
+					return;
+				}
+
+				const unsigned char *data = accessorData(attributeAccessor);
+				int component_size = tinygltf::GetComponentSizeInBytes(attributeAccessor.componentType);
+
+				std::vector<float> values(attributeAccessor.count * component_count);
+				for (size_t i = 0; i < attributeAccessor.count; i++)
+				{
+					for (int c = 0; c < component_count; c++)
+					{
+						values[i * component_count + c] = readComponent(
+							data + i * stride + c * component_size,
+							attributeAccessor.componentType,
+							attributeAccessor.normalized
+						);
+					}
+				}
+
+				gltfPrimitive.attribute_offsets[attribute] = appendConverted(values.data(), values.size() * sizeof(float));
+				gltfPrimitive.attribute_strides[attribute] = component_count * sizeof(float);
+			}
+
+			void readIndices(const tinygltf::Primitive & primitive, GltfModel::Primitive & gltfPrimitive)
+			{
+				if (primitive.indices < 0)
+				{
+					return;
+				}
+
+				const tinygltf::Accessor & indexAccessor = accessor(primitive.indices);
+				gltfPrimitive.index_count = static_cast<uint32_t>(indexAccessor.count);
+
+				// the indices are on the CPU anyway, a vertex past the attribute streams would be read by the GPU
+				const unsigned char *data = accessorData(indexAccessor);
+				int index_size = tinygltf::GetComponentSizeInBytes(indexAccessor.componentType);
+				uint32_t max_index = 0;
+				for (size_t i = 0; i < indexAccessor.count; i++)
+				{
+					uint32_t index = 0;
+					switch (indexAccessor.componentType)
+					{
+						case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+							std::memcpy(&index, data + i * index_size, sizeof(uint32_t));
+							break;
+
+						case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+						{
+							uint16_t value;
+							std::memcpy(&value, data + i * index_size, sizeof(uint16_t));
+							index = value;
+							break;
+						}
+
+						case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+							index = data[i];
+							break;
+
+						default:
+							throw std::runtime_error("failed to load gltf: unsupported index type.");
+					}
+					max_index = std::max(max_index, index);
+				}
+				if (indexAccessor.count > 0 && max_index >= gltfPrimitive.vertex_count)
+				{
+					throw std::runtime_error("failed to load gltf: index out of the vertices.");
+				}
+
+				switch (indexAccessor.componentType)
+				{
+					case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+						gltfPrimitive.index_type = VK_INDEX_TYPE_UINT32;
+						gltfPrimitive.index_offset = accessorOffset(indexAccessor);
+						break;
+
+					case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+						gltfPrimitive.index_type = VK_INDEX_TYPE_UINT16;
+						gltfPrimitive.index_offset = accessorOffset(indexAccessor);
+						break;
+
+					case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+					{
+						// 8 bits indices need an extension, widen them to 16 bits
+						std::vector<uint16_t> indices(data, data + indexAccessor.count);
+
+						gltfPrimitive.index_type = VK_INDEX_TYPE_UINT16;
+						gltfPrimitive.index_offset = appendConverted(indices.data(), indices.size() * sizeof(uint16_t));
+						break;
+					}
+
+					default:
+						throw std::runtime_error("failed to load gltf: unsupported index type.");
+				}
+			}
+
+			void readMeshes()
+			{
+				for (auto& mesh : m_model.meshes)
+				{
+					GltfModel::Mesh gltfMesh;
+
+					for (auto& primitive : mesh.primitives)
+					{
+						// pipelines are built for triangle lists
+						if (primitive.mode != TINYGLTF_MODE_TRIANGLES)
+						{
+							continue;
+						}
+
+						auto position = primitive.attributes.find("POSITION");
+						if (position == primitive.attributes.end())
+						{
+							continue;
+						}
+
+						GltfModel::Primitive gltfPrimitive;
+						gltfPrimitive.vertex_count = static_cast<uint32_t>(accessor(position->second).count);
+						gltfPrimitive.material = primitive.material;
+
+						readAttribute(primitive, "POSITION", 3, GltfModel::POSITION, gltfPrimitive);
+						readAttribute(primitive, "NORMAL", 3, GltfModel::NORMAL, gltfPrimitive);
+						readAttribute(primitive, "TEXCOORD_0", 2, GltfModel::TEXCOORD, gltfPrimitive);
+						readIndices(primitive, gltfPrimitive);
+
+						gltfMesh.primitives.push_back(gltfPrimitive);
+					}
+
+					m_createInfo.meshes.push_back(std::move(gltfMesh));
+				}
+			}
+
+			static glm::mat4 localTransform(const tinygltf::Node & node)
+			{
+				if (node.matrix.size() == 16)
+				{
+					return glm::mat4(glm::make_mat4(node.matrix.data()));
+				}
+
+				glm::mat4 transform(1.0f);
+				if (node.translation.size() == 3)
+				{
+					transform = glm::translate(transform, glm::vec3(
+						static_cast<float>(node.translation[0]),
+						static_cast<float>(node.translation[1]),
+						static_cast<float>(node.translation[2])
+					));
+				}
+				if (node.rotation.size() == 4)
+				{
+					// glTF stores x, y, z, w and glm::quat takes w first
+					transform = transform * glm::mat4_cast(glm::quat(
+						static_cast<float>(node.rotation[3]),
+						static_cast<float>(node.rotation[0]),
+						static_cast<float>(node.rotation[1]),
+						static_cast<float>(node.rotation[2])
+					));
+				}
+				if (node.scale.size() == 3)
+				{
+					transform = glm::scale(transform, glm::vec3(
+						static_cast<float>(node.scale[0]),
+						static_cast<float>(node.scale[1]),
+						static_cast<float>(node.scale[2])
+					));
+				}
+				return transform;
+			}
+
+			void readNode(int node_index, const glm::mat4 & parent_transform, uint32_t depth)
+			{
+				// a node hierarchy is a tree, a deeper recursion means a cycle
+				if (node_index < 0 || node_index >= static_cast<int>(m_model.nodes.size()) || depth > m_model.nodes.size())
+				{
+					throw std::runtime_error("failed to load gltf: invalid node hierarchy.");
+				}
+
+				const tinygltf::Node & node = m_model.nodes[node_index];
+				glm::mat4 transform = parent_transform * localTransform(node);
+
+				if (node.mesh >= 0 && node.mesh < static_cast<int>(m_model.meshes.size()))
+				{
+					GltfModel::Node gltfNode;
+					gltfNode.transform = transform;
+					gltfNode.mesh = static_cast<uint32_t>(node.mesh);
+					m_createInfo.nodes.push_back(gltfNode);
+				}
+
+				for (int child : node.children)
+				{
+					readNode(child, transform, depth + 1);
+				}
+			}
+
+			void readNodes()
+			{
+				std::vector<int> roots;
+
+				if (m_model.scenes.empty() == false)
+				{
+					int scene = m_model.defaultScene >= 0 ? m_model.defaultScene : 0;
+					roots = m_model.scenes[scene].nodes;
+				}
+				else
+				{
+					// without scenes every node that is nobody's child is a root
+					std::vector<bool> is_child(m_model.nodes.size(), false);
+					for (auto& node : m_model.nodes)
+					{
+						for (int child : node.children)
+						{
+							if (child >= 0 && child < static_cast<int>(is_child.size()))
+							{
+								is_child[child] = true;
+							}
+						}
+					}
+					for (size_t i = 0; i < m_model.nodes.size(); i++)
+					{
+						if (is_child[i] == false)
+						{
+							roots.push_back(static_cast<int>(i));
+						}
+					}
+				}
+
+				for (int root : roots)
+				{
+					readNode(root, glm::mat4(1.0f), 0);
+				}
+			}
+
+		};
+	}
+
+	GltfModel::GltfModel(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		Command& command,
+		CreateInfo& createInfo
+	):
+		m_meshes(std::move(createInfo.meshes)),
+		m_materials(std::move(createInfo.materials)),
+		m_nodes(std::move(createInfo.nodes))
+	{
+		VkDeviceSize bufferSize = 0;
+		for (size_t i = 0; i < createInfo.buffers.size(); i++)
+		{
+			bufferSize = std::max(bufferSize, createInfo.buffer_offsets[i] + createInfo.buffers[i].size());
+		}
+
+		Buffer stagingBuffer = Buffer::createStagingBuffer(
+			device,
+			physicalDevice,
+			bufferSize
+		);
+
+		// one copy per glTF buffer, the vertex data is not touched
+		stagingBuffer.map();
+		for (size_t i = 0; i < createInfo.buffers.size(); i++)
+		{
+			stagingBuffer.write(
+				createInfo.buffers[i].data(),
+				static_cast<uint32_t>(createInfo.buffers[i].size()),
+				createInfo.buffer_offsets[i]
+			);
+		}
+		stagingBuffer.unmap();
+
+		m_buffer = std::make_unique<Buffer>(Buffer::createDeviceLocalBuffer(
+			device,
+			physicalDevice,
+			bufferSize,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+		));
+
+		VkBufferCopy copyRegion = {};
+		copyRegion.size = bufferSize;
+
+		command.uploadBuffer(stagingBuffer.buffer(), m_buffer->buffer(), 1, &copyRegion);
+		command.keepAlive(std::move(stagingBuffer));
+	}
+
+	GltfModel::GltfModel(GltfModel && other):
+		m_buffer(std::move(other.m_buffer)),
+		m_meshes(std::move(other.m_meshes)),
+		m_materials(std::move(other.m_materials)),
+		m_nodes(std::move(other.m_nodes))
+	{
+	}
+
+	GltfModel::~GltfModel()
+	{
+	}
+
+	GltfModel::CreateInfo GltfModel::readFile(const std::string & filename)
+	{
+		tinygltf::TinyGLTF loader;
+		tinygltf::Model model;
+		std::string error, warning;
+
+		bool binary = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".glb") == 0;
+		bool loaded = binary
+			? loader.LoadBinaryFromFile(&model, &error, &warning, filename)
+			: loader.LoadASCIIFromFile(&model, &error, &warning, filename);
+
+		if (loaded == false)
+		{
+			throw std::runtime_error("failed to load gltf: " + filename + ": " + warning + error);
+		}
+
+		CreateInfo createInfo;
+		Reader(model, createInfo).read();
+		return createInfo;
+	}
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "defines.hpp"
+#include "framework/memory/buffer.hpp"
+#include "framework/command.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// Meshes, materials and node transforms of a glTF 2.0 file (.gltf or .glb).
+	// The glTF buffers are copied as they are into a single GPU buffer used for both vertices and indices,
+	// primitives only keep offsets and strides into it, so vertices are never re-packed.
+	// Attributes in a format the pipeline can not read (normalized integers, 8 bits indices)
+	// are the only data converted, and appended after the glTF buffers.
+	// Pipelines drawing glTF meshes need Pipeline::CreateInfo::separate_vertex_streams.
+	class GltfModel
+	{
+
+	public:
+
+		// attribute streams read by the pipeline, bound to vertex bindings 0, 2 and 3
+		enum Attribute
+		{
+			POSITION = 0,
+			NORMAL = 1,
+			TEXCOORD = 2,
+			ATTRIBUTE_COUNT = 3
+		};
+
+		struct Primitive
+		{
+			// a missing attribute points at zeros with a stride of 0
+			std::array<VkDeviceSize, ATTRIBUTE_COUNT> attribute_offsets = {};
+			std::array<VkDeviceSize, ATTRIBUTE_COUNT> attribute_strides = {};
+			uint32_t vertex_count = 0;
+
+			// index_count 0 when the primitive is not indexed
+			VkDeviceSize index_offset = 0;
+			VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+			uint32_t index_count = 0;
+
+			int32_t material = -1;
+		};
+
+		struct Mesh
+		{
+			std::vector<Primitive> primitives;
+		};
+
+		struct Material
+		{
+			glm::vec4 base_color_factor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+			float metallic_factor = 1.0f;
+			float roughness_factor = 1.0f;
+
+			// index in images(), -1 when the material has no such texture
+			int32_t base_color_image = -1;
+			int32_t metallic_roughness_image = -1;
+			int32_t normal_image = -1;
+
+			// RenderAPI texture ids, filled by RenderAPI::loadGltf
+			uint64_t base_color_texture_id = 0;
+			uint64_t metallic_roughness_texture_id = 0;
+			uint64_t normal_texture_id = 0;
+		};
+
+		struct Image
+		{
+			int width = 0;
+			int height = 0;
+			// RGBA8, released once the texture is uploaded
+			std::vector<unsigned char> pixels;
+			// color data is sampled as sRGB, everything else as UNORM
+			bool srgb = false;
+		};
+
+		// one per node of the default scene holding a mesh
+		struct Node
+		{
+			glm::mat4 transform;
+			uint32_t mesh;
+		};
+
+		struct CreateInfo
+		{
+			std::vector<Mesh> meshes;
+			std::vector<Material> materials;
+			std::vector<Image> images;
+			std::vector<Node> nodes;
+
+			// glTF buffers followed by converted data, and where each one lands in the GPU buffer
+			std::vector<std::vector<unsigned char>> buffers;
+			std::vector<VkDeviceSize> buffer_offsets;
+		};
+
+		GltfModel(
+			VkDevice device,
+			VkPhysicalDevice physicalDevice,
+			Command& command,
+			CreateInfo& createInfo
+		);
+		GltfModel(const GltfModel &) = delete;
+		GltfModel(GltfModel && other);
+		GltfModel & operator=(const GltfModel &) = delete;
+		GltfModel & operator=(GltfModel && other) = delete;
+		~GltfModel();
+
+		// parse the file, does not touch the device
+		static CreateInfo readFile(const std::string & filename);
+
+		Buffer & buffer() { return *m_buffer; }
+
+		const std::vector<Mesh> & meshes() const { return m_meshes; }
+		const std::vector<Material> & materials() const { return m_materials; }
+		const std::vector<Node> & nodes() const { return m_nodes; }
+
+	private:
+
+		std::unique_ptr<Buffer> m_buffer;
+
+		std::vector<Mesh> m_meshes;
+		std::vector<Material> m_materials;
+		std::vector<Node> m_nodes;
+
+	};
+}
@@ -0,0 +1,61 @@
+#include "mapped_file.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	MappedFile::MappedFile(const std::string & path):
+		m_data(nullptr),
+		m_size(0)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			throw std::runtime_error("failed to open file " + path);
+		}
+
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0)
+		{
+			close(fd);
+			throw std::runtime_error("failed to stat file " + path);
+		}
+		m_size = static_cast<size_t>(file_stat.st_size);
+
+		// an empty file can not be mapped, data() stays null
+		if (m_size > 0)
+		{
+			void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED)
+			{
+				close(fd);
+				throw std::runtime_error("failed to map file " + path);
+			}
+			m_data = static_cast<const char *>(data);
+		}
+
+		// the mapping stays valid after the descriptor is closed
+		close(fd);
+	}
+
+	MappedFile::MappedFile(MappedFile && other):
+		m_data(other.m_data),
+		m_size(other.m_size)
+	{
+		other.m_data = nullptr;
+		other.m_size = 0;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_data != nullptr)
+		{
+			munmap(const_cast<char *>(m_data), m_size);
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace LIB_NAMESPACE
+{
+	// Read-only memory mapping of a whole file.
+	class MappedFile
+	{
+
+	public:
+
+		MappedFile(const std::string & path);
+		MappedFile(const MappedFile &) = delete;
+		MappedFile(MappedFile && other);
+		MappedFile & operator=(const MappedFile &) = delete;
+		MappedFile & operator=(MappedFile && other) = delete;
+		~MappedFile();
+
+		const char *data() const { return m_data; }
+		size_t size() const { return m_size; }
+
+	private:
+
+		const char *m_data;
+		size_t m_size;
+
+	};
+}
@@ -1,9 +1,6 @@
 #include "mesh.hpp"
+#include "obj_loader.hpp"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-
-#include <unordered_map>
 #include <stdexcept>
 #include <iostream>
 
@@ -15,11 +12,32 @@ namespace LIB_NAMESPACE
 		Command& command,
 		CreateInfo& meshInfo
 	):
-		m_vertexCount(meshInfo.vertices.size()),
-		m_indexCount(meshInfo.indices.size())
+		Mesh(
+			device,
+			physicalDevice,
+			command,
+			meshInfo.vertices.data(),
+			static_cast<uint32_t>(meshInfo.vertices.size()),
+			meshInfo.indices.data(),
+			static_cast<uint32_t>(meshInfo.indices.size())
+		)
+	{
+	}
+
+	Mesh::Mesh(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		Command& command,
+		const Vertex *vertices,
+		uint32_t vertexCount,
+		const uint32_t *indices,
+		uint32_t indexCount
+	):
+		m_vertexCount(vertexCount),
+		m_indexCount(indexCount)
 	{
-		createVertexBuffer(device, physicalDevice, command, meshInfo.vertices);
-		createIndexBuffer(device, physicalDevice, command, meshInfo.indices);
+		createVertexBuffer(device, physicalDevice, command, vertices, vertexCount);
+		createIndexBuffer(device, physicalDevice, command, indices, indexCount);
 	}
 
 	Mesh::Mesh(Mesh && other):
@@ -38,10 +56,11 @@ namespace LIB_NAMESPACE
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
 		Command& command,
-		const std::vector<Vertex>& vertices
+		const Vertex *vertices,
+		uint32_t vertexCount
 	)
 	{
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
 
 		Buffer stagingBuffer = Buffer::createStagingBuffer(
 			device,
@@ -50,7 +69,7 @@ namespace LIB_NAMESPACE
 		);
 
 		stagingBuffer.map();
-		stagingBuffer.write((void*)vertices.data(), bufferSize);
+		stagingBuffer.write((void*)vertices, bufferSize);
 		stagingBuffer.unmap();
 
 
@@ -63,17 +82,19 @@ namespace LIB_NAMESPACE
 		VkBufferCopy copyRegion = {};
 		copyRegion.size = bufferSize;
 
-		command.copyBufferToBuffer(stagingBuffer.buffer(), m_vertexBuffer->buffer(), 1, &copyRegion);
+		command.uploadBuffer(stagingBuffer.buffer(), m_vertexBuffer->buffer(), 1, &copyRegion);
+		command.keepAlive(std::move(stagingBuffer));
 	}
 
 	void Mesh::createIndexBuffer(
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
 		Command& command,
-		const std::vector<uint32_t>& indices
+		const uint32_t *indices,
+		uint32_t indexCount
 	)
 	{
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
 
 		Buffer stagingBuffer = Buffer::createStagingBuffer(
 			device,
@@ -82,7 +103,7 @@ namespace LIB_NAMESPACE
 		);
 
 		stagingBuffer.map();
-		stagingBuffer.write((void*)indices.data(), bufferSize);
+		stagingBuffer.write((void*)indices, bufferSize);
 		stagingBuffer.unmap();
 
 
@@ -95,7 +116,8 @@ namespace LIB_NAMESPACE
 		VkBufferCopy copyRegion = {};
 		copyRegion.size = bufferSize;
 
-		command.copyBufferToBuffer(stagingBuffer.buffer(), m_indexBuffer->buffer(), 1, &copyRegion);
+		command.uploadBuffer(stagingBuffer.buffer(), m_indexBuffer->buffer(), 1, &copyRegion);
+		command.keepAlive(std::move(stagingBuffer));
 	}
 
 	void Mesh::readObjFile(
@@ -104,52 +126,6 @@ namespace LIB_NAMESPACE
 		std::vector<uint32_t>& indices
 	)
 	{
-		vertices.clear();
-		indices.clear();
-
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string warning, error;
-
-		if (tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, filename.c_str()) == false)
-		{
-			throw std::runtime_error(warning + error);
-		}
-
-		std::unordered_map<Vertex, uint32_t> uniqueVertices = {};
-
-		for (const auto& shape : shapes)
-		{
-			for (const auto& index : shape.mesh.indices)
-			{
-				Vertex vertex = {};
-
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				vertex.texCoord = {
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-				};
-
-				if (uniqueVertices.count(vertex) == 0)
-				{
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
-
-				indices.push_back(uniqueVertices[vertex]);
-			}
-		}
+		ObjLoader::load(filename, vertices, indices);
 	}
 }
@@ -26,6 +26,16 @@ namespace LIB_NAMESPACE
 			Command& command,
 			CreateInfo& meshInfo
 		);
+		// uploads the arrays as they are, e.g. straight from a memory-mapped MeshCache
+		Mesh(
+			VkDevice device,
+			VkPhysicalDevice physicalDevice,
+			Command& command,
+			const Vertex *vertices,
+			uint32_t vertexCount,
+			const uint32_t *indices,
+			uint32_t indexCount
+		);
 		Mesh(const Mesh & other) = delete;
 		Mesh(Mesh && other);
 		Mesh & operator=(const Mesh & other) = delete;
@@ -54,14 +64,16 @@ namespace LIB_NAMESPACE
 			VkDevice device,
 			VkPhysicalDevice physicalDevice,
 			Command& command,
-			const std::vector<Vertex>& vertices
+			const Vertex *vertices,
+			uint32_t vertexCount
 		);
 
 		void createIndexBuffer(
 			VkDevice device,
 			VkPhysicalDevice physicalDevice,
 			Command& command,
-			const std::vector<uint32_t>& indices
+			const uint32_t *indices,
+			uint32_t indexCount
 		);
 
     };
@@ -0,0 +1,122 @@
+#include "mesh_cache.hpp"
+#include "cache_file.hpp"
+
+#include <sys/stat.h>
+
+namespace LIB_NAMESPACE
+{
+	namespace
+	{
+		const char magic[8] = {'C', 'V', 'M', 'E', 'S', 'H', '\0', '\0'};
+		const uint32_t version = 2;
+
+		struct Info
+		{
+			uint32_t vertex_size;
+			uint32_t vertex_count;
+			uint32_t index_count;
+			uint32_t padding;
+			// identify the model the cache was built from
+			uint64_t model_size;
+			int64_t model_mtime_sec;
+			int64_t model_mtime_nsec;
+		};
+
+		bool modelStat(const std::string & model_path, Info & info)
+		{
+			struct stat model_stat;
+			if (stat(model_path.c_str(), &model_stat) != 0)
+			{
+				return false;
+			}
+
+			info.model_size = static_cast<uint64_t>(model_stat.st_size);
+			info.model_mtime_sec = static_cast<int64_t>(model_stat.st_mtim.tv_sec);
+			info.model_mtime_nsec = static_cast<int64_t>(model_stat.st_mtim.tv_nsec);
+			return true;
+		}
+	}
+
+	MeshCache::MeshCache(MappedFile && file):
+		m_file(std::move(file))
+	{
+		Info info;
+		CacheFile::readHeader(m_file.data(), m_file.size(), magic, version, info);
+
+		m_vertex_count = info.vertex_count;
+		m_index_count = info.index_count;
+		m_vertices = reinterpret_cast<const Vertex *>(m_file.data() + sizeof(CacheFile::Header));
+		m_indices = reinterpret_cast<const uint32_t *>(m_file.data() + sizeof(CacheFile::Header) + m_vertex_count * sizeof(Vertex));
+	}
+
+	MeshCache::~MeshCache()
+	{
+	}
+
+	std::unique_ptr<MeshCache> MeshCache::open(const std::string & model_path)
+	{
+		Info expected = {};
+		if (modelStat(model_path, expected) == false)
+		{
+			return nullptr;
+		}
+
+		std::string path = cachePath(model_path);
+		struct stat cache_stat;
+		if (stat(path.c_str(), &cache_stat) != 0)
+		{
+			return nullptr;
+		}
+
+		MappedFile file(path);
+		Info info;
+		if (CacheFile::readHeader(file.data(), file.size(), magic, version, info) == false)
+		{
+			return nullptr;
+		}
+
+		uint64_t expected_size = sizeof(CacheFile::Header)
+			+ static_cast<uint64_t>(info.vertex_count) * sizeof(Vertex)
+			+ static_cast<uint64_t>(info.index_count) * sizeof(uint32_t);
+
+		if (
+			info.vertex_size != sizeof(Vertex)
+			|| info.model_size != expected.model_size
+			|| info.model_mtime_sec != expected.model_mtime_sec
+			|| info.model_mtime_nsec != expected.model_mtime_nsec
+			|| file.size() != expected_size
+		)
+		{
+			return nullptr;
+		}
+
+		return std::unique_ptr<MeshCache>(new MeshCache(std::move(file)));
+	}
+
+	bool MeshCache::write(
+		const std::string & model_path,
+		const std::vector<Vertex> & vertices,
+		const std::vector<uint32_t> & indices
+	)
+	{
+		Info info = {};
+		info.vertex_size = sizeof(Vertex);
+		info.vertex_count = static_cast<uint32_t>(vertices.size());
+		info.index_count = static_cast<uint32_t>(indices.size());
+
+		if (modelStat(model_path, info) == false)
+		{
+			return false;
+		}
+
+		return CacheFile::write(cachePath(model_path), CacheFile::makeHeader(magic, version, info), {
+			{ vertices.data(), vertices.size() * sizeof(Vertex) },
+			{ indices.data(), indices.size() * sizeof(uint32_t) }
+		});
+	}
+
+	std::string MeshCache::cachePath(const std::string & model_path)
+	{
+		return model_path + ".meshcache";
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "defines.hpp"
+#include "vertex.hpp"
+#include "mapped_file.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// Deduplicated vertices and indices of a model, stored next to it as <model>.meshcache.
+	// The cache is memory-mapped and uploaded as is, so a later load skips parsing entirely.
+	// It is ignored when the model file changed size or modification time since it was written.
+	class MeshCache
+	{
+
+	public:
+
+		MeshCache(const MeshCache &) = delete;
+		MeshCache(MeshCache && other) = default;
+		MeshCache & operator=(const MeshCache &) = delete;
+		MeshCache & operator=(MeshCache && other) = delete;
+		~MeshCache();
+
+		// null when there is no valid cache for the model
+		static std::unique_ptr<MeshCache> open(const std::string & model_path);
+		// returns false when the cache could not be written, the model can still be used
+		static bool write(
+			const std::string & model_path,
+			const std::vector<Vertex> & vertices,
+			const std::vector<uint32_t> & indices
+		);
+
+		static std::string cachePath(const std::string & model_path);
+
+		const Vertex *vertices() const { return m_vertices; }
+		uint32_t vertexCount() const { return m_vertex_count; }
+		const uint32_t *indices() const { return m_indices; }
+		uint32_t indexCount() const { return m_index_count; }
+
+	private:
+
+		MeshCache(MappedFile && file);
+
+		MappedFile m_file;
+
+		const Vertex *m_vertices;
+		uint32_t m_vertex_count;
+		const uint32_t *m_indices;
+		uint32_t m_index_count;
+
+	};
+}
@@ -0,0 +1,566 @@
+#include "obj_loader.hpp"
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+#include <exception>
+#include <thread>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+namespace LIB_NAMESPACE
+{
+	namespace
+	{
+		const int64_t no_index = std::numeric_limits<int64_t>::min();
+
+		// indices into the global attribute arrays, no_index when the face does not reference the attribute
+		struct Corner
+		{
+			int64_t position;
+			int64_t texcoord;
+			int64_t normal;
+		};
+
+		// negative OBJ indices are relative to the attributes read so far,
+		// they are stored chunk-local and offset once the attribute counts of the previous chunks are known
+		enum RelativeFlags: uint8_t
+		{
+			RELATIVE_POSITION = 1,
+			RELATIVE_TEXCOORD = 2,
+			RELATIVE_NORMAL = 4
+		};
+
+		struct Chunk
+		{
+			std::vector<float> positions;
+			std::vector<float> texcoords;
+			std::vector<float> normals;
+
+			// three corners per triangle
+			std::vector<Corner> corners;
+			std::vector<uint8_t> relative;
+		};
+
+		const uint32_t empty_slot = std::numeric_limits<uint32_t>::max();
+
+		template<typename Function>
+		void parallelFor(unsigned int thread_count, Function function)
+		{
+			std::vector<std::thread> threads;
+			std::vector<std::exception_ptr> errors(thread_count);
+
+			for (unsigned int thread = 0; thread < thread_count; thread++)
+			{
+				threads.emplace_back([&, thread]()
+				{
+					try
+					{
+						function(thread);
+					}
+					catch (...)
+					{
+						errors[thread] = std::current_exception();
+					}
+				});
+			}
+
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+
+			for (auto& error : errors)
+			{
+				if (error)
+				{
+					std::rethrow_exception(error);
+				}
+			}
+		}
+
+		void range(size_t count, unsigned int thread_count, unsigned int thread, size_t & begin, size_t & end)
+		{
+			begin = count * thread / thread_count;
+			end = count * (thread + 1) / thread_count;
+		}
+
+		bool isBlank(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		const char *skipBlanks(const char *p, const char *end)
+		{
+			while (p < end && isBlank(*p))
+			{
+				p++;
+			}
+			return p;
+		}
+
+		const char *skipLine(const char *p, const char *end)
+		{
+			const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+			return newline == nullptr ? end : newline + 1;
+		}
+
+		// faster than strtof and independent from the locale, precise enough for vertex data
+		const char *parseFloat(const char *p, const char *end, float & value)
+		{
+			static const double powers[] = {
+				1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+				1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+			};
+
+			p = skipBlanks(p, end);
+
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				p++;
+			}
+
+			uint64_t mantissa = 0;
+			int digits = 0;
+			int exponent = 0;
+			bool any_digit = false;
+
+			for (; p < end && *p >= '0' && *p <= '9'; p++)
+			{
+				any_digit = true;
+				if (digits < 18)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa != 0)
+					{
+						digits++;
+					}
+				}
+				else
+				{
+					exponent++;
+				}
+			}
+
+			if (p < end && *p == '.')
+			{
+				p++;
+				for (; p < end && *p >= '0' && *p <= '9'; p++)
+				{
+					any_digit = true;
+					if (digits < 18)
+					{
+						mantissa = mantissa * 10 + (*p - '0');
+						exponent--;
+						if (mantissa != 0)
+						{
+							digits++;
+						}
+					}
+				}
+			}
+
+			if (any_digit == false)
+			{
+				throw std::runtime_error("failed to parse obj file: expected a number.");
+			}
+
+			if (p < end && (*p == 'e' || *p == 'E'))
+			{
+				p++;
+				bool negative_exponent = false;
+				if (p < end && (*p == '-' || *p == '+'))
+				{
+					negative_exponent = *p == '-';
+					p++;
+				}
+				int written_exponent = 0;
+				for (; p < end && *p >= '0' && *p <= '9'; p++)
+				{
+					written_exponent = std::min(written_exponent * 10 + (*p - '0'), 1000);
+				}
+				exponent += negative_exponent ? -written_exponent : written_exponent;
+			}
+
+			double result = static_cast<double>(mantissa);
+			if (exponent >= 0 && exponent <= 18)
+			{
+				result *= powers[exponent];
+			}
+			else if (exponent < 0 && exponent >= -18)
+			{
+				result /= powers[-exponent];
+			}
+			else
+			{
+				result *= std::pow(10.0, exponent);
+			}
+
+			value = static_cast<float>(negative ? -result : result);
+			return p;
+		}
+
+		const char *parseIndex(const char *p, const char *end, int64_t & index)
+		{
+			bool negative = false;
+			if (p < end && *p == '-')
+			{
+				negative = true;
+				p++;
+			}
+
+			if (p >= end || *p < '0' || *p > '9')
+			{
+				throw std::runtime_error("failed to parse obj file: expected a face index.");
+			}
+
+			index = 0;
+			for (; p < end && *p >= '0' && *p <= '9'; p++)
+			{
+				index = index * 10 + (*p - '0');
+			}
+			if (negative)
+			{
+				index = -index;
+			}
+			return p;
+		}
+
+		// OBJ indices start at 1, negative ones count back from the last attribute read
+		int64_t resolveIndex(int64_t index, size_t local_count, uint8_t flag, uint8_t & relative)
+		{
+			if (index > 0)
+			{
+				return index - 1;
+			}
+			if (index == 0)
+			{
+				throw std::runtime_error("failed to parse obj file: face index 0.");
+			}
+
+			relative |= flag;
+			return static_cast<int64_t>(local_count) + index;
+		}
+
+		void parseChunk(const char *p, const char *end, Chunk & chunk)
+		{
+			std::vector<Corner> face;
+			std::vector<uint8_t> face_relative;
+
+			while (p < end)
+			{
+				p = skipBlanks(p, end);
+				if (p + 1 >= end)
+				{
+					break;
+				}
+
+				if (p[0] == 'v' && isBlank(p[1]))
+				{
+					float x, y, z;
+					p = parseFloat(p + 1, end, x);
+					p = parseFloat(p, end, y);
+					p = parseFloat(p, end, z);
+					chunk.positions.insert(chunk.positions.end(), {x, y, z});
+				}
+				else if (p[0] == 'v' && p[1] == 'n')
+				{
+					float x, y, z;
+					p = parseFloat(p + 2, end, x);
+					p = parseFloat(p, end, y);
+					p = parseFloat(p, end, z);
+					chunk.normals.insert(chunk.normals.end(), {x, y, z});
+				}
+				else if (p[0] == 'v' && p[1] == 't')
+				{
+					float u, v = 0.0f;
+					p = parseFloat(p + 2, end, u);
+					// the v coordinate is optional
+					p = skipBlanks(p, end);
+					if (p < end && *p != '\n' && *p != '#')
+					{
+						p = parseFloat(p, end, v);
+					}
+					chunk.texcoords.insert(chunk.texcoords.end(), {u, v});
+				}
+				else if (p[0] == 'f' && isBlank(p[1]))
+				{
+					face.clear();
+					face_relative.clear();
+					p = skipBlanks(p + 1, end);
+
+					while (p < end && *p != '\n' && *p != '#')
+					{
+						Corner corner = {no_index, no_index, no_index};
+						uint8_t relative = 0;
+						int64_t index;
+
+						p = parseIndex(p, end, index);
+						corner.position = resolveIndex(index, chunk.positions.size() / 3, RELATIVE_POSITION, relative);
+
+						if (p < end && *p == '/')
+						{
+							p++;
+							if (p < end && *p != '/')
+							{
+								p = parseIndex(p, end, index);
+								corner.texcoord = resolveIndex(index, chunk.texcoords.size() / 2, RELATIVE_TEXCOORD, relative);
+							}
+							if (p < end && *p == '/')
+							{
+								p = parseIndex(p + 1, end, index);
+								corner.normal = resolveIndex(index, chunk.normals.size() / 3, RELATIVE_NORMAL, relative);
+							}
+						}
+
+						face.push_back(corner);
+						face_relative.push_back(relative);
+						p = skipBlanks(p, end);
+					}
+
+					for (size_t i = 1; i + 1 < face.size(); i++)
+					{
+						chunk.corners.insert(chunk.corners.end(), {face[0], face[i], face[i + 1]});
+						chunk.relative.insert(chunk.relative.end(), {face_relative[0], face_relative[i], face_relative[i + 1]});
+					}
+				}
+
+				p = skipLine(p, end);
+			}
+		}
+	}
+
+	void ObjLoader::load(
+		const std::string & filename,
+		std::vector<Vertex> & vertices,
+		std::vector<uint32_t> & indices,
+		unsigned int thread_count
+	)
+	{
+		vertices.clear();
+		indices.clear();
+
+		MappedFile file(filename);
+		const char *begin = file.data();
+		const char *end = begin + file.size();
+
+		if (thread_count == 0)
+		{
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+		}
+		// small files are not worth the threads
+		const size_t min_chunk_size = 1 << 20;
+		thread_count = static_cast<unsigned int>(std::min<size_t>(thread_count, file.size() / min_chunk_size + 1));
+
+
+		// parse: split on line boundaries, one chunk per thread
+		std::vector<const char *> boundaries(thread_count + 1, end);
+		boundaries[0] = begin;
+		for (unsigned int i = 1; i < thread_count; i++)
+		{
+			boundaries[i] = skipLine(std::max(begin + file.size() * i / thread_count, boundaries[i - 1]), end);
+		}
+
+		std::vector<Chunk> chunks(thread_count);
+		parallelFor(thread_count, [&](unsigned int thread)
+		{
+			parseChunk(boundaries[thread], boundaries[thread + 1], chunks[thread]);
+		});
+
+
+		// merge the attributes and make every corner index global
+		size_t position_count = 0, texcoord_count = 0, normal_count = 0, corner_count = 0;
+		std::vector<size_t> position_offsets(thread_count), texcoord_offsets(thread_count), normal_offsets(thread_count), corner_offsets(thread_count);
+		for (unsigned int i = 0; i < thread_count; i++)
+		{
+			position_offsets[i] = position_count;
+			texcoord_offsets[i] = texcoord_count;
+			normal_offsets[i] = normal_count;
+			corner_offsets[i] = corner_count;
+
+			position_count += chunks[i].positions.size() / 3;
+			texcoord_count += chunks[i].texcoords.size() / 2;
+			normal_count += chunks[i].normals.size() / 3;
+			corner_count += chunks[i].corners.size();
+		}
+
+		if (corner_count >= empty_slot)
+		{
+			throw std::runtime_error("failed to load obj file: too many vertices for 32 bits indices.");
+		}
+
+		std::vector<float> positions(position_count * 3);
+		std::vector<float> texcoords(texcoord_count * 2);
+		std::vector<float> normals(normal_count * 3);
+		std::vector<Vertex> corners(corner_count);
+
+		parallelFor(thread_count, [&](unsigned int thread)
+		{
+			Chunk & chunk = chunks[thread];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + position_offsets[thread] * 3);
+			std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + texcoord_offsets[thread] * 2);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normal_offsets[thread] * 3);
+		});
+
+		parallelFor(thread_count, [&](unsigned int thread)
+		{
+			Chunk & chunk = chunks[thread];
+			for (size_t i = 0; i < chunk.corners.size(); i++)
+			{
+				Corner corner = chunk.corners[i];
+				uint8_t relative = chunk.relative[i];
+
+				if (relative & RELATIVE_POSITION) corner.position += position_offsets[thread];
+				if (relative & RELATIVE_TEXCOORD) corner.texcoord += texcoord_offsets[thread];
+				if (relative & RELATIVE_NORMAL) corner.normal += normal_offsets[thread];
+
+				if (
+					corner.position < 0 || corner.position >= static_cast<int64_t>(position_count)
+					|| (corner.texcoord != no_index && (corner.texcoord < 0 || corner.texcoord >= static_cast<int64_t>(texcoord_count)))
+					|| (corner.normal != no_index && (corner.normal < 0 || corner.normal >= static_cast<int64_t>(normal_count)))
+				)
+				{
+					throw std::runtime_error("failed to load obj file: face index out of range.");
+				}
+
+				Vertex vertex = {};
+				vertex.pos = {
+					positions[3 * corner.position + 0],
+					positions[3 * corner.position + 1],
+					positions[3 * corner.position + 2]
+				};
+				if (corner.normal != no_index)
+				{
+					vertex.normal = {
+						normals[3 * corner.normal + 0],
+						normals[3 * corner.normal + 1],
+						normals[3 * corner.normal + 2]
+					};
+				}
+				if (corner.texcoord != no_index)
+				{
+					vertex.texCoord = {
+						texcoords[2 * corner.texcoord + 0],
+						1.0f - texcoords[2 * corner.texcoord + 1]
+					};
+				}
+
+				corners[corner_offsets[thread] + i] = vertex;
+			}
+
+			// release the chunk as soon as it has been consumed
+			chunk = Chunk();
+		});
+
+		positions = std::vector<float>();
+		texcoords = std::vector<float>();
+		normals = std::vector<float>();
+
+
+		// dedup: every vertex is owned by the shard picked by the high bits of its hash,
+		// each thread buckets its range of corners per shard so shards see corners in file order
+		const unsigned int shard_count = thread_count;
+		std::vector<uint64_t> hashes(corner_count);
+		std::vector<std::vector<std::vector<uint32_t>>> buckets(thread_count, std::vector<std::vector<uint32_t>>(shard_count));
+
+		parallelFor(thread_count, [&](unsigned int thread)
+		{
+			size_t first, last;
+			range(corner_count, thread_count, thread, first, last);
+
+			std::hash<Vertex> hasher;
+			for (size_t i = first; i < last; i++)
+			{
+				hashes[i] = hasher(corners[i]);
+				buckets[thread][(hashes[i] >> 32) % shard_count].push_back(static_cast<uint32_t>(i));
+			}
+		});
+
+		// first corner holding the same vertex, itself when it is the first occurrence
+		std::vector<uint32_t> representatives(corner_count);
+		std::vector<size_t> unique_counts(shard_count, 0);
+
+		parallelFor(shard_count, [&](unsigned int shard)
+		{
+			size_t shard_size = 0;
+			for (unsigned int thread = 0; thread < thread_count; thread++)
+			{
+				shard_size += buckets[thread][shard].size();
+			}
+
+			// flat open-addressing table with linear probing, kept at most half full
+			size_t capacity = 16;
+			while (capacity < shard_size * 2)
+			{
+				capacity *= 2;
+			}
+			std::vector<uint32_t> slots(capacity, empty_slot);
+			const size_t mask = capacity - 1;
+
+			for (unsigned int thread = 0; thread < thread_count; thread++)
+			{
+				for (uint32_t corner : buckets[thread][shard])
+				{
+					size_t slot = hashes[corner] & mask;
+					while (true)
+					{
+						uint32_t existing = slots[slot];
+						if (existing == empty_slot)
+						{
+							slots[slot] = corner;
+							representatives[corner] = corner;
+							unique_counts[shard]++;
+							break;
+						}
+						if (hashes[existing] == hashes[corner] && corners[existing] == corners[corner])
+						{
+							representatives[corner] = existing;
+							break;
+						}
+						slot = (slot + 1) & mask;
+					}
+				}
+				buckets[thread][shard] = std::vector<uint32_t>();
+			}
+		});
+
+		hashes = std::vector<uint64_t>();
+
+
+		// number the unique vertices in order of first occurrence, then point every corner at its vertex
+		size_t unique_count = 0;
+		for (size_t count : unique_counts)
+		{
+			unique_count += count;
+		}
+		vertices.reserve(unique_count);
+		indices.resize(corner_count);
+
+		for (size_t i = 0; i < corner_count; i++)
+		{
+			if (representatives[i] == i)
+			{
+				indices[i] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(corners[i]);
+			}
+		}
+
+		parallelFor(thread_count, [&](unsigned int thread)
+		{
+			size_t first, last;
+			range(corner_count, thread_count, thread, first, last);
+
+			for (size_t i = first; i < last; i++)
+			{
+				// the representative comes first in the file so its index is already set,
+				// and only the loop above writes it while other threads read it here
+				if (representatives[i] != i)
+				{
+					indices[i] = indices[representatives[i]];
+				}
+			}
+		});
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "defines.hpp"
+#include "vertex.hpp"
+
+#include <string>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// Multithreaded Wavefront OBJ reader.
+	// The memory-mapped file is split on line boundaries and every part is parsed by its own thread.
+	// The triangles are then deduplicated in hash-sharded flat open-addressing tables,
+	// one shard per thread, keeping the first-occurrence vertex order of a sequential dedup.
+	// Only positions, normals, texture coordinates and faces are read, polygons are triangulated as fans.
+	class ObjLoader
+	{
+
+	public:
+
+		// thread_count 0 uses every hardware thread
+		static void load(
+			const std::string & filename,
+			std::vector<Vertex> & vertices,
+			std::vector<uint32_t> & indices,
+			unsigned int thread_count = 0
+		);
+
+	};
+}
@@ -8,6 +8,8 @@
 
 #include <array>
 #include <vector>
+#include <cstdint>
+#include <cstring>
 
 namespace LIB_NAMESPACE
 {
@@ -59,11 +61,40 @@ namespace std
 {
 	template<> struct hash<LIB_NAMESPACE::Vertex>
 	{
+		// mixes every bit of the vertex, combining the glm hashes with xor and shifts
+		// made symmetric vertices collide and long probe chains in the dedup tables
 		size_t operator()(LIB_NAMESPACE::Vertex const& vertex) const
 		{
-			return ((hash<glm::vec3>()(vertex.pos) ^
-				(hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^
-				(hash<glm::vec2>()(vertex.texCoord) << 1);
+			static_assert(sizeof(LIB_NAMESPACE::Vertex) == 8 * sizeof(float), "Vertex has padding");
+
+			float values[8];
+			std::memcpy(values, &vertex, sizeof(values));
+			// -0.0 and 0.0 compare equal so they must hash the same
+			for (float & value : values)
+			{
+				value += 0.0f;
+			}
+
+			uint64_t words[4];
+			std::memcpy(words, values, sizeof(words));
+
+			uint64_t hash = 0;
+			for (uint64_t word : words)
+			{
+				hash = (hash ^ mix(word)) * 0x9E3779B97F4A7C15ull;
+			}
+			return static_cast<size_t>(mix(hash));
+		}
+
+		// murmur3 finalizer
+		static uint64_t mix(uint64_t value)
+		{
+			value ^= value >> 33;
+			value *= 0xFF51AFD7ED558CCDull;
+			value ^= value >> 33;
+			value *= 0xC4CEB9FE1A85EC53ull;
+			value ^= value >> 33;
+			return value;
 		}
 	};
 }
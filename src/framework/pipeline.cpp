@@ -1,41 +1,267 @@
 #include "pipeline.hpp"
-#include "core/pipeline/shader_module.hpp"
 #include "object/vertex.hpp"
+#include "trace.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 
 namespace LIB_NAMESPACE
 {
-	Pipeline::Pipeline(VkDevice device, const CreateInfo& create_info)
+	Pipeline::Pipeline(
+		VkDevice device,
+		const CreateInfo& create_info,
+		ShaderModuleCache & shader_modules,
+		DescriptorAllocator & descriptor_allocator,
+		VkPipelineCache pipeline_cache
+	)
 	{
-		createPipeline(device, create_info);
+		CreateInfo info = create_info;
+		std::promise<Compiled> pipeline;
+
+		if (info.compute_shader_path.empty() == false)
+		{
+			m_bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
+
+			std::shared_ptr<const ShaderModuleCache::Shader> computeShader = shader_modules.load(info.compute_shader_path);
+			if (info.reflect)
+			{
+				reflect(descriptor_allocator, info, { computeShader.get() });
+			}
+			createLayout(device, info);
+
+			pipeline.set_value(createComputePipeline(
+				device, info, layout->getVk(), pipeline_cache,
+				shader_modules, computeShader
+			));
+			m_pipeline = pipeline.get_future().share();
+			return;
+		}
+
+		std::shared_ptr<const ShaderModuleCache::Shader> vertexShader = shader_modules.load(info.vertex_shader_path);
+		std::shared_ptr<const ShaderModuleCache::Shader> fragmentShader = shader_modules.load(info.fragment_shader_path);
+		if (info.reflect)
+		{
+			reflect(descriptor_allocator, info, { vertexShader.get(), fragmentShader.get() });
+		}
+		createLayout(device, info);
+
+		pipeline.set_value(createPipeline(
+			device, info, layout->getVk(), pipeline_cache,
+			shader_modules, vertexShader, fragmentShader
+		));
+		m_pipeline = pipeline.get_future().share();
+	}
+
+	Pipeline::Pipeline(
+		VkDevice device,
+		const CreateInfo& create_info,
+		ShaderModuleCache & shader_modules,
+		DescriptorAllocator & descriptor_allocator,
+		VkPipelineCache pipeline_cache,
+		ThreadPool & thread_pool
+	)
+	{
+		CreateInfo info = create_info;
+		VkPipelineLayout pipeline_layout;
+		ShaderModuleCache *shaderModules = &shader_modules;
+
+		if (info.compute_shader_path.empty() == false)
+		{
+			m_bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
+
+			std::shared_ptr<const ShaderModuleCache::Shader> computeShader;
+			if (info.reflect)
+			{
+				computeShader = shader_modules.load(info.compute_shader_path);
+				reflect(descriptor_allocator, info, { computeShader.get() });
+			}
+			createLayout(device, info);
+
+			pipeline_layout = layout->getVk();
+			m_pipeline = thread_pool.submit([device, info, pipeline_layout, pipeline_cache, shaderModules, computeShader]()
+			{
+				return createComputePipeline(
+					device, info, pipeline_layout, pipeline_cache,
+					*shaderModules, computeShader
+				);
+			}).share();
+			return;
+		}
+
+		// reflection needs the shaders now, otherwise they are loaded by the task
+		std::shared_ptr<const ShaderModuleCache::Shader> vertexShader;
+		std::shared_ptr<const ShaderModuleCache::Shader> fragmentShader;
+		if (info.reflect)
+		{
+			vertexShader = shader_modules.load(info.vertex_shader_path);
+			fragmentShader = shader_modules.load(info.fragment_shader_path);
+			reflect(descriptor_allocator, info, { vertexShader.get(), fragmentShader.get() });
+		}
+		createLayout(device, info);
+
+		pipeline_layout = layout->getVk();
+		m_pipeline = thread_pool.submit([device, info, pipeline_layout, pipeline_cache, shaderModules, vertexShader, fragmentShader]()
+		{
+			return createPipeline(
+				device, info, pipeline_layout, pipeline_cache,
+				*shaderModules, vertexShader, fragmentShader
+			);
+		}).share();
 	}
 
 	Pipeline::Pipeline(Pipeline && other):
 		layout(std::move(other.layout)),
-		pipeline(std::move(other.pipeline))
+		m_pipeline(std::move(other.m_pipeline)),
+		m_bind_point(other.m_bind_point),
+		m_vk_descriptor_set_layouts(std::move(other.m_vk_descriptor_set_layouts))
 	{
 	}
 
 	Pipeline::~Pipeline()
 	{
+		// the compilation task uses the layout
+		if (m_pipeline.valid())
+		{
+			m_pipeline.wait();
+		}
+	}
+
+	bool Pipeline::ready() const
+	{
+		return m_pipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	void Pipeline::wait() const
+	{
+		m_pipeline.get();
+	}
+
+	void Pipeline::reflect(
+		DescriptorAllocator & descriptor_allocator,
+		CreateInfo& create_info,
+		const std::vector<const ShaderModuleCache::Shader *> & shaders
+	)
+	{
+		std::vector<const ShaderReflection *> stages;
+		for (const ShaderModuleCache::Shader *shader : shaders)
+		{
+			stages.push_back(&shader->reflection());
+		}
+
+		auto setBindings = ShaderReflection::setLayoutBindings(stages);
+		for (uint32_t set = 0; set < setBindings.size(); set++)
+		{
+			auto& bindings = setBindings[set];
+			auto listed = [set](const std::vector<uint32_t> & sets)
+			{
+				return std::find(sets.begin(), sets.end(), set) != sets.end();
+			};
+
+			bool textureTable = bindings.size() == 1
+				&& bindings[0].descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+				&& bindings[0].descriptorCount == 0;
+			if (textureTable && create_info.texture_table_layout != VK_NULL_HANDLE)
+			{
+				m_vk_descriptor_set_layouts.push_back(create_info.texture_table_layout);
+			}
+			else if (listed(create_info.frame_uniform_sets))
+			{
+				m_vk_descriptor_set_layouts.push_back(create_info.frame_uniform_layout);
+			}
+			else if (listed(create_info.frame_storage_sets))
+			{
+				m_vk_descriptor_set_layouts.push_back(create_info.frame_storage_layout);
+			}
+			else
+			{
+				m_vk_descriptor_set_layouts.push_back(descriptor_allocator.layout(bindings));
+			}
+		}
+		create_info.descriptor_set_layouts = m_vk_descriptor_set_layouts;
+		create_info.push_constant_ranges = ShaderReflection::pushConstantRanges(stages);
+
+		if (stages[0]->stage() != VK_SHADER_STAGE_VERTEX_BIT)
+		{
+			return;
+		}
+		const ShaderReflection & vertexReflection = *stages[0];
+
+		// the first locations are read from the Vertex buffer, the next ones from the instance buffer
+		auto vertexAttributes = Vertex::getAttributeDescriptions();
+		bool deriveInstanceAttributes = create_info.instance_attributes.empty();
+		uint32_t instanceStride = 0;
+
+		for (auto& input : vertexReflection.vertexInputs())
+		{
+			if (input.location < vertexAttributes.size())
+			{
+				if (input.format != vertexAttributes[input.location].format)
+				{
+					throw std::runtime_error(
+						"vertex shader input at location " + std::to_string(input.location) + " does not match the Vertex attribute."
+					);
+				}
+				continue;
+			}
+
+			if (deriveInstanceAttributes)
+			{
+				VkVertexInputAttributeDescription attribute = {};
+				attribute.location = input.location;
+				attribute.binding = 1;
+				attribute.format = input.format;
+				attribute.offset = instanceStride;
+				create_info.instance_attributes.push_back(attribute);
+
+				instanceStride += ShaderReflection::formatSize(input.format);
+			}
+		}
+
+		if (deriveInstanceAttributes && create_info.instance_stride == 0)
+		{
+			create_info.instance_stride = instanceStride;
+		}
+	}
+
+	void Pipeline::createLayout(VkDevice device, const CreateInfo& create_info)
+	{
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(create_info.descriptor_set_layouts.size());
+		pipelineLayoutInfo.pSetLayouts = create_info.descriptor_set_layouts.data();
+		pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(create_info.push_constant_ranges.size());
+		pipelineLayoutInfo.pPushConstantRanges = create_info.push_constant_ranges.data();
+
+		layout = std::make_unique<vk::core::PipelineLayout>(device, pipelineLayoutInfo);
 	}
 
-	void Pipeline::createPipeline(VkDevice device, const CreateInfo& create_info)
+	Pipeline::Compiled Pipeline::createPipeline(
+		VkDevice device,
+		const CreateInfo& create_info,
+		VkPipelineLayout pipeline_layout,
+		VkPipelineCache pipeline_cache,
+		ShaderModuleCache & shader_modules,
+		std::shared_ptr<const ShaderModuleCache::Shader> vertex_shader,
+		std::shared_ptr<const ShaderModuleCache::Shader> fragment_shader
+	)
 	{
-		vk::core::ShaderModule vertShaderModule(device, create_info.vertex_shader_path);
-		vk::core::ShaderModule fragShaderModule(device, create_info.fragment_shader_path);
+		TRACE_ZONE("compile pipeline");
+
+		Compiled compiled;
+		compiled.vertex_shader = vertex_shader ? vertex_shader : shader_modules.load(create_info.vertex_shader_path);
+		compiled.fragment_shader = fragment_shader ? fragment_shader : shader_modules.load(create_info.fragment_shader_path);
 
 		VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 		vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-		vertShaderStageInfo.module = vertShaderModule.getVk();
+		vertShaderStageInfo.module = compiled.vertex_shader->getVk();
 		vertShaderStageInfo.pName = "main";
 
 		VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
 		fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		fragShaderStageInfo.module = fragShaderModule.getVk();
+		fragShaderStageInfo.module = compiled.fragment_shader->getVk();
 		fragShaderStageInfo.pName = "main";
 
 		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
@@ -45,20 +271,62 @@ namespace LIB_NAMESPACE
 			VK_DYNAMIC_STATE_VIEWPORT,
 			VK_DYNAMIC_STATE_SCISSOR
 		};
+		if (create_info.separate_vertex_streams)
+		{
+			dynamicStates.push_back(VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE);
+		}
 		VkPipelineDynamicStateCreateInfo dynamicState{};
 		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
 		dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
 		dynamicState.pDynamicStates = dynamicStates.data();
 
 
-		auto bindingDescription = Vertex::getBindingDescription();
-		auto attributeDescriptions = Vertex::getAttributeDescriptions();
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions = { Vertex::getBindingDescription() };
+		auto vertexAttributeDescriptions = Vertex::getAttributeDescriptions();
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(
+			vertexAttributeDescriptions.begin(),
+			vertexAttributeDescriptions.end()
+		);
+
+		if (create_info.separate_vertex_streams)
+		{
+			// same locations and formats as Vertex, one binding per attribute, skipping the instance binding
+			const uint32_t streamBindings[] = {0, 2, 3};
+
+			bindingDescriptions.clear();
+			for (size_t i = 0; i < attributeDescriptions.size(); i++)
+			{
+				VkVertexInputBindingDescription streamBindingDescription{};
+				streamBindingDescription.binding = streamBindings[i];
+				streamBindingDescription.stride = attributeDescriptions[i].format == VK_FORMAT_R32G32_SFLOAT ? 8 : 12;
+				streamBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+				bindingDescriptions.push_back(streamBindingDescription);
+
+				attributeDescriptions[i].binding = streamBindings[i];
+				attributeDescriptions[i].offset = 0;
+			}
+		}
+
+		if (create_info.instance_stride > 0)
+		{
+			VkVertexInputBindingDescription instanceBindingDescription{};
+			instanceBindingDescription.binding = 1;
+			instanceBindingDescription.stride = create_info.instance_stride;
+			instanceBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+			bindingDescriptions.push_back(instanceBindingDescription);
+
+			for (auto attribute : create_info.instance_attributes)
+			{
+				attribute.binding = 1;
+				attributeDescriptions.push_back(attribute);
+			}
+		}
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-		vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+		vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 
@@ -91,7 +359,7 @@ namespace LIB_NAMESPACE
 		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
 
-		std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(create_info.color_target_ids.size());
+		std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(create_info.color_formats.size());
 		for (size_t i = 0; i < colorBlendAttachments.size(); i++)
 		{
 			colorBlendAttachments[i].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -114,15 +382,12 @@ namespace LIB_NAMESPACE
 		depthStencil.stencilTestEnable = VK_FALSE;
 
 
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(create_info.descriptor_set_layouts.size());
-		pipelineLayoutInfo.pSetLayouts = create_info.descriptor_set_layouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(create_info.push_constant_ranges.size());
-		pipelineLayoutInfo.pPushConstantRanges = create_info.push_constant_ranges.data();
-
-
-		layout = std::make_unique<vk::core::PipelineLayout>(device, pipelineLayoutInfo);
+		VkPipelineRenderingCreateInfo renderingInfo = {};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+		renderingInfo.pNext = create_info.pNext;
+		renderingInfo.colorAttachmentCount = static_cast<uint32_t>(create_info.color_formats.size());
+		renderingInfo.pColorAttachmentFormats = create_info.color_formats.data();
+		renderingInfo.depthAttachmentFormat = create_info.depth_format;
 
 
 		vk::core::Pipeline::CreateInfo pipelineInfo = {};
@@ -136,11 +401,38 @@ namespace LIB_NAMESPACE
 		pipelineInfo.pDepthStencilState = &depthStencil;
 		pipelineInfo.pColorBlendState = &colorBlending;
 		pipelineInfo.pDynamicState = &dynamicState;
-		pipelineInfo.layout = layout->getVk();
+		pipelineInfo.layout = pipeline_layout;
 		pipelineInfo.renderPass = VK_NULL_HANDLE;
 		pipelineInfo.subpass = 0;
-		pipelineInfo.pNext = create_info.pNext;
+		pipelineInfo.pNext = &renderingInfo;
+
+		compiled.pipeline = std::make_shared<vk::core::Pipeline>(device, pipelineInfo, pipeline_cache);
+		return compiled;
+	}
+
+	Pipeline::Compiled Pipeline::createComputePipeline(
+		VkDevice device,
+		const CreateInfo& create_info,
+		VkPipelineLayout pipeline_layout,
+		VkPipelineCache pipeline_cache,
+		ShaderModuleCache & shader_modules,
+		std::shared_ptr<const ShaderModuleCache::Shader> compute_shader
+	)
+	{
+		TRACE_ZONE("compile compute pipeline");
 
-		pipeline = std::make_unique<vk::core::Pipeline>(device, pipelineInfo);
+		Compiled compiled;
+		compiled.compute_shader = compute_shader ? compute_shader : shader_modules.load(create_info.compute_shader_path);
+
+		vk::core::Pipeline::ComputeCreateInfo pipelineInfo = {};
+		pipelineInfo.pNext = create_info.pNext;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = compiled.compute_shader->getVk();
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipeline_layout;
+
+		compiled.pipeline = std::make_shared<vk::core::Pipeline>(device, pipelineInfo, pipeline_cache);
+		return compiled;
 	}
 }
\ No newline at end of file
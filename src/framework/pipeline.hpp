@@ -4,7 +4,11 @@
 
 #include "core/pipeline/graphic_pipeline.hpp"
 #include "core/pipeline/pipeline_layout.hpp"
+#include "thread_pool.hpp"
+#include "shader_module_cache.hpp"
+#include "descriptor/descriptor_allocator.hpp"
 
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
@@ -20,27 +24,125 @@ namespace LIB_NAMESPACE
 		{
 			std::string vertex_shader_path;
 			std::string fragment_shader_path;
+			// set for a compute pipeline, the vertex and fragment shaders, targets and vertex inputs are then ignored
+			std::string compute_shader_path;
 
 			std::vector<VkDescriptorSetLayout> descriptor_set_layouts;
 			std::vector<VkPushConstantRange> push_constant_ranges;
 
+			// derive descriptor_set_layouts, push_constant_ranges and the instance attributes from the shaders,
+			// the descriptor set layouts are then taken from the DescriptorAllocator, see descriptorSetLayouts()
+			bool reflect = false;
+
+			// positions, normals and texture coordinates read from bindings 0, 2 and 3 with strides
+			// set when drawing, the layout of GltfModel, instead of the interleaved Vertex of binding 0
+			bool separate_vertex_streams = false;
+
+			// per-instance attributes read from vertex binding 1, see RenderAPI::drawMeshInstanced
+			// their locations must come after the Vertex attributes
+			uint32_t instance_stride = 0;
+			std::vector<VkVertexInputAttributeDescription> instance_attributes;
+
 			std::vector<uint64_t> color_target_ids;
-			uint64_t depth_target_id;
+			uint64_t depth_target_id = 0;
+
+			// formats of the targets, filled by RenderAPI from the target ids when there are any,
+			// given directly for the transient attachments of a RenderGraph
+			std::vector<VkFormat> color_formats;
+			VkFormat depth_format = VK_FORMAT_UNDEFINED;
 
+			// layout of the bindless texture table, filled by RenderAPI, reflection uses it
+			// for a set made of a single runtime array of combined image samplers
+			VkDescriptorSetLayout texture_table_layout = VK_NULL_HANDLE;
+
+			// sets bound with RenderAPI::bindFrameUniform and bindFrameStorage, reflection gives
+			// them the dynamic layouts of the uniform ring buffer, filled by RenderAPI
+			std::vector<uint32_t> frame_uniform_sets;
+			std::vector<uint32_t> frame_storage_sets;
+			VkDescriptorSetLayout frame_uniform_layout = VK_NULL_HANDLE;
+			VkDescriptorSetLayout frame_storage_layout = VK_NULL_HANDLE;
+
+			// chained after the rendering info, or to the compute pipeline info, must stay valid until the pipeline is ready
 			void* pNext = nullptr;
 		};
 
 		std::unique_ptr<core::PipelineLayout> layout;
-		std::unique_ptr<core::Pipeline> pipeline;
 
-		Pipeline(VkDevice device, const CreateInfo& create_info);
+		// the shader modules are taken from shader_modules and kept alive by the pipeline, so pipelines sharing a shader share its module
+		Pipeline(
+			VkDevice device,
+			const CreateInfo& create_info,
+			ShaderModuleCache & shader_modules,
+			DescriptorAllocator & descriptor_allocator,
+			VkPipelineCache pipeline_cache = VK_NULL_HANDLE
+		);
+		// the layout is created right away, the shaders are loaded and the pipeline compiled by a task of the pool
+		Pipeline(
+			VkDevice device,
+			const CreateInfo& create_info,
+			ShaderModuleCache & shader_modules,
+			DescriptorAllocator & descriptor_allocator,
+			VkPipelineCache pipeline_cache,
+			ThreadPool & thread_pool
+		);
 		Pipeline(const Pipeline &) = delete;
 		Pipeline(Pipeline && other);
 		~Pipeline();
 
+		// false while the pipeline is being compiled
+		bool ready() const;
+		// blocks until the pipeline is compiled, throws the compilation error if it failed
+		void wait() const;
+		// waits for the pipeline as well
+		VkPipeline getVk() const { return m_pipeline.get().pipeline->getVk(); }
+
+		bool compute() const { return m_bind_point == VK_PIPELINE_BIND_POINT_COMPUTE; }
+		VkPipelineBindPoint bindPoint() const { return m_bind_point; }
+
+		// layouts the pipeline was created with, indexed by set, to allocate its descriptor sets
+		const std::vector<VkDescriptorSetLayout> & descriptorSetLayouts() const { return m_vk_descriptor_set_layouts; }
+
 	private:
 
-		void createPipeline(VkDevice device, const CreateInfo& create_info);
+		struct Compiled
+		{
+			std::shared_ptr<core::Pipeline> pipeline;
+			std::shared_ptr<const ShaderModuleCache::Shader> vertex_shader;
+			std::shared_ptr<const ShaderModuleCache::Shader> fragment_shader;
+			std::shared_ptr<const ShaderModuleCache::Shader> compute_shader;
+		};
+
+		std::shared_future<Compiled> m_pipeline;
+		VkPipelineBindPoint m_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS;
+
+		// from the reflection of the shaders, owned by the DescriptorAllocator
+		std::vector<VkDescriptorSetLayout> m_vk_descriptor_set_layouts;
+
+		// the shaders of every stage, the vertex shader first when there is one
+		void reflect(
+			DescriptorAllocator & descriptor_allocator,
+			CreateInfo& create_info,
+			const std::vector<const ShaderModuleCache::Shader *> & shaders
+		);
+		void createLayout(VkDevice device, const CreateInfo& create_info);
+		// shaders not loaded yet are taken from shader_modules
+		static Compiled createPipeline(
+			VkDevice device,
+			const CreateInfo& create_info,
+			VkPipelineLayout pipeline_layout,
+			VkPipelineCache pipeline_cache,
+			ShaderModuleCache & shader_modules,
+			std::shared_ptr<const ShaderModuleCache::Shader> vertex_shader,
+			std::shared_ptr<const ShaderModuleCache::Shader> fragment_shader
+		);
+		static Compiled createComputePipeline(
+			VkDevice device,
+			const CreateInfo& create_info,
+			VkPipelineLayout pipeline_layout,
+			VkPipelineCache pipeline_cache,
+			ShaderModuleCache & shader_modules,
+			std::shared_ptr<const ShaderModuleCache::Shader> compute_shader
+		);
 
 	};
 }
\ No newline at end of file
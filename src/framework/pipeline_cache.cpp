@@ -0,0 +1,149 @@
+#include "pipeline_cache.hpp"
+#include "cache_file.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	namespace
+	{
+		const char magic[8] = {'C', 'V', 'P', 'C', 'A', 'C', 'H', 'E'};
+		const uint32_t version = 2;
+
+		struct Info
+		{
+			// identify the device and driver the cache was written for
+			uint32_t vendor_id;
+			uint32_t device_id;
+			uint32_t driver_version;
+			uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+			uint32_t padding;
+			uint64_t data_size;
+			uint64_t data_hash;
+		};
+
+		// FNV-1a, only meant to catch truncated or damaged files
+		uint64_t hashData(const unsigned char *data, size_t size)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < size; i++)
+			{
+				hash ^= data[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		Info makeInfo(const VkPhysicalDeviceProperties & properties)
+		{
+			Info info = {};
+			info.vendor_id = properties.vendorID;
+			info.device_id = properties.deviceID;
+			info.driver_version = properties.driverVersion;
+			std::memcpy(info.pipeline_cache_uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+			return info;
+		}
+
+		// the driver validates the data as well, but some drivers crash on a cache from another device
+		bool validVulkanHeader(const std::vector<unsigned char> & data, const VkPhysicalDeviceProperties & properties)
+		{
+			VkPipelineCacheHeaderVersionOne vulkan_header;
+			if (data.size() < sizeof(vulkan_header))
+			{
+				return false;
+			}
+			std::memcpy(&vulkan_header, data.data(), sizeof(vulkan_header));
+
+			return vulkan_header.headerSize >= sizeof(vulkan_header)
+				&& vulkan_header.headerSize <= data.size()
+				&& vulkan_header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+				&& vulkan_header.vendorID == properties.vendorID
+				&& vulkan_header.deviceID == properties.deviceID
+				&& std::memcmp(vulkan_header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		}
+
+		std::vector<unsigned char> readCacheFile(const std::string & path, const VkPhysicalDeviceProperties & properties)
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (file.is_open() == false)
+			{
+				return {};
+			}
+
+			std::vector<unsigned char> content(
+				(std::istreambuf_iterator<char>(file)),
+				std::istreambuf_iterator<char>()
+			);
+			Info info;
+			if (CacheFile::readHeader(content.data(), content.size(), magic, version, info) == false)
+			{
+				return {};
+			}
+
+			Info expected = makeInfo(properties);
+			if (
+				info.vendor_id != expected.vendor_id
+				|| info.device_id != expected.device_id
+				|| info.driver_version != expected.driver_version
+				|| std::memcmp(info.pipeline_cache_uuid, expected.pipeline_cache_uuid, VK_UUID_SIZE) != 0
+				|| info.data_size != content.size() - sizeof(CacheFile::Header)
+				|| info.data_hash != hashData(content.data() + sizeof(CacheFile::Header), info.data_size)
+			)
+			{
+				return {};
+			}
+
+			std::vector<unsigned char> data(content.begin() + sizeof(CacheFile::Header), content.end());
+			if (validVulkanHeader(data, properties) == false)
+			{
+				return {};
+			}
+
+			return data;
+		}
+	}
+
+	PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string & path):
+		m_path(path)
+	{
+		vkGetPhysicalDeviceProperties(physicalDevice, &m_properties);
+
+		std::vector<unsigned char> data;
+		if (m_path.empty() == false)
+		{
+			data = readCacheFile(m_path, m_properties);
+		}
+
+		core::PipelineCache::CreateInfo createInfo;
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+		m_cache = std::make_unique<core::PipelineCache>(device, createInfo);
+		m_loaded = data.empty() == false;
+	}
+
+	PipelineCache::~PipelineCache()
+	{
+	}
+
+	bool PipelineCache::save() const
+	{
+		if (m_path.empty())
+		{
+			return false;
+		}
+
+		std::vector<unsigned char> data = m_cache->getData();
+
+		Info info = makeInfo(m_properties);
+		info.data_size = data.size();
+		info.data_hash = hashData(data.data(), data.size());
+
+		return CacheFile::write(m_path, CacheFile::makeHeader(magic, version, info), {
+			{ data.data(), data.size() }
+		});
+	}
+}
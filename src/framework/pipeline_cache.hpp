@@ -0,0 +1,46 @@
+#pragma once
+
+#include "defines.hpp"
+#include "core/pipeline/pipeline_cache.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <string>
+
+namespace LIB_NAMESPACE
+{
+	// Device-wide VkPipelineCache persisted to a file, so pipelines compiled by a previous run are reused.
+	// The file is tagged with the vendor, device, driver version and pipeline cache UUID it was written for
+	// and ignored when any of them differ or its data is corrupted, the cache then starts empty.
+	class PipelineCache
+	{
+
+	public:
+
+		// an empty path keeps the cache in memory only
+		PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string & path);
+		PipelineCache(const PipelineCache &) = delete;
+		PipelineCache(PipelineCache && other) = delete;
+		PipelineCache & operator=(const PipelineCache &) = delete;
+		PipelineCache & operator=(PipelineCache && other) = delete;
+		~PipelineCache();
+
+		VkPipelineCache getVk() const { return m_cache->getVk(); }
+
+		// true when the cache was filled from the file
+		bool loaded() const { return m_loaded; }
+
+		// returns false when the file could not be written, nothing is lost but the next startup time
+		bool save() const;
+
+	private:
+
+		std::unique_ptr<core::PipelineCache> m_cache;
+
+		std::string m_path;
+		VkPhysicalDeviceProperties m_properties;
+		bool m_loaded = false;
+
+	};
+}
@@ -1,4 +1,5 @@
 #include "render_api.hpp"
+#include "trace.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -10,16 +11,33 @@
 #include <set>
 #include <chrono>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
 
 namespace LIB_NAMESPACE
 {
 
-	RenderAPI::RenderAPI(GLFWwindow *glfwWindow):
-		m_device(glfwWindow)
+	RenderAPI::RenderAPI(GLFWwindow *glfwWindow, const std::string & pipeline_cache_path):
+		m_device(glfwWindow, pipeline_cache_path)
 	{
 		createCommandPool();
+		createMipmapGenerator();
 		createSwapchain();
 		createSyncObjects();
+		createUniformRing();
+		createGpuProfiler();
+	}
+
+	RenderAPI::RenderAPI(VkExtent2D extent, const std::string & pipeline_cache_path):
+		m_device(nullptr, pipeline_cache_path),
+		m_headless_extent(extent)
+	{
+		createCommandPool();
+		createMipmapGenerator();
+		createSyncObjects();
+		createUniformRing();
+		createGpuProfiler();
 	}
 
 	RenderAPI::~RenderAPI()
@@ -65,22 +83,12 @@ namespace LIB_NAMESPACE
 		m_swapchain.reset();
 		createSwapchain();
 
-		std::vector<uint64_t> color_target_ids;
-		for (auto& color_target : m_color_target_map)
-		{
-			color_target_ids.push_back(color_target.first);
-		}
-		for (auto& color_target_id : color_target_ids)
+		for (auto& color_target_id : m_color_target_map.ids())
 		{
 			createColorTarget(color_target_id);
 		}
 
-		std::vector<uint64_t> depth_target_ids;
-		for (auto& depth_target : m_depth_target_map)
-		{
-			depth_target_ids.push_back(depth_target.first);
-		}
-		for (auto& depth_target_id : depth_target_ids)
+		for (auto& depth_target_id : m_depth_target_map.ids())
 		{
 			createDepthTarget(depth_target_id);
 		}
@@ -92,6 +100,11 @@ namespace LIB_NAMESPACE
 		commandInfo.queueFamilyIndex = m_device.physicalDevice().queueFamilyIndices().graphicsFamily.value();
 		commandInfo.queue = m_device.graphicsQueue().getVk();
 		commandInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		if (m_device.hasDedicatedTransferQueue())
+		{
+			commandInfo.transferQueueFamilyIndex = m_device.transferFamily();
+			commandInfo.transferQueue = m_device.transferQueue().getVk();
+		}
 
 		m_command = std::make_unique<Command>(m_device.device().getVk(), commandInfo);
 
@@ -102,11 +115,21 @@ namespace LIB_NAMESPACE
 		}
 	}
 
+	void RenderAPI::createMipmapGenerator()
+	{
+		m_mipmap_generator = std::make_unique<MipmapGenerator>(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk(),
+			m_device.device().enabledFeatures(),
+			m_device.descriptorAllocator(),
+			m_device.pipelineCache().getVk()
+		);
+	}
+
 	void RenderAPI::createSyncObjects()
 	{
 		m_image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		m_render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		m_swapchain_updated_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		m_in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
 
 		core::Semaphore::CreateInfo semaphoreInfo{};
@@ -118,12 +141,66 @@ namespace LIB_NAMESPACE
 		{
 			m_image_available_semaphores[i] = std::make_unique<core::Semaphore>(m_device.device().getVk(), semaphoreInfo);
 			m_render_finished_semaphores[i] = std::make_unique<core::Semaphore>(m_device.device().getVk(), semaphoreInfo);
-			m_swapchain_updated_semaphores[i] = std::make_unique<core::Semaphore>(m_device.device().getVk(), semaphoreInfo);
 			m_in_flight_fences[i] = std::make_unique<core::Fence>(m_device.device().getVk(), fenceInfo);
 		}
 
 	}
 
+	void RenderAPI::createUniformRing()
+	{
+		UniformRingBuffer::CreateInfo ringInfo{};
+
+		m_uniform_ring = std::make_unique<UniformRingBuffer>(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk(),
+			m_device.descriptorAllocator(),
+			ringInfo
+		);
+	}
+
+	void RenderAPI::createGpuProfiler()
+	{
+		m_gpu_profiler = std::make_unique<GpuProfiler>(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk(),
+			m_device.physicalDevice().queueFamilyIndices().graphicsFamily.value()
+		);
+	}
+
+
+	void RenderAPI::submitFrame(const VkSubmitInfo & submitInfo)
+	{
+		TRACE_ZONE("submit frame");
+
+		m_device.graphicsQueue().submit(1, &submitInfo, m_in_flight_fences[m_current_frame]->getVk());
+	}
+
+	void RenderAPI::updateFrameStats()
+	{
+		m_frame_count++;
+
+		auto now = std::chrono::steady_clock::now();
+		std::chrono::duration<double> elapsed = now - m_frame_count_start;
+
+		if (elapsed.count() >= 1.0)
+		{
+			m_frames_per_second = m_frame_count / elapsed.count();
+			TRACE_COUNTER("frames per second", m_frames_per_second);
+			m_frame_count = 0;
+			m_frame_count_start = now;
+		}
+	}
+
+	VkExtent2D RenderAPI::targetExtent() const
+	{
+		if (m_device.headless())
+		{
+			return m_headless_extent;
+		}
+
+		return m_swapchain->extent();
+	}
+
 
 	uint64_t RenderAPI::createColorTarget(uint64_t id)
 	{
@@ -132,7 +209,7 @@ namespace LIB_NAMESPACE
 		Image color_target = Image::createColorImage(
 			m_device.device().getVk(),
 			m_device.physicalDevice().getVk(),
-			m_swapchain->extent(),
+			targetExtent(),
 			VK_FORMAT_R16G16B16A16_SFLOAT
 		);
 
@@ -167,7 +244,7 @@ namespace LIB_NAMESPACE
 		Image depth_target = Image::createDepthImage(
 			m_device.device().getVk(),
 			m_device.physicalDevice().getVk(),
-			m_swapchain->extent(),
+			targetExtent(),
 			findDepthFormat()
 		);
 
@@ -235,148 +312,50 @@ namespace LIB_NAMESPACE
 		return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 	}
 
-
-	void RenderAPI::generateMipmaps(VkImage image, VkFormat format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
+	void RenderAPI::copyRenderedImageToSwapchainImage(
+		VkCommandBuffer cmd,
+		uint64_t color_target_id,
+		uint32_t swapchain_image_index
+	)
 	{
-		// Check if image format supports linear blitting
-		VkFormatProperties formatProperties;
-		vkGetPhysicalDeviceFormatProperties(m_device.physicalDevice().getVk(), format, &formatProperties);
+		Image & target_image = m_color_target_map.get(color_target_id);
 
-		if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+		VkImageMemoryBarrier barriers[2] = {};
+		for (auto& barrier : barriers)
 		{
-			throw std::runtime_error("texture image format does not support linear blitting.");
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = 1;
 		}
 
-		VkCommandBuffer commandBuffer = m_command->beginSingleTimeCommands();
-
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.image = image;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		barrier.subresourceRange.levelCount = 1;
-
-		int32_t mipWidth = texWidth;
-		int32_t mipHeight = texHeight;
-
-		for (uint32_t i = 1; i < mipLevels; i++)
-		{
-			barrier.subresourceRange.baseMipLevel = i - 1;
-			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-			vkCmdPipelineBarrier(
-				commandBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-				0,
-				0, nullptr,
-				0, nullptr,
-				1, &barrier
-			);
-
-			VkImageBlit blit{};
-			blit.srcOffsets[0] = {0, 0, 0};
-			blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.srcSubresource.mipLevel = i - 1;
-			blit.srcSubresource.baseArrayLayer = 0;
-			blit.srcSubresource.layerCount = 1;
-
-			blit.dstOffsets[0] = {0, 0, 0};
-			blit.dstOffsets[1] = {
-				mipWidth > 1 ? mipWidth / 2 : 1,
-				mipHeight > 1 ? mipHeight / 2 : 1,
-				1
-			};
-			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.dstSubresource.mipLevel = i;
-			blit.dstSubresource.baseArrayLayer = 0;
-			blit.dstSubresource.layerCount = 1;
-
-			vkCmdBlitImage(
-				commandBuffer,
-				image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1, &blit,
-				VK_FILTER_LINEAR
-			);
-
-			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			vkCmdPipelineBarrier(
-				commandBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				0,
-				0, nullptr,
-				0, nullptr,
-				1, &barrier
-			);
-
-			if (mipWidth > 1) mipWidth /= 2;
-			if (mipHeight > 1) mipHeight /= 2;
-		}
+		// First, the swap chain image goes to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL and the offscreen image to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL.
+		// The swap chain image wait semaphore is waited at the color attachment output stage, so the barrier starts from there.
+		barriers[0].image = m_swapchain->image(swapchain_image_index);
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[0].srcAccessMask = 0;
+		barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 
-		barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[1].image = target_image.image();
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
 		vkCmdPipelineBarrier(
-			commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			cmd,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
 			0,
 			0, nullptr,
 			0, nullptr,
-			1, &barrier
-		);
-
-		m_command->endSingleTimeCommands(commandBuffer);
-	}
-
-	void RenderAPI::copyRenderedImageToSwapchainImage(uint64_t color_target_id, uint32_t swapchain_image_index)
-	{
-		Image & target_image = m_color_target_map.get(color_target_id);
-
-		// First, we need to transition the swap chain image to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL layout, so we can copy the offscreen image to it.
-		m_command->transitionImageLayout(
-			m_swapchain->image(swapchain_image_index),
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			1,
-			0,
-			0,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT
-		);
-
-		// Then we need to transition the offscreen image to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL layout, so we can copy it to the swap chain image.
-		m_command->transitionImageLayout(
-			target_image.image(),
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			1,
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			0,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
+			2, barriers
 		);
 
-		// The offscreen image is allready in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL layout, so we can copy it to the swap chain image.
-		VkCommandBuffer commandBuffer = m_command->beginSingleTimeCommands();
-
 		// copy with blit
 		VkImageBlit blit{};
 		blit.srcOffsets[0] = {0, 0, 0};
@@ -402,7 +381,7 @@ namespace LIB_NAMESPACE
 		blit.dstSubresource.layerCount = 1;
 
 		vkCmdBlitImage(
-			commandBuffer,
+			cmd,
 			target_image.image(),
 			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 			m_swapchain->image(swapchain_image_index),
@@ -412,64 +391,25 @@ namespace LIB_NAMESPACE
 			VK_FILTER_LINEAR
 		);
 
-		VkResult result = vkEndCommandBuffer(commandBuffer);
-		if (result != VK_SUCCESS)
-		{
-			TROW("Failed to record command buffer", result);
-		}
-
-		VkSubmitInfo copyImageInfo = {};
-		copyImageInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		copyImageInfo.commandBufferCount = 1;
-		copyImageInfo.pCommandBuffers = &commandBuffer;
-
-		VkSemaphore copyImageWaitSemaphores[] = {
-			m_image_available_semaphores[m_current_frame]->getVk(),
-			m_render_finished_semaphores[m_current_frame]->getVk()
-		};
-		VkPipelineStageFlags copyImageWaitStages[] = {
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-		};
-		copyImageInfo.waitSemaphoreCount = 2;
-		copyImageInfo.pWaitSemaphores = copyImageWaitSemaphores;
-		copyImageInfo.pWaitDstStageMask = copyImageWaitStages;
-
-		VkSemaphore copyImageSignalSemaphores[] = {
-			m_swapchain_updated_semaphores[m_current_frame]->getVk()
-		};
-		copyImageInfo.signalSemaphoreCount = 1;
-		copyImageInfo.pSignalSemaphores = copyImageSignalSemaphores;
-
-		m_command->submit(1, &copyImageInfo, VK_NULL_HANDLE);
-
-		m_command->queueWaitIdle();
-		m_command->freeCommandBuffer(commandBuffer);
+		// Then the swap chain image goes to VK_IMAGE_LAYOUT_PRESENT_SRC_KHR so we can present it,
+		// and the offscreen image back to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL so we can render to it again.
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers[0].dstAccessMask = 0;
 
-		// Now we need to transition the swap chain image to VK_IMAGE_LAYOUT_PRESENT_SRC_KHR layout, so we can present it.
-		m_command->transitionImageLayout(
-			m_swapchain->image(swapchain_image_index),
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			1,
-			0,
-			0,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
-		);
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barriers[1].srcAccessMask = 0;
+		barriers[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
-		// And we need to transition the offscreen image back to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL layout, so we can render to it again.
-		m_command->transitionImageLayout(
-			target_image.image(),
-			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			1,
-			0,
+		vkCmdPipelineBarrier(
+			cmd,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
 			0,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+			0, nullptr,
+			0, nullptr,
+			2, barriers
 		);
 	}
 
@@ -477,24 +417,44 @@ namespace LIB_NAMESPACE
 
 	void RenderAPI::startDraw()
 	{
+		TRACE_ZONE("startDraw");
+
 		std::unique_lock<std::mutex> lock(m_global_mutex);
 
 		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
 
-		m_in_flight_fences[m_current_frame]->wait();
+		{
+			TRACE_ZONE("wait frame fence");
+			m_in_flight_fences[m_current_frame]->wait();
+		}
 		m_in_flight_fences[m_current_frame]->reset();
 
+		// the secondary command buffers of this frame are done executing
+		resetThreadCommands();
+		// and so are its transient descriptor sets and uniform data
+		m_device.descriptorAllocator().resetFrame(m_current_frame);
+		m_uniform_ring->beginFrame(m_current_frame);
+
+		releaseRetiredTextures();
+		uploadDecodedTextures();
+
+		m_bound_mesh_id = Map<Mesh>::no_id;
+
 		vkResetCommandBuffer(cmd, 0);
 
 		VkCommandBufferBeginInfo beginInfo = {};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
 		vkBeginCommandBuffer(cmd, &beginInfo);
+
+		// the fence of this frame has signaled, its timestamps are read without waiting
+		m_gpu_profiler->beginFrame(cmd, m_current_frame);
 	}
 
 	void RenderAPI::startRendering(
 		const std::vector<uint64_t> & color_target_ids,
-		uint64_t depth_target_id
+		uint64_t depth_target_id,
+		bool secondary_command_buffers
 	)
 	{
 		#ifndef NDEBUG
@@ -537,6 +497,19 @@ namespace LIB_NAMESPACE
 		rendering_info.pColorAttachments = color_attachments.data();
 		rendering_info.pDepthAttachment = &depth_attachment;
 
+		if (secondary_command_buffers)
+		{
+			rendering_info.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+		}
+
+		m_rendering_color_formats.resize(color_target_ids.size());
+		for (size_t i = 0; i < color_target_ids.size(); i++)
+		{
+			m_rendering_color_formats[i] = m_color_target_map.get(color_target_ids[i]).format();
+		}
+		m_rendering_depth_format = m_depth_target_map.get(depth_target_id).format();
+
+		m_gpu_profiler->beginScope(m_vk_command_buffers[m_current_frame], "rendering");
 		vkCmdBeginRendering(m_vk_command_buffers[m_current_frame], &rendering_info);
 	}
 
@@ -547,37 +520,61 @@ namespace LIB_NAMESPACE
 		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
 
 		vkCmdEndRendering(cmd);
+		m_gpu_profiler->endScope(cmd);
 	}
 
 	void RenderAPI::endDraw(uint64_t color_target_id)
 	{
+		TRACE_ZONE("endDraw");
+
 		std::unique_lock<std::mutex> lock(m_global_mutex);
 
-		vkEndCommandBuffer(m_vk_command_buffers[m_current_frame]);
+		TRACE_COUNTER("frame uniform bytes", m_uniform_ring->frameUsage());
+
+		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
+
+		// the blit to the swapchain image is not part of the measured frame
+		m_gpu_profiler->endFrame(cmd);
 
 		VkSubmitInfo renderInfo{};
 		renderInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-		VkCommandBuffer commandBuffers[] = {m_vk_command_buffers[m_current_frame]};
+		VkCommandBuffer commandBuffers[] = {cmd};
 		renderInfo.commandBufferCount = 1;
 		renderInfo.pCommandBuffers = commandBuffers;
 
-		VkSemaphore signalSemaphores[] = {m_render_finished_semaphores[m_current_frame]->getVk()};
-		renderInfo.signalSemaphoreCount = 1;
-		renderInfo.pSignalSemaphores = signalSemaphores;
-
-		m_device.graphicsQueue().submit(1, &renderInfo, m_in_flight_fences[m_current_frame]->getVk());
+		if (m_device.headless())
+		{
+			// the frame stays in the color target, there is nothing to acquire or present
+			vkEndCommandBuffer(cmd);
 
+			// pending uploads and layout transitions are submitted before the frame that uses them
+			m_command->flush();
+			submitFrame(renderInfo);
 
-		// Now instead of rendering directly to the swap chain image, we render to the offscreen image, and then copy it to the swap chain image.
+			updateFrameStats();
+			m_current_frame = (m_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+			return;
+		}
 
+		// Instead of rendering directly to the swap chain image, we render to the offscreen image,
+		// and the blit to the swap chain image is recorded at the end of the frame command buffer.
 		uint32_t imageIndex;
-		VkResult result = m_swapchain->acquireNextImage(
-			UINT64_MAX, m_image_available_semaphores[m_current_frame]->getVk(), VK_NULL_HANDLE, &imageIndex
-		);
+		VkResult result;
+		{
+			TRACE_ZONE("acquire swapchain image");
+			result = m_swapchain->acquireNextImage(
+				UINT64_MAX, m_image_available_semaphores[m_current_frame]->getVk(), VK_NULL_HANDLE, &imageIndex
+			);
+		}
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR)
 		{
+			// submit the frame anyway so its fence gets signaled, it is just not presented
+			vkEndCommandBuffer(cmd);
+			m_command->flush();
+			submitFrame(renderInfo);
+
 			recreateSwapChain();
 			return;
 		}
@@ -586,24 +583,43 @@ namespace LIB_NAMESPACE
 			throw std::runtime_error("failed to acquire swap chain image!");
 		}
 
-		copyRenderedImageToSwapchainImage(color_target_id, imageIndex);
+		copyRenderedImageToSwapchainImage(cmd, color_target_id, imageIndex);
 
-		// Finally, we present the swap chain image.
+		vkEndCommandBuffer(cmd);
+
+		VkSemaphore waitSemaphores[] = {m_image_available_semaphores[m_current_frame]->getVk()};
+		VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+		renderInfo.waitSemaphoreCount = 1;
+		renderInfo.pWaitSemaphores = waitSemaphores;
+		renderInfo.pWaitDstStageMask = waitStages;
+
+		VkSemaphore signalSemaphores[] = {m_render_finished_semaphores[m_current_frame]->getVk()};
+		renderInfo.signalSemaphoreCount = 1;
+		renderInfo.pSignalSemaphores = signalSemaphores;
+
+		// pending uploads and layout transitions are submitted before the frame that uses them
+		m_command->flush();
+
+		submitFrame(renderInfo);
+
+		updateFrameStats();
+
+		// Finally, we present the swap chain image, only waiting for the frame on the GPU.
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
-		VkSemaphore copyImageSignalSemaphores[] = {
-			m_swapchain_updated_semaphores[m_current_frame]->getVk()
-		};
 		presentInfo.waitSemaphoreCount = 1;
-		presentInfo.pWaitSemaphores = copyImageSignalSemaphores;
+		presentInfo.pWaitSemaphores = signalSemaphores;
 
 		VkSwapchainKHR swapChains[] = {m_swapchain->getVk()};
 		presentInfo.swapchainCount = 1;
 		presentInfo.pSwapchains = swapChains;
 		presentInfo.pImageIndices = &imageIndex;
 
-		result = vkQueuePresentKHR(m_device.presentQueue().getVk(), &presentInfo);
+		{
+			TRACE_ZONE("present");
+			result = vkQueuePresentKHR(m_device.presentQueue().getVk(), &presentInfo);
+		}
 
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
@@ -622,11 +638,32 @@ namespace LIB_NAMESPACE
 
 	uint64_t RenderAPI::loadModel(const std::string & filename)
 	{
-		std::unique_lock<std::mutex> lock(m_global_mutex);
+		TRACE_ZONE("loadModel");
+
+		// parsing does not touch the device, other threads can keep drawing meanwhile
+		std::unique_ptr<MeshCache> cache = MeshCache::open(filename);
 
 		Mesh::CreateInfo meshInfo = {};
+		if (cache == nullptr)
+		{
+			Mesh::readObjFile(filename, meshInfo.vertices, meshInfo.indices);
+			MeshCache::write(filename, meshInfo.vertices, meshInfo.indices);
+		}
 
-		Mesh::readObjFile(filename, meshInfo.vertices, meshInfo.indices);
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		if (cache != nullptr)
+		{
+			return m_mesh_map.insert(Mesh(
+				m_device.device().getVk(),
+				m_device.physicalDevice().getVk(),
+				*m_command.get(),
+				cache->vertices(),
+				cache->vertexCount(),
+				cache->indices(),
+				cache->indexCount()
+			));
+		}
 
 		return m_mesh_map.insert(Mesh(
 			m_device.device().getVk(),
@@ -636,6 +673,55 @@ namespace LIB_NAMESPACE
 		));
 	}
 
+	uint64_t RenderAPI::loadGltf(const std::string & filename)
+	{
+		TRACE_ZONE("loadGltf");
+
+		GltfModel::CreateInfo modelInfo = GltfModel::readFile(filename);
+
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		std::vector<uint64_t> texture_ids;
+		for (auto& image : modelInfo.images)
+		{
+			Texture::CreateInfo textureInfo = {};
+			textureInfo.pixels = image.pixels.data();
+			textureInfo.width = image.width;
+			textureInfo.height = image.height;
+			textureInfo.format = image.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+			textureInfo.mipLevel = static_cast<uint32_t>(std::floor(std::log2(std::max(image.width, image.height)))) + 1;
+			textureInfo.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+			texture_ids.push_back(createTexture(textureInfo));
+
+			// the staging buffer holds a copy, the decoded pixels are not needed anymore
+			image.pixels = std::vector<unsigned char>();
+		}
+
+		for (auto& material : modelInfo.materials)
+		{
+			if (material.base_color_image >= 0)
+			{
+				material.base_color_texture_id = texture_ids[material.base_color_image];
+			}
+			if (material.metallic_roughness_image >= 0)
+			{
+				material.metallic_roughness_texture_id = texture_ids[material.metallic_roughness_image];
+			}
+			if (material.normal_image >= 0)
+			{
+				material.normal_texture_id = texture_ids[material.normal_image];
+			}
+		}
+
+		return m_gltf_model_map.insert(GltfModel(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk(),
+			*m_command.get(),
+			modelInfo
+		));
+	}
+
 	uint64_t RenderAPI::newDescriptor(VkDescriptorSetLayoutBinding layoutBinding)
 	{
 		std::unique_lock<std::mutex> lock(m_global_mutex);
@@ -645,106 +731,665 @@ namespace LIB_NAMESPACE
 		descriptorInfo.descriptor_count = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
 		return m_descriptor_map.insert(Descriptor(
-			m_device.device().getVk(),
+			m_device.descriptorAllocator(),
 			descriptorInfo
 		));
 	}
 
-	uint64_t RenderAPI::loadTexture(Texture::CreateInfo & createInfo)
+	uint32_t RenderAPI::textureIndex(uint64_t texture_id)
 	{
-		std::unique_lock<std::mutex> lock(m_global_mutex);
-
-		uint64_t texture_id = m_texture_map.insert(Texture(
-			m_device.device().getVk(),
-			m_device.physicalDevice().getVk(),
-			*m_command.get(),
-			createInfo
-		));
-
-		generateMipmaps(
-			m_texture_map.get(texture_id).image().image(),
-			VK_FORMAT_R8G8B8A8_SRGB,
-			m_texture_map.get(texture_id).width(),
-			m_texture_map.get(texture_id).height(),
-			m_texture_map.get(texture_id).image().mipLevels()
-		);
-
-		return texture_id;
+		if (bindlessTextures() == false)
+		{
+			throw std::runtime_error("failed to get texture index: bindless textures are not supported by the device");
+		}
+		return m_texture_map.get(texture_id).bindlessIndex();
 	}
 
-	uint64_t RenderAPI::newPipeline(Pipeline::CreateInfo & createInfo)
+	VkDescriptorSetLayout RenderAPI::textureTableLayout()
 	{
-		std::unique_lock<std::mutex> lock(m_global_mutex);
-
-		std::vector<VkFormat> colorAttachementFormats;
-		for (auto& color_target_id : createInfo.color_target_ids)
+		if (bindlessTextures() == false)
 		{
-			colorAttachementFormats.push_back(m_color_target_map.get(color_target_id).format());
+			throw std::runtime_error("failed to get texture table layout: bindless textures are not supported by the device");
 		}
+		return m_device.textureTable()->layout();
+	}
 
-		VkPipelineRenderingCreateInfo renderingInfo = {};
-		renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
-		renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachementFormats.size());
-		renderingInfo.pColorAttachmentFormats = colorAttachementFormats.data();
-		renderingInfo.depthAttachmentFormat = m_depth_target_map.get(createInfo.depth_target_id).format();
-
-		createInfo.pNext = &renderingInfo;
-
-		return m_pipeline_map.insert(Pipeline(
-			m_device.device().getVk(),
-			createInfo
-		));
+	VkDescriptorSetLayout RenderAPI::descriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding> & bindings)
+	{
+		return m_device.descriptorAllocator().layout(bindings);
 	}
 
-	uint64_t RenderAPI::newUniformBuffer(const UniformBuffer::CreateInfo & create_info)
+	VkDescriptorSet RenderAPI::allocateTransientSet(VkDescriptorSetLayout layout)
 	{
 		std::unique_lock<std::mutex> lock(m_global_mutex);
 
-		return m_uniform_buffer_map.insert(UniformBuffer(
-			m_device.device().getVk(),
-			m_device.physicalDevice().getVk(),
-			create_info
-		));
+		return m_device.descriptorAllocator().allocateTransient(layout, m_current_frame);
 	}
 
-	uint64_t RenderAPI::newColorTarget()
+	VkDescriptorSetLayout RenderAPI::pipelineSetLayout(uint64_t pipelineID, uint32_t set)
 	{
-		std::unique_lock<std::mutex> lock(m_global_mutex);
-
-		return createColorTarget();
+		return m_pipeline_map.get(pipelineID).descriptorSetLayouts().at(set);
 	}
 
-	uint64_t RenderAPI::newDepthTarget()
+	void RenderAPI::writeStorageBuffer(
+		VkDescriptorSet set,
+		uint32_t binding,
+		uint64_t buffer_id,
+		VkDeviceSize offset,
+		VkDeviceSize range
+	)
 	{
 		std::unique_lock<std::mutex> lock(m_global_mutex);
 
-		return createDepthTarget();
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = m_buffer_map.get(buffer_id).buffer();
+		bufferInfo.offset = offset;
+		bufferInfo.range = range;
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = set;
+		descriptorWrite.dstBinding = binding;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pBufferInfo = &bufferInfo;
+
+		vkUpdateDescriptorSets(m_device.device().getVk(), 1, &descriptorWrite, 0, nullptr);
 	}
 
-
-	void RenderAPI::bindPipeline(uint64_t pipelineID)
+	void RenderAPI::writeStorageImage(VkDescriptorSet set, uint32_t binding, uint64_t storage_image_id)
 	{
 		std::unique_lock<std::mutex> lock(m_global_mutex);
 
-		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageView = m_storage_image_map.get(storage_image_id).view();
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_map.get(pipelineID).pipeline->getVk());
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = set;
+		descriptorWrite.dstBinding = binding;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(m_device.device().getVk(), 1, &descriptorWrite, 0, nullptr);
 	}
 
-	void RenderAPI::bindDescriptor(
-		uint64_t pipelineID,
-		uint32_t firstSet,
-		uint32_t descriptorSetCount,
-		const VkDescriptorSet *pDescriptorSets
-	)
+	uint64_t RenderAPI::loadTexture(Texture::CreateInfo & createInfo)
 	{
+		TRACE_ZONE("loadTexture");
+
 		std::unique_lock<std::mutex> lock(m_global_mutex);
 
-		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
+		return createTexture(createInfo);
+	}
 
-		vkCmdBindDescriptorSets(
+	uint64_t RenderAPI::loadTextureAsync(const Texture::CreateInfo & createInfo)
+	{
+		TRACE_ZONE("loadTextureAsync");
+
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		Texture::CreateInfo textureInfo = createInfo;
+		if (textureInfo.pixels != nullptr || textureInfo.compressed != nullptr)
+		{
+			return createTexture(textureInfo);
+		}
+
+		// one white texel until the file is decoded and uploaded
+		const unsigned char white[4] = { 255, 255, 255, 255 };
+		Texture::CreateInfo placeholderInfo = createInfo;
+		placeholderInfo.pixels = white;
+		placeholderInfo.width = 1;
+		placeholderInfo.height = 1;
+		placeholderInfo.mipLevel = 1;
+		placeholderInfo.compressed = nullptr;
+
+		PendingTexture pending;
+		pending.texture_id = createTexture(placeholderInfo);
+		pending.create_info = textureInfo;
+
+		std::string filepath = textureInfo.filepath;
+		VkFormat format = textureInfo.format;
+		pending.pixels = m_thread_pool.submit([filepath, format]()
+		{
+			TRACE_ZONE("decode texture");
+			return Texture::decode(filepath, format);
+		});
+
+		m_pending_textures.push_back(std::move(pending));
+		return m_pending_textures.back().texture_id;
+	}
+
+	bool RenderAPI::textureReady(uint64_t texture_id)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		for (auto& pending : m_pending_textures)
+		{
+			if (pending.texture_id == texture_id)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void RenderAPI::waitTexture(uint64_t texture_id)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		for (auto it = m_pending_textures.begin(); it != m_pending_textures.end(); it++)
+		{
+			if (it->texture_id == texture_id)
+			{
+				PendingTexture pending = std::move(*it);
+				m_pending_textures.erase(it);
+				uploadTexture(pending);
+				break;
+			}
+		}
+
+		auto failed = m_failed_textures.find(texture_id);
+		if (failed != m_failed_textures.end())
+		{
+			std::rethrow_exception(failed->second);
+		}
+	}
+
+	uint64_t RenderAPI::createTexture(Texture::CreateInfo & createInfo)
+	{
+		return m_texture_map.insert(buildTexture(createInfo));
+	}
+
+	Texture RenderAPI::buildTexture(Texture::CreateInfo & createInfo)
+	{
+		TRACE_ZONE("createTexture");
+
+		Texture texture(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk(),
+			*m_command.get(),
+			m_device.descriptorAllocator(),
+			m_device.textureTable(),
+			*m_mipmap_generator.get(),
+			createInfo
+		);
+
+		return texture;
+	}
+
+	void RenderAPI::uploadDecodedTextures()
+	{
+		VkDeviceSize uploaded = 0;
+
+		for (auto it = m_pending_textures.begin(); it != m_pending_textures.end() && uploaded < texture_upload_budget;)
+		{
+			if (it->pixels.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				it++;
+				continue;
+			}
+
+			PendingTexture pending = std::move(*it);
+			it = m_pending_textures.erase(it);
+			uploaded += uploadTexture(pending);
+		}
+	}
+
+	VkDeviceSize RenderAPI::uploadTexture(PendingTexture & pending)
+	{
+		Texture::Pixels pixels;
+		try
+		{
+			pixels = pending.pixels.get();
+		}
+		catch (const std::exception &)
+		{
+			// the placeholder stays, waitTexture reports the error
+			m_failed_textures[pending.texture_id] = std::current_exception();
+			return 0;
+		}
+
+		if (m_texture_map.contains(pending.texture_id) == false)
+		{
+			return 0;
+		}
+
+		Texture::CreateInfo textureInfo = pending.create_info;
+		textureInfo.pixels = pixels.data.get();
+		textureInfo.width = pixels.width;
+		textureInfo.height = pixels.height;
+		textureInfo.compressed = pixels.compressed.get();
+
+		// the copy is recorded in the upload batch, flushed before the next frame that can sample it
+		Texture texture = buildTexture(textureInfo);
+		m_texture_map.get(pending.texture_id).swap(texture);
+
+		// frames in flight may still sample the placeholder
+		RetiredTexture retired{ std::make_unique<Texture>(std::move(texture)), (1u << MAX_FRAMES_IN_FLIGHT) - 1 };
+		m_retired_textures.push_back(std::move(retired));
+
+		if (pixels.compressed != nullptr)
+		{
+			return pixels.compressed->size();
+		}
+		return static_cast<VkDeviceSize>(pixels.width) * pixels.height * 4;
+	}
+
+	void RenderAPI::releaseRetiredTextures()
+	{
+		// the fence of the current frame has just been waited
+		for (auto it = m_retired_textures.begin(); it != m_retired_textures.end();)
+		{
+			it->pending_frames &= ~(1u << m_current_frame);
+			if (it->pending_frames == 0)
+			{
+				it = m_retired_textures.erase(it);
+			}
+			else
+			{
+				it++;
+			}
+		}
+	}
+
+	uint64_t RenderAPI::newPipeline(Pipeline::CreateInfo & createInfo)
+	{
+		TRACE_ZONE("newPipeline");
+
+		{
+			std::unique_lock<std::mutex> lock(m_global_mutex);
+
+			setPipelineFormats(createInfo);
+		}
+
+		// compiled without the global lock, other threads can keep drawing meanwhile
+		return m_pipeline_map.insert(Pipeline(
+			m_device.device().getVk(),
+			createInfo,
+			m_device.shaderModuleCache(),
+			m_device.descriptorAllocator(),
+			m_device.pipelineCache().getVk()
+		));
+	}
+
+	uint64_t RenderAPI::newComputePipeline(Pipeline::CreateInfo & createInfo)
+	{
+		if (createInfo.compute_shader_path.empty())
+		{
+			throw std::runtime_error("failed to create compute pipeline: no compute shader given");
+		}
+
+		return newPipeline(createInfo);
+	}
+
+	uint64_t RenderAPI::newPipelineAsync(Pipeline::CreateInfo & createInfo)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_global_mutex);
+
+			setPipelineFormats(createInfo);
+		}
+
+		return m_pipeline_map.insert(Pipeline(
+			m_device.device().getVk(),
+			createInfo,
+			m_device.shaderModuleCache(),
+			m_device.descriptorAllocator(),
+			m_device.pipelineCache().getVk(),
+			m_thread_pool
+		));
+	}
+
+	void RenderAPI::setPipelineFormats(Pipeline::CreateInfo & createInfo)
+	{
+		// a compute pipeline has no attachments
+		if (createInfo.compute_shader_path.empty() == false)
+		{
+			createInfo.color_formats.clear();
+		}
+		else if (createInfo.color_target_ids.empty() == false)
+		{
+			createInfo.color_formats.clear();
+			for (auto& color_target_id : createInfo.color_target_ids)
+			{
+				createInfo.color_formats.push_back(m_color_target_map.get(color_target_id).format());
+			}
+
+			createInfo.depth_format = m_depth_target_map.get(createInfo.depth_target_id).format();
+		}
+
+		if (m_device.textureTable() != nullptr)
+		{
+			createInfo.texture_table_layout = m_device.textureTable()->layout();
+		}
+		createInfo.frame_uniform_layout = frameUniformLayout();
+		createInfo.frame_storage_layout = frameStorageLayout();
+	}
+
+	bool RenderAPI::pipelineReady(uint64_t pipelineID)
+	{
+		return m_pipeline_map.get(pipelineID).ready();
+	}
+
+	void RenderAPI::waitPipeline(uint64_t pipelineID)
+	{
+		m_pipeline_map.get(pipelineID).wait();
+	}
+
+	uint64_t RenderAPI::newUniformBuffer(const UniformBuffer::CreateInfo & create_info)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		return m_uniform_buffer_map.insert(UniformBuffer(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk(),
+			m_device.descriptorAllocator(),
+			create_info
+		));
+	}
+
+	UniformRingBuffer::Allocation RenderAPI::allocateFrameUniform(uint32_t size)
+	{
+		return m_uniform_ring->allocateUniform(size);
+	}
+
+	UniformRingBuffer::Allocation RenderAPI::allocateFrameStorage(uint32_t size)
+	{
+		return m_uniform_ring->allocateStorage(size);
+	}
+
+	uint32_t RenderAPI::writeFrameUniform(const void *data, uint32_t size)
+	{
+		UniformRingBuffer::Allocation allocation = m_uniform_ring->allocateUniform(size);
+		memcpy(allocation.data, data, size);
+		return allocation.offset;
+	}
+
+	uint32_t RenderAPI::writeFrameStorage(const void *data, uint32_t size)
+	{
+		UniformRingBuffer::Allocation allocation = m_uniform_ring->allocateStorage(size);
+		memcpy(allocation.data, data, size);
+		return allocation.offset;
+	}
+
+	uint64_t RenderAPI::newBuffer(VkDeviceSize size, VkBufferUsageFlags usage)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		return m_buffer_map.insert(Buffer::createDeviceLocalBuffer(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk(),
+			size,
+			usage
+		));
+	}
+
+	void RenderAPI::updateBuffer(uint64_t buffer_id, const void *data, VkDeviceSize size, VkDeviceSize offset)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		Buffer stagingBuffer = Buffer::createStagingBuffer(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk(),
+			size
+		);
+
+		stagingBuffer.map();
+		stagingBuffer.write(const_cast<void *>(data), static_cast<uint32_t>(size));
+		stagingBuffer.unmap();
+
+		VkBufferCopy copyRegion = {};
+		copyRegion.dstOffset = offset;
+		copyRegion.size = size;
+		m_command->copyBufferToBuffer(stagingBuffer.buffer(), m_buffer_map.get(buffer_id).buffer(), 1, &copyRegion);
+		m_command->keepAlive(std::move(stagingBuffer));
+
+		// make the copy visible to draws reading the buffer as instance data or draw commands
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = m_buffer_map.get(buffer_id).buffer();
+		barrier.offset = offset;
+		barrier.size = size;
+
+		vkCmdPipelineBarrier(
+			m_command->batchCommandBuffer(),
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+			0,
+			0, nullptr,
+			1, &barrier,
+			0, nullptr
+		);
+	}
+
+	uint64_t RenderAPI::newColorTarget()
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		return createColorTarget();
+	}
+
+	uint64_t RenderAPI::newDepthTarget()
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		return createDepthTarget();
+	}
+
+	uint64_t RenderAPI::newStorageImage(uint32_t width, uint32_t height, VkFormat format)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		uint64_t storage_image_id = m_storage_image_map.insert(Image::createStorageImage(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk(),
+			{ width, height },
+			format
+		));
+
+		m_command->transitionImageLayout(
+			m_storage_image_map.get(storage_image_id).image(),
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			1,
+			0,
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+		);
+
+		return storage_image_id;
+	}
+
+
+	void RenderAPI::bindPipeline(uint64_t pipelineID)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		bindPipeline(m_vk_command_buffers[m_current_frame], pipelineID);
+	}
+
+	void RenderAPI::bindDescriptor(
+		uint64_t pipelineID,
+		uint32_t firstSet,
+		uint32_t descriptorSetCount,
+		const VkDescriptorSet *pDescriptorSets
+	)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		bindDescriptor(m_vk_command_buffers[m_current_frame], pipelineID, firstSet, descriptorSetCount, pDescriptorSets);
+	}
+
+	void RenderAPI::bindTextureTable(uint64_t pipelineID, uint32_t set)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		bindTextureTable(m_vk_command_buffers[m_current_frame], pipelineID, set);
+	}
+
+	void RenderAPI::bindFrameUniform(uint64_t pipelineID, uint32_t set, uint32_t offset)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		bindFrameUniform(m_vk_command_buffers[m_current_frame], pipelineID, set, offset);
+	}
+
+	void RenderAPI::bindFrameStorage(uint64_t pipelineID, uint32_t set, uint32_t offset)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		bindFrameStorage(m_vk_command_buffers[m_current_frame], pipelineID, set, offset);
+	}
+
+	void RenderAPI::pushConstant(
+		uint64_t pipelineID,
+		VkShaderStageFlags stageFlags,
+		uint32_t size,
+		const void* data
+	)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		pushConstant(m_vk_command_buffers[m_current_frame], pipelineID, stageFlags, size, data);
+	}
+
+	void RenderAPI::setViewport(VkViewport& viewport)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		setViewport(m_vk_command_buffers[m_current_frame], viewport);
+	}
+
+	void RenderAPI::setScissor(VkRect2D& scissor)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		setScissor(m_vk_command_buffers[m_current_frame], scissor);
+	}
+
+	void RenderAPI::dispatch(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		dispatch(m_vk_command_buffers[m_current_frame], group_count_x, group_count_y, group_count_z);
+	}
+
+	void RenderAPI::dispatchIndirect(uint64_t buffer_id, VkDeviceSize offset)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		dispatchIndirect(m_vk_command_buffers[m_current_frame], buffer_id, offset);
+	}
+
+	void RenderAPI::computeBarrier(VkPipelineStageFlags dst_stage_mask, VkAccessFlags dst_access_mask)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		computeBarrier(m_vk_command_buffers[m_current_frame], dst_stage_mask, dst_access_mask);
+	}
+
+	void RenderAPI::drawMesh(uint64_t meshID)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		bindFrameMesh(meshID);
+
+		vkCmdDrawIndexed(m_vk_command_buffers[m_current_frame], m_mesh_map.get(meshID).indexCount(), 1, 0, 0, 0);
+	}
+
+	void RenderAPI::drawGltfMesh(uint64_t model_id, uint32_t mesh_index)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		drawGltfMesh(m_vk_command_buffers[m_current_frame], model_id, mesh_index);
+
+		// binding 0 now points into the glTF buffer
+		m_bound_mesh_id = Map<Mesh>::no_id;
+	}
+
+	void RenderAPI::drawMeshInstanced(
+		uint64_t meshID,
+		uint64_t instance_buffer_id,
+		uint32_t instance_count,
+		uint32_t first_instance
+	)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
+
+		bindFrameMesh(meshID);
+		bindInstanceBuffer(cmd, instance_buffer_id);
+
+		vkCmdDrawIndexed(cmd, m_mesh_map.get(meshID).indexCount(), instance_count, 0, 0, first_instance);
+	}
+
+	void RenderAPI::drawIndirect(
+		uint64_t meshID,
+		uint64_t indirect_buffer_id,
+		uint32_t draw_count,
+		VkDeviceSize offset,
+		uint64_t instance_buffer_id
+	)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
+
+		bindFrameMesh(meshID);
+		bindInstanceBuffer(cmd, instance_buffer_id);
+
+		recordDrawIndirect(cmd, indirect_buffer_id, draw_count, offset);
+	}
+
+	void RenderAPI::drawIndexedIndirectCount(
+		uint64_t meshID,
+		uint64_t indirect_buffer_id,
+		VkDeviceSize offset,
+		uint64_t count_buffer_id,
+		VkDeviceSize count_offset,
+		uint32_t max_draw_count,
+		uint64_t instance_buffer_id
+	)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
+
+		bindFrameMesh(meshID);
+		bindInstanceBuffer(cmd, instance_buffer_id);
+
+		recordDrawIndexedIndirectCount(cmd, indirect_buffer_id, offset, count_buffer_id, count_offset, max_draw_count);
+	}
+
+
+	void RenderAPI::bindPipeline(VkCommandBuffer cmd, uint64_t pipelineID)
+	{
+		vkCmdBindPipeline(cmd, m_pipeline_map.get(pipelineID).bindPoint(), m_pipeline_map.get(pipelineID).getVk());
+	}
+
+	void RenderAPI::bindDescriptor(
+		VkCommandBuffer cmd,
+		uint64_t pipelineID,
+		uint32_t firstSet,
+		uint32_t descriptorSetCount,
+		const VkDescriptorSet *pDescriptorSets
+	)
+	{
+		vkCmdBindDescriptorSets(
 			cmd,
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			m_pipeline_map.get(pipelineID).bindPoint(),
 			m_pipeline_map.get(pipelineID).layout->getVk(),
 			firstSet, descriptorSetCount,
 			pDescriptorSets,
@@ -752,17 +1397,49 @@ namespace LIB_NAMESPACE
 		);
 	}
 
+	void RenderAPI::bindTextureTable(VkCommandBuffer cmd, uint64_t pipelineID, uint32_t set)
+	{
+		if (bindlessTextures() == false)
+		{
+			throw std::runtime_error("failed to bind texture table: bindless textures are not supported by the device");
+		}
+
+		VkDescriptorSet textureSet = m_device.textureTable()->set();
+		bindDescriptor(cmd, pipelineID, set, 1, &textureSet);
+	}
+
+	void RenderAPI::bindFrameUniform(VkCommandBuffer cmd, uint64_t pipelineID, uint32_t set, uint32_t offset)
+	{
+		vkCmdBindDescriptorSets(
+			cmd,
+			m_pipeline_map.get(pipelineID).bindPoint(),
+			m_pipeline_map.get(pipelineID).layout->getVk(),
+			set, 1,
+			m_uniform_ring->uniformDescriptor().pSet(0),
+			1, &offset
+		);
+	}
+
+	void RenderAPI::bindFrameStorage(VkCommandBuffer cmd, uint64_t pipelineID, uint32_t set, uint32_t offset)
+	{
+		vkCmdBindDescriptorSets(
+			cmd,
+			m_pipeline_map.get(pipelineID).bindPoint(),
+			m_pipeline_map.get(pipelineID).layout->getVk(),
+			set, 1,
+			m_uniform_ring->storageDescriptor().pSet(0),
+			1, &offset
+		);
+	}
+
 	void RenderAPI::pushConstant(
+		VkCommandBuffer cmd,
 		uint64_t pipelineID,
 		VkShaderStageFlags stageFlags,
 		uint32_t size,
 		const void* data
 	)
 	{
-		std::unique_lock<std::mutex> lock(m_global_mutex);
-
-		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
-
 		vkCmdPushConstants(
 			cmd,
 			m_pipeline_map.get(pipelineID).layout->getVk(),
@@ -773,37 +1450,463 @@ namespace LIB_NAMESPACE
 		);
 	}
 
-	void RenderAPI::setViewport(VkViewport& viewport)
+	void RenderAPI::setViewport(VkCommandBuffer cmd, VkViewport& viewport)
+	{
+		vkCmdSetViewport(cmd, 0, 1, &viewport);
+	}
+
+	void RenderAPI::setScissor(VkCommandBuffer cmd, VkRect2D& scissor)
+	{
+		vkCmdSetScissor(cmd, 0, 1, &scissor);
+	}
+
+	void RenderAPI::dispatch(VkCommandBuffer cmd, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+	{
+		vkCmdDispatch(cmd, group_count_x, group_count_y, group_count_z);
+	}
+
+	void RenderAPI::dispatchIndirect(VkCommandBuffer cmd, uint64_t buffer_id, VkDeviceSize offset)
+	{
+		vkCmdDispatchIndirect(cmd, m_buffer_map.get(buffer_id).buffer(), offset);
+	}
+
+	void RenderAPI::computeBarrier(VkCommandBuffer cmd, VkPipelineStageFlags dst_stage_mask, VkAccessFlags dst_access_mask)
+	{
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = dst_access_mask;
+
+		vkCmdPipelineBarrier(
+			cmd,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dst_stage_mask,
+			0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr
+		);
+	}
+
+	void RenderAPI::drawMesh(VkCommandBuffer cmd, uint64_t meshID)
+	{
+		bindMesh(cmd, meshID);
+
+		vkCmdDrawIndexed(cmd, m_mesh_map.get(meshID).indexCount(), 1, 0, 0, 0);
+	}
+
+	void RenderAPI::drawGltfMesh(VkCommandBuffer cmd, uint64_t model_id, uint32_t mesh_index)
+	{
+		GltfModel & model = m_gltf_model_map.get(model_id);
+		VkBuffer buffer = model.buffer().buffer();
+
+		for (auto& primitive : model.meshes().at(mesh_index).primitives)
+		{
+			VkBuffer buffers[] = {buffer, buffer};
+
+			vkCmdBindVertexBuffers2(
+				cmd, 0, 1, buffers,
+				&primitive.attribute_offsets[GltfModel::POSITION],
+				nullptr,
+				&primitive.attribute_strides[GltfModel::POSITION]
+			);
+			vkCmdBindVertexBuffers2(
+				cmd, 2, 2, buffers,
+				&primitive.attribute_offsets[GltfModel::NORMAL],
+				nullptr,
+				&primitive.attribute_strides[GltfModel::NORMAL]
+			);
+
+			if (primitive.index_count > 0)
+			{
+				vkCmdBindIndexBuffer(cmd, buffer, primitive.index_offset, primitive.index_type);
+				vkCmdDrawIndexed(cmd, primitive.index_count, 1, 0, 0, 0);
+			}
+			else
+			{
+				vkCmdDraw(cmd, primitive.vertex_count, 1, 0, 0);
+			}
+		}
+	}
+
+	void RenderAPI::drawMeshInstanced(
+		VkCommandBuffer cmd,
+		uint64_t meshID,
+		uint64_t instance_buffer_id,
+		uint32_t instance_count,
+		uint32_t first_instance
+	)
+	{
+		bindMesh(cmd, meshID);
+		bindInstanceBuffer(cmd, instance_buffer_id);
+
+		vkCmdDrawIndexed(cmd, m_mesh_map.get(meshID).indexCount(), instance_count, 0, 0, first_instance);
+	}
+
+	void RenderAPI::drawIndirect(
+		VkCommandBuffer cmd,
+		uint64_t meshID,
+		uint64_t indirect_buffer_id,
+		uint32_t draw_count,
+		VkDeviceSize offset,
+		uint64_t instance_buffer_id
+	)
+	{
+		bindMesh(cmd, meshID);
+		bindInstanceBuffer(cmd, instance_buffer_id);
+
+		recordDrawIndirect(cmd, indirect_buffer_id, draw_count, offset);
+	}
+
+	void RenderAPI::drawIndexedIndirectCount(
+		VkCommandBuffer cmd,
+		uint64_t meshID,
+		uint64_t indirect_buffer_id,
+		VkDeviceSize offset,
+		uint64_t count_buffer_id,
+		VkDeviceSize count_offset,
+		uint32_t max_draw_count,
+		uint64_t instance_buffer_id
+	)
+	{
+		bindMesh(cmd, meshID);
+		bindInstanceBuffer(cmd, instance_buffer_id);
+
+		recordDrawIndexedIndirectCount(cmd, indirect_buffer_id, offset, count_buffer_id, count_offset, max_draw_count);
+	}
+
+
+	void RenderAPI::bindMesh(VkCommandBuffer cmd, uint64_t meshID)
+	{
+		Mesh & mesh = m_mesh_map.get(meshID);
+
+		VkBuffer vertexBuffers[] = {mesh.vertexBuffer().buffer()};
+		VkDeviceSize offsets[] = {0};
+		vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
+
+		vkCmdBindIndexBuffer(cmd, mesh.indexBuffer().buffer(), 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void RenderAPI::bindFrameMesh(uint64_t meshID)
+	{
+		if (meshID == m_bound_mesh_id)
+		{
+			return;
+		}
+
+		bindMesh(m_vk_command_buffers[m_current_frame], meshID);
+		m_bound_mesh_id = meshID;
+	}
+
+	void RenderAPI::bindInstanceBuffer(VkCommandBuffer cmd, uint64_t instance_buffer_id)
+	{
+		if (instance_buffer_id == Map<Buffer>::no_id)
+		{
+			return;
+		}
+
+		VkBuffer instanceBuffers[] = {m_buffer_map.get(instance_buffer_id).buffer()};
+		VkDeviceSize offsets[] = {0};
+		vkCmdBindVertexBuffers(cmd, 1, 1, instanceBuffers, offsets);
+	}
+
+	void RenderAPI::recordDrawIndirect(
+		VkCommandBuffer cmd,
+		uint64_t indirect_buffer_id,
+		uint32_t draw_count,
+		VkDeviceSize offset
+	)
+	{
+		VkBuffer indirectBuffer = m_buffer_map.get(indirect_buffer_id).buffer();
+		const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+		if (draw_count <= 1 || m_device.device().enabledFeatures().multiDrawIndirect)
+		{
+			vkCmdDrawIndexedIndirect(cmd, indirectBuffer, offset, draw_count, stride);
+			return;
+		}
+
+		// without multiDrawIndirect each command needs its own call
+		for (uint32_t i = 0; i < draw_count; i++)
+		{
+			vkCmdDrawIndexedIndirect(cmd, indirectBuffer, offset + i * stride, 1, stride);
+		}
+	}
+
+	void RenderAPI::recordDrawIndexedIndirectCount(
+		VkCommandBuffer cmd,
+		uint64_t indirect_buffer_id,
+		VkDeviceSize offset,
+		uint64_t count_buffer_id,
+		VkDeviceSize count_offset,
+		uint32_t max_draw_count
+	)
+	{
+		if (m_device.device().drawIndirectCountEnabled() == false)
+		{
+			throw std::runtime_error("failed to draw: drawIndirectCount is not supported by the device.");
+		}
+
+		vkCmdDrawIndexedIndirectCount(
+			cmd,
+			m_buffer_map.get(indirect_buffer_id).buffer(),
+			offset,
+			m_buffer_map.get(count_buffer_id).buffer(),
+			count_offset,
+			max_draw_count,
+			sizeof(VkDrawIndexedIndirectCommand)
+		);
+	}
+
+
+	VkCommandBuffer RenderAPI::beginSecondaryCommandBuffer()
+	{
+		ThreadCommand & thread_command = threadCommand();
+
+		if (thread_command.used_count == thread_command.secondary_command_buffers.size())
+		{
+			thread_command.secondary_command_buffers.push_back(
+				thread_command.command->allocateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY)
+			);
+		}
+		VkCommandBuffer cmd = thread_command.secondary_command_buffers[thread_command.used_count++];
+
+		VkCommandBufferInheritanceRenderingInfo rendering_info = {};
+		rendering_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+		rendering_info.colorAttachmentCount = static_cast<uint32_t>(m_rendering_color_formats.size());
+		rendering_info.pColorAttachmentFormats = m_rendering_color_formats.data();
+		rendering_info.depthAttachmentFormat = m_rendering_depth_format;
+		rendering_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkCommandBufferInheritanceInfo inheritance_info = {};
+		inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance_info.pNext = &rendering_info;
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		begin_info.pInheritanceInfo = &inheritance_info;
+
+		VK_CHECK(vkBeginCommandBuffer(cmd, &begin_info), "Failed to begin recording secondary command buffer");
+
+		return cmd;
+	}
+
+	void RenderAPI::endSecondaryCommandBuffer(VkCommandBuffer cmd)
+	{
+		VK_CHECK(vkEndCommandBuffer(cmd), "Failed to record secondary command buffer");
+	}
+
+	void RenderAPI::executeSecondaryCommandBuffers(const std::vector<VkCommandBuffer> & command_buffers)
 	{
 		std::unique_lock<std::mutex> lock(m_global_mutex);
 
-		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
+		if (command_buffers.empty())
+		{
+			return;
+		}
 
-		vkCmdSetViewport(cmd, 0, 1, &viewport);
+		vkCmdExecuteCommands(
+			m_vk_command_buffers[m_current_frame],
+			static_cast<uint32_t>(command_buffers.size()),
+			command_buffers.data()
+		);
+
+		// the bindings of the primary command buffer are undefined after executing secondary ones
+		m_bound_mesh_id = Map<Mesh>::no_id;
 	}
 
-	void RenderAPI::setScissor(VkRect2D& scissor)
+	RenderAPI::ThreadCommand & RenderAPI::threadCommand()
+	{
+		std::unique_lock<std::mutex> lock(m_thread_commands_mutex);
+
+		auto it = m_thread_commands.find(std::this_thread::get_id());
+		if (it == m_thread_commands.end())
+		{
+			Command::CreateInfo commandInfo{};
+			commandInfo.queueFamilyIndex = m_device.physicalDevice().queueFamilyIndices().graphicsFamily.value();
+			commandInfo.queue = m_device.graphicsQueue().getVk();
+			commandInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+			std::vector<ThreadCommand> thread_commands(MAX_FRAMES_IN_FLIGHT);
+			for (auto& thread_command : thread_commands)
+			{
+				thread_command.command = std::make_unique<Command>(m_device.device().getVk(), commandInfo);
+			}
+
+			it = m_thread_commands.emplace(std::this_thread::get_id(), std::move(thread_commands)).first;
+		}
+
+		// the map never moves its values, so the reference stays valid after unlocking
+		return it->second[m_current_frame];
+	}
+
+	void RenderAPI::resetThreadCommands()
+	{
+		std::unique_lock<std::mutex> lock(m_thread_commands_mutex);
+
+		for (auto& thread_commands : m_thread_commands)
+		{
+			ThreadCommand & thread_command = thread_commands.second[m_current_frame];
+
+			if (thread_command.used_count > 0)
+			{
+				thread_command.command->resetPool();
+				thread_command.used_count = 0;
+			}
+		}
+	}
+
+
+	uint64_t RenderAPI::newRenderGraph()
 	{
 		std::unique_lock<std::mutex> lock(m_global_mutex);
 
-		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
+		return m_render_graph_map.insert(RenderGraph(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk()
+		));
+	}
 
-		vkCmdSetScissor(cmd, 0, 1, &scissor);
+	RenderGraph & RenderAPI::getRenderGraph(uint64_t render_graph_id)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		return m_render_graph_map.get(render_graph_id);
 	}
 
-	void RenderAPI::drawMesh(uint64_t meshID)
+	// Targets are recreated with the swapchain, so the images are looked up again on every execute.
+	RenderGraph::Resource RenderAPI::importColorTarget(uint64_t render_graph_id, uint64_t color_target_id)
 	{
 		std::unique_lock<std::mutex> lock(m_global_mutex);
 
-		VkCommandBuffer cmd = m_vk_command_buffers[m_current_frame];
+		return m_render_graph_map.get(render_graph_id).importImage("color target", [this, color_target_id]()
+		{
+			Image & target = m_color_target_map.get(color_target_id);
+
+			RenderGraph::ImportedImage imported;
+			imported.image = target.image();
+			imported.view = target.view();
+			imported.format = target.format();
+			imported.extent = target.extent();
+			imported.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+			imported.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			imported.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+			imported.access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+			return imported;
+		});
+	}
 
-		VkBuffer vertexBuffers[] = {m_mesh_map.get(meshID).vertexBuffer().buffer()};
-		VkDeviceSize offsets[] = {0};
-		vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
+	RenderGraph::Resource RenderAPI::importDepthTarget(uint64_t render_graph_id, uint64_t depth_target_id)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
 
-		vkCmdBindIndexBuffer(cmd, m_mesh_map.get(meshID).indexBuffer().buffer(), 0, VK_INDEX_TYPE_UINT32);
+		return m_render_graph_map.get(render_graph_id).importImage("depth target", [this, depth_target_id]()
+		{
+			Image & target = m_depth_target_map.get(depth_target_id);
+
+			RenderGraph::ImportedImage imported;
+			imported.image = target.image();
+			imported.view = target.view();
+			imported.format = target.format();
+			imported.extent = target.extent();
+			imported.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+			if (hasStencilComponent(target.format()))
+			{
+				imported.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+			}
+			imported.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			imported.stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+			imported.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			return imported;
+		});
+	}
 
-		vkCmdDrawIndexed(cmd, m_mesh_map.get(meshID).indexCount(), 1, 0, 0, 0);
+	RenderGraph::Resource RenderAPI::importStorageImage(uint64_t render_graph_id, uint64_t storage_image_id)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		return m_render_graph_map.get(render_graph_id).importImage("storage image", [this, storage_image_id]()
+		{
+			Image & storage_image = m_storage_image_map.get(storage_image_id);
+
+			RenderGraph::ImportedImage imported;
+			imported.image = storage_image.image();
+			imported.view = storage_image.view();
+			imported.format = storage_image.format();
+			imported.extent = storage_image.extent();
+			imported.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+			imported.layout = VK_IMAGE_LAYOUT_GENERAL;
+			imported.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+			imported.access = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+			return imported;
+		});
+	}
+
+	RenderGraph::Resource RenderAPI::importBuffer(uint64_t render_graph_id, uint64_t buffer_id)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		return m_render_graph_map.get(render_graph_id).importBuffer("buffer", m_buffer_map.get(buffer_id).buffer());
+	}
+
+	void RenderAPI::executeRenderGraph(uint64_t render_graph_id)
+	{
+		RenderGraph & graph = m_render_graph_map.get(render_graph_id);
+
+		{
+			std::unique_lock<std::mutex> lock(m_global_mutex);
+
+			graph.setExtent(targetExtent());
+			if (graph.compiled() == false)
+			{
+				// the transient images of the previous compile may still be used by a frame in flight
+				m_device.device().waitIdle();
+				graph.compile();
+			}
+		}
+
+		// the passes take the lock themselves when they record with the frame command buffer functions
+		graph.execute(m_vk_command_buffers[m_current_frame], m_gpu_profiler.get());
+	}
+
+
+	ShaderModuleCache::Stats RenderAPI::shaderModuleStats()
+	{
+		return m_device.shaderModuleCache().stats();
+	}
+
+	DescriptorAllocator::Stats RenderAPI::descriptorStats()
+	{
+		return m_device.descriptorAllocator().stats();
+	}
+
+	void RenderAPI::beginGpuScope(const std::string & name)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		m_gpu_profiler->beginScope(m_vk_command_buffers[m_current_frame], name);
+	}
+
+	void RenderAPI::endGpuScope()
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		m_gpu_profiler->endScope(m_vk_command_buffers[m_current_frame]);
+	}
+
+	std::vector<GpuProfiler::Timing> RenderAPI::gpuTimings()
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		return m_gpu_profiler->timings();
+	}
+
+	core::MemoryAllocator::Stats RenderAPI::memoryStats()
+	{
+		return core::MemoryAllocator::get(
+			m_device.device().getVk(),
+			m_device.physicalDevice().getVk()
+		).stats();
 	}
 
 
@@ -817,13 +1920,20 @@ namespace LIB_NAMESPACE
 		return m_current_frame;
 	}
 
-	Mesh & RenderAPI::getMesh(uint32_t meshID)
+	Mesh & RenderAPI::getMesh(uint64_t meshID)
 	{
 		std::unique_lock<std::mutex> lock(m_global_mutex);
 
 		return m_mesh_map.get(meshID);
 	}
 
+	GltfModel & RenderAPI::getGltfModel(uint64_t model_id)
+	{
+		std::unique_lock<std::mutex> lock(m_global_mutex);
+
+		return m_gltf_model_map.get(model_id);
+	}
+
 	Descriptor & RenderAPI::getDescriptor(uint64_t descriptor_id)
 	{
 		std::unique_lock<std::mutex> lock(m_global_mutex);
@@ -5,14 +5,21 @@
 #include "swapchain.hpp"
 #include "descriptor/descriptor.hpp"
 #include "descriptor/uniform_buffer.hpp"
+#include "descriptor/uniform_ring_buffer.hpp"
 #include "descriptor/texture.hpp"
 #include "command.hpp"
+#include "mipmap_generator.hpp"
+#include "render_graph.hpp"
 #include "pipeline.hpp"
+#include "thread_pool.hpp"
+#include "gpu_profiler.hpp"
 #include "memory/image.hpp"
 #include "memory/buffer.hpp"
 #include "core/image/sampler.hpp"
 #include "core/sync_object.hpp"
 #include "object/mesh.hpp"
+#include "object/mesh_cache.hpp"
+#include "object/gltf_model.hpp"
 #include "map.hpp"
 
 #include <glm/glm.hpp>
@@ -23,7 +30,10 @@
 #include <vector>
 #include <map>
 #include <chrono>
+#include <exception>
+#include <future>
 #include <mutex>
+#include <thread>
 
 struct ViewProj_UBO {
 	glm::mat4 view;
@@ -37,46 +47,248 @@ namespace LIB_NAMESPACE
 
 	public:
 
-		RenderAPI(GLFWwindow *glfwWindow);
+		// bytes of decoded texels loadTextureAsync uploads per frame, at least one texture is uploaded
+		static constexpr VkDeviceSize texture_upload_budget = 32 * 1024 * 1024;
+
+		// pipelines compiled by a previous run are reused from pipeline_cache_path, an empty path disables it
+		RenderAPI(GLFWwindow *glfwWindow, const std::string & pipeline_cache_path = Device::default_pipeline_cache_path);
+		// headless mode: no window, surface or swapchain, frames are rendered into color targets of the given extent
+		RenderAPI(VkExtent2D extent, const std::string & pipeline_cache_path = Device::default_pipeline_cache_path);
 		~RenderAPI();
 
 		uint64_t loadModel(const std::string & filename);
+		// .gltf or .glb, the material textures are loaded as well and their ids stored in the materials
+		uint64_t loadGltf(const std::string & filename);
 		uint64_t newPipeline(Pipeline::CreateInfo & createInfo);
+		// returns right away, the pipeline is compiled on the thread pool
+		// its layout is usable at once, binding it before it is ready blocks until it is
+		uint64_t newPipelineAsync(Pipeline::CreateInfo & createInfo);
+		// compute_shader_path must be set, bound with bindPipeline and run with dispatch
+		uint64_t newComputePipeline(Pipeline::CreateInfo & createInfo);
+		bool pipelineReady(uint64_t pipelineID);
+		// throws the compilation error if it failed
+		void waitPipeline(uint64_t pipelineID);
 		uint64_t newDescriptor(VkDescriptorSetLayoutBinding layoutBinding);
+		// shared by every descriptor and pipeline with the same bindings, owned by the device
+		VkDescriptorSetLayout descriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding> & bindings);
+		// layout of one set of a pipeline, to allocate the sets bound to it
+		VkDescriptorSetLayout pipelineSetLayout(uint64_t pipelineID, uint32_t set);
+		// set for the frame being recorded only, freed when the frame slot is reused
+		VkDescriptorSet allocateTransientSet(VkDescriptorSetLayout layout);
+		// the buffer needs VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, see newBuffer
+		void writeStorageBuffer(
+			VkDescriptorSet set,
+			uint32_t binding,
+			uint64_t buffer_id,
+			VkDeviceSize offset = 0,
+			VkDeviceSize range = VK_WHOLE_SIZE
+		);
+		void writeStorageImage(VkDescriptorSet set, uint32_t binding, uint64_t storage_image_id);
 		uint64_t loadTexture(Texture::CreateInfo & createInfo);
+		// The file is decoded by the thread pool, meanwhile the id refers to a 1x1 white placeholder.
+		// startDraw uploads the decoded textures, up to texture_upload_budget bytes per frame,
+		// and the id then refers to the loaded texture: its descriptor and bindless index change.
+		uint64_t loadTextureAsync(const Texture::CreateInfo & createInfo);
+		bool textureReady(uint64_t texture_id);
+		// uploads the texture now, throws the decoding error if it failed
+		void waitTexture(uint64_t texture_id);
+		// Bindless textures, when the device supports descriptor indexing: every texture loaded is also
+		// added to one texture array, shaders index it with textureIndex() passed in push constants
+		// or instance data, and the array is bound once per pipeline with bindTextureTable.
+		// Only fragment and compute shaders may index it.
+		bool bindlessTextures() const { return m_device.textureTable() != nullptr; }
+		uint32_t textureIndex(uint64_t texture_id);
+		VkDescriptorSetLayout textureTableLayout();
 		uint64_t newUniformBuffer(const UniformBuffer::CreateInfo & create_info);
+		// Per-frame uniform and storage data: bump allocated from the region of the frame being recorded,
+		// valid until the frame slot is reused, and bound with the returned offset as dynamic offset.
+		// Pipelines declare the sets in frame_uniform_sets / frame_storage_sets or use the layouts below.
+		UniformRingBuffer::Allocation allocateFrameUniform(uint32_t size);
+		UniformRingBuffer::Allocation allocateFrameStorage(uint32_t size);
+		uint32_t writeFrameUniform(const void *data, uint32_t size);
+		uint32_t writeFrameStorage(const void *data, uint32_t size);
+		VkDescriptorSetLayout frameUniformLayout() { return m_uniform_ring->uniformDescriptor().layout(); }
+		VkDescriptorSetLayout frameStorageLayout() { return m_uniform_ring->storageDescriptor().layout(); }
 		uint64_t newColorTarget();
 		uint64_t newDepthTarget();
+		// GPU buffer for per-instance data or indirect draw commands, usage is added to TRANSFER_DST
+		uint64_t newBuffer(VkDeviceSize size, VkBufferUsageFlags usage);
+		// the copy is batched with the other uploads and visible to every frame submitted after it,
+		// so a buffer read by a frame still in flight must not be updated
+		void updateBuffer(uint64_t buffer_id, const void *data, VkDeviceSize size, VkDeviceSize offset = 0);
+		// image for compute shaders, always in VK_IMAGE_LAYOUT_GENERAL so it can be written and sampled without transitions
+		uint64_t newStorageImage(uint32_t width, uint32_t height, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
 
 		// function to start recording a command buffer
 		void startDraw();
 		// function to start a render pass
+		// with secondary_command_buffers the pass can only be filled with executeSecondaryCommandBuffers
 		void startRendering(
 			const std::vector<uint64_t> & color_target_ids,
-			uint64_t depth_target_id
+			uint64_t depth_target_id,
+			bool secondary_command_buffers = false
 		);
 		// function to do the actual drawing
 		void bindPipeline(uint64_t pipelineID);
 		void drawMesh(uint64_t meshID);
+		// every primitive of one mesh of a glTF model, the pipeline needs separate_vertex_streams
+		void drawGltfMesh(uint64_t model_id, uint32_t mesh_index);
+		// the instance buffer is bound to vertex binding 1, see Pipeline::CreateInfo::instance_stride
+		void drawMeshInstanced(
+			uint64_t meshID,
+			uint64_t instance_buffer_id,
+			uint32_t instance_count,
+			uint32_t first_instance = 0
+		);
+		// draw_count VkDrawIndexedIndirectCommand read from the indirect buffer, all indexing the mesh buffers
+		void drawIndirect(
+			uint64_t meshID,
+			uint64_t indirect_buffer_id,
+			uint32_t draw_count,
+			VkDeviceSize offset = 0,
+			uint64_t instance_buffer_id = Map<Buffer>::no_id
+		);
+		// same with the draw count read from the count buffer by the GPU, requires the drawIndirectCount feature
+		void drawIndexedIndirectCount(
+			uint64_t meshID,
+			uint64_t indirect_buffer_id,
+			VkDeviceSize offset,
+			uint64_t count_buffer_id,
+			VkDeviceSize count_offset,
+			uint32_t max_draw_count,
+			uint64_t instance_buffer_id = Map<Buffer>::no_id
+		);
 		void bindDescriptor(
 			uint64_t pipelineID,
 			uint32_t firstSet,
 			uint32_t descriptorSetCount,
 			const VkDescriptorSet *pDescriptorSets
 		);
+		void bindTextureTable(uint64_t pipelineID, uint32_t set);
+		void bindFrameUniform(uint64_t pipelineID, uint32_t set, uint32_t offset);
+		void bindFrameStorage(uint64_t pipelineID, uint32_t set, uint32_t offset);
 		void pushConstant(uint64_t pipelineID, VkShaderStageFlags stageFlags, uint32_t size, const void* data);
 		void setViewport(VkViewport& viewport);
 		void setScissor(VkRect2D& scissor);
+		// Compute work, recorded in the frame command buffer outside of startRendering/endRendering.
+		// Results are only visible to later commands after computeBarrier.
+		void dispatch(uint32_t group_count_x, uint32_t group_count_y = 1, uint32_t group_count_z = 1);
+		// one VkDispatchIndirectCommand read from the buffer, which needs VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+		void dispatchIndirect(uint64_t buffer_id, VkDeviceSize offset = 0);
+		// compute shader writes made visible to the given stages and accesses, the defaults cover
+		// a following dispatch, draw commands read from a buffer and vertex, index or shader reads
+		void computeBarrier(
+			VkPipelineStageFlags dst_stage_mask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+				| VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT
+				| VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+				| VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+				| VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VkAccessFlags dst_access_mask = VK_ACCESS_SHADER_READ_BIT
+				| VK_ACCESS_SHADER_WRITE_BIT
+				| VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+				| VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT
+				| VK_ACCESS_INDEX_READ_BIT
+		);
+
+		// Render graphs: passes declared with the resources they read and write, see RenderGraph.
+		// Targets, storage images and buffers are imported by id, transient images are created by the graph.
+		// executeRenderGraph records the graph into the frame command buffer, outside of startRendering/endRendering,
+		// and leaves the imported resources as it found them, so endDraw can present the color target.
+		// Passes record with the functions above, or with the cmd overloads below.
+		uint64_t newRenderGraph();
+		RenderGraph & getRenderGraph(uint64_t render_graph_id);
+		RenderGraph::Resource importColorTarget(uint64_t render_graph_id, uint64_t color_target_id);
+		RenderGraph::Resource importDepthTarget(uint64_t render_graph_id, uint64_t depth_target_id);
+		RenderGraph::Resource importStorageImage(uint64_t render_graph_id, uint64_t storage_image_id);
+		RenderGraph::Resource importBuffer(uint64_t render_graph_id, uint64_t buffer_id);
+		void executeRenderGraph(uint64_t render_graph_id);
+
+		// Multithreaded recording: each thread gets its own command pool per frame in flight.
+		// Secondary command buffers inherit the rendering state of the current startRendering call,
+		// they must be begun after it and executed before endRendering.
+		// Resources must not be created while other threads are recording.
+		VkCommandBuffer beginSecondaryCommandBuffer();
+		void endSecondaryCommandBuffer(VkCommandBuffer cmd);
+		void executeSecondaryCommandBuffers(const std::vector<VkCommandBuffer> & command_buffers);
+
+		// same as above but recorded into the given command buffer, without taking the global lock
+		void bindPipeline(VkCommandBuffer cmd, uint64_t pipelineID);
+		void drawMesh(VkCommandBuffer cmd, uint64_t meshID);
+		void drawGltfMesh(VkCommandBuffer cmd, uint64_t model_id, uint32_t mesh_index);
+		void drawMeshInstanced(
+			VkCommandBuffer cmd,
+			uint64_t meshID,
+			uint64_t instance_buffer_id,
+			uint32_t instance_count,
+			uint32_t first_instance = 0
+		);
+		void drawIndirect(
+			VkCommandBuffer cmd,
+			uint64_t meshID,
+			uint64_t indirect_buffer_id,
+			uint32_t draw_count,
+			VkDeviceSize offset = 0,
+			uint64_t instance_buffer_id = Map<Buffer>::no_id
+		);
+		void drawIndexedIndirectCount(
+			VkCommandBuffer cmd,
+			uint64_t meshID,
+			uint64_t indirect_buffer_id,
+			VkDeviceSize offset,
+			uint64_t count_buffer_id,
+			VkDeviceSize count_offset,
+			uint32_t max_draw_count,
+			uint64_t instance_buffer_id = Map<Buffer>::no_id
+		);
+		void bindDescriptor(
+			VkCommandBuffer cmd,
+			uint64_t pipelineID,
+			uint32_t firstSet,
+			uint32_t descriptorSetCount,
+			const VkDescriptorSet *pDescriptorSets
+		);
+		void bindTextureTable(VkCommandBuffer cmd, uint64_t pipelineID, uint32_t set);
+		void bindFrameUniform(VkCommandBuffer cmd, uint64_t pipelineID, uint32_t set, uint32_t offset);
+		void bindFrameStorage(VkCommandBuffer cmd, uint64_t pipelineID, uint32_t set, uint32_t offset);
+		void pushConstant(VkCommandBuffer cmd, uint64_t pipelineID, VkShaderStageFlags stageFlags, uint32_t size, const void* data);
+		void setViewport(VkCommandBuffer cmd, VkViewport& viewport);
+		void setScissor(VkCommandBuffer cmd, VkRect2D& scissor);
+		void dispatch(VkCommandBuffer cmd, uint32_t group_count_x, uint32_t group_count_y = 1, uint32_t group_count_z = 1);
+		void dispatchIndirect(VkCommandBuffer cmd, uint64_t buffer_id, VkDeviceSize offset = 0);
+		void computeBarrier(VkCommandBuffer cmd, VkPipelineStageFlags dst_stage_mask, VkAccessFlags dst_access_mask);
 
 		// function to end a render pass
 		void endRendering();
 		// function to end recording a command buffer
 		void endDraw(uint64_t color_target_id);
 
+		// frames per second measured over the last elapsed second, not capped by vsync in headless mode
+		double framesPerSecond() const { return m_frames_per_second; }
+		bool headless() const { return m_device.headless(); }
+		// whether pipelines started from the cache file written by a previous run
+		bool pipelineCacheLoaded() const { return m_device.pipelineCache().loaded(); }
+
+		// live blocks, fragmentation and bytes per heap of the device memory allocator
+		core::MemoryAllocator::Stats memoryStats();
+		// file reads and shader module creations saved by sharing modules between pipelines
+		ShaderModuleCache::Stats shaderModuleStats();
+		// cached layouts, descriptor pools and live sets
+		DescriptorAllocator::Stats descriptorStats();
+
+		// GPU timers of the frame command buffer: the whole frame, each startRendering/endRendering
+		// pass as "rendering", and the scopes opened with beginGpuScope. Scopes can nest but not inside
+		// a rendering recorded with secondary command buffers.
+		bool gpuProfilingSupported() const { return m_gpu_profiler->supported(); }
+		void beginGpuScope(const std::string & name);
+		void endGpuScope();
+		// of the last frame whose fence has signaled, frame first then scopes in the order they began
+		std::vector<GpuProfiler::Timing> gpuTimings();
+
 		// temporary functions to access private members
 		GLFWwindow* getWindow();
 		uint32_t currentFrame();
-		Mesh & getMesh(uint32_t meshID);
+		Mesh & getMesh(uint64_t meshID);
+		GltfModel & getGltfModel(uint64_t model_id);
 		Descriptor & getDescriptor(uint64_t descriptorID);
 		Texture & getTexture(uint64_t textureID);
 		UniformBuffer & getUniformBuffer(uint64_t uniform_buffer_id);
@@ -86,17 +298,19 @@ namespace LIB_NAMESPACE
 		Device m_device;
 
 		std::unique_ptr<Command> m_command;
+		std::unique_ptr<MipmapGenerator> m_mipmap_generator;
 		std::vector<VkCommandBuffer> m_vk_command_buffers;
 
 
 		std::unique_ptr<Swapchain> m_swapchain;
+		VkExtent2D m_headless_extent = {};
 
 		Map<Image> m_color_target_map;
 		Map<Image> m_depth_target_map;
+		Map<Image> m_storage_image_map;
 
 		std::vector<std::unique_ptr<core::Semaphore>> m_image_available_semaphores;
 		std::vector<std::unique_ptr<core::Semaphore>> m_render_finished_semaphores;
-		std::vector<std::unique_ptr<core::Semaphore>> m_swapchain_updated_semaphores;
 		std::vector<std::unique_ptr<core::Fence>> m_in_flight_fences;
 
 
@@ -106,20 +320,111 @@ namespace LIB_NAMESPACE
 
 		Map<Mesh> m_mesh_map;
 
+		Map<GltfModel> m_gltf_model_map;
+
 		Map<Texture> m_texture_map;
 
+		struct PendingTexture
+		{
+			uint64_t texture_id;
+			Texture::CreateInfo create_info;
+			std::future<Texture::Pixels> pixels;
+		};
+
+		struct RetiredTexture
+		{
+			std::unique_ptr<Texture> texture;
+			// bit per frame slot whose fence must still be waited before it is destroyed
+			uint32_t pending_frames;
+		};
+
+		std::vector<PendingTexture> m_pending_textures;
+		std::vector<RetiredTexture> m_retired_textures;
+		std::map<uint64_t, std::exception_ptr> m_failed_textures;
+
 		Map<UniformBuffer> m_uniform_buffer_map;
 
+		Map<Buffer> m_buffer_map;
+
+		Map<RenderGraph> m_render_graph_map;
+
+		std::unique_ptr<UniformRingBuffer> m_uniform_ring;
+
+		std::unique_ptr<GpuProfiler> m_gpu_profiler;
+
+		// asynchronous pipeline compilation, destroyed first so no task outlives the resources it uses
+		ThreadPool m_thread_pool;
+
+
+		struct ThreadCommand
+		{
+			std::unique_ptr<Command> command;
+			std::vector<VkCommandBuffer> secondary_command_buffers;
+			size_t used_count = 0;
+		};
+
+		// one command pool per recording thread and per frame in flight
+		std::map<std::thread::id, std::vector<ThreadCommand>> m_thread_commands;
+		std::mutex m_thread_commands_mutex;
+
+		// rendering state inherited by secondary command buffers
+		std::vector<VkFormat> m_rendering_color_formats;
+		VkFormat m_rendering_depth_format = VK_FORMAT_UNDEFINED;
 
 		uint32_t m_current_frame = 0;
 
+		// mesh whose buffers are bound in the frame command buffer, to skip rebinding them
+		uint64_t m_bound_mesh_id = Map<Mesh>::no_id;
+
+		uint32_t m_frame_count = 0;
+		double m_frames_per_second = 0.0;
+		std::chrono::steady_clock::time_point m_frame_count_start = std::chrono::steady_clock::now();
+
 		std::mutex m_global_mutex;
 
 
 		void createSwapchain();
 		void recreateSwapChain();
 		void createCommandPool();
+		void createMipmapGenerator();
 		void createSyncObjects();
+		void createUniformRing();
+		void createGpuProfiler();
+		void submitFrame(const VkSubmitInfo & submitInfo);
+		ThreadCommand & threadCommand();
+		void resetThreadCommands();
+		void updateFrameStats();
+
+		void bindMesh(VkCommandBuffer cmd, uint64_t meshID);
+		// only rebinds the frame command buffer when the mesh changes
+		void bindFrameMesh(uint64_t meshID);
+		void bindInstanceBuffer(VkCommandBuffer cmd, uint64_t instance_buffer_id);
+		void recordDrawIndirect(
+			VkCommandBuffer cmd,
+			uint64_t indirect_buffer_id,
+			uint32_t draw_count,
+			VkDeviceSize offset
+		);
+		void recordDrawIndexedIndirectCount(
+			VkCommandBuffer cmd,
+			uint64_t indirect_buffer_id,
+			VkDeviceSize offset,
+			uint64_t count_buffer_id,
+			VkDeviceSize count_offset,
+			uint32_t max_draw_count
+		);
+
+		VkExtent2D targetExtent() const;
+
+		uint64_t createTexture(Texture::CreateInfo & createInfo);
+		Texture buildTexture(Texture::CreateInfo & createInfo);
+		void uploadDecodedTextures();
+		// returns the bytes uploaded
+		VkDeviceSize uploadTexture(PendingTexture & pending);
+		void releaseRetiredTextures();
+
+		// fill the attachment formats of the pipeline from its target ids, and the texture table and frame data layouts
+		void setPipelineFormats(Pipeline::CreateInfo & createInfo);
 
 		uint64_t createColorTarget(uint64_t id = Map<Image>::no_id);
 		uint64_t createDepthTarget(uint64_t id = Map<Image>::no_id);
@@ -128,7 +433,10 @@ namespace LIB_NAMESPACE
 		VkFormat findDepthFormat();
 		bool hasStencilComponent(VkFormat format);
 
-		void generateMipmaps(VkImage image, VkFormat format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
-		void copyRenderedImageToSwapchainImage(uint64_t color_target_id, uint32_t swapchain_image_index);
+		void copyRenderedImageToSwapchainImage(
+			VkCommandBuffer cmd,
+			uint64_t color_target_id,
+			uint32_t swapchain_image_index
+		);
 	};
 }
@@ -0,0 +1,913 @@
+#include "render_graph.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	namespace
+	{
+		const VkAccessFlags2 write_access_mask =
+			VK_ACCESS_2_SHADER_WRITE_BIT |
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+			VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_2_TRANSFER_WRITE_BIT |
+			VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+		const VkPipelineStageFlags2 depth_stages =
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+			VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+
+		bool hasStencil(VkFormat format)
+		{
+			return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+		}
+
+		// a resource read two ways by the same pass needs a layout both accept
+		bool mergeLayouts(VkImageLayout & layout, VkImageLayout other)
+		{
+			if (layout == other)
+			{
+				return true;
+			}
+
+			auto either = [&](VkImageLayout a, VkImageLayout b)
+			{
+				return (layout == a && other == b) || (layout == b && other == a);
+			};
+
+			if (either(VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL))
+			{
+				layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+				return true;
+			}
+			if (either(VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL))
+			{
+				layout = VK_IMAGE_LAYOUT_GENERAL;
+				return true;
+			}
+			return false;
+		}
+
+		VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	RenderGraph::RenderGraph(VkDevice device, VkPhysicalDevice physicalDevice):
+		m_device(device),
+		m_physical_device(physicalDevice)
+	{
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		releaseTransientImages();
+	}
+
+
+	RenderGraph::Resource RenderGraph::addResource(ResourceInfo && info)
+	{
+		m_resources.push_back(std::move(info));
+		m_compiled = false;
+		return static_cast<Resource>(m_resources.size() - 1);
+	}
+
+	RenderGraph::Resource RenderGraph::createColor(const std::string & name, VkFormat format, VkExtent2D extent)
+	{
+		ResourceInfo info;
+		info.name = name;
+		info.kind = Kind::TRANSIENT_IMAGE;
+		info.format = format;
+		info.extent = extent;
+		info.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		return addResource(std::move(info));
+	}
+
+	RenderGraph::Resource RenderGraph::createDepth(const std::string & name, VkFormat format, VkExtent2D extent)
+	{
+		ResourceInfo info;
+		info.name = name;
+		info.kind = Kind::TRANSIENT_IMAGE;
+		info.format = format;
+		info.extent = extent;
+		info.aspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil(format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+		return addResource(std::move(info));
+	}
+
+	RenderGraph::Resource RenderGraph::importImage(const std::string & name, ImageResolver resolver)
+	{
+		ResourceInfo info;
+		info.name = name;
+		info.kind = Kind::IMPORTED_IMAGE;
+		info.resolver = std::move(resolver);
+		return addResource(std::move(info));
+	}
+
+	RenderGraph::Resource RenderGraph::importBuffer(const std::string & name, VkBuffer buffer, VkDeviceSize size)
+	{
+		ResourceInfo info;
+		info.name = name;
+		info.kind = Kind::BUFFER;
+		info.buffer = buffer;
+		info.size = size;
+		return addResource(std::move(info));
+	}
+
+	RenderGraph::Pass RenderGraph::addPass(const std::string & name, RecordFunction record)
+	{
+		PassInfo pass;
+		pass.name = name;
+		pass.record = std::move(record);
+		m_passes.push_back(std::move(pass));
+		m_compiled = false;
+		return static_cast<Pass>(m_passes.size() - 1);
+	}
+
+	void RenderGraph::keepPass(Pass pass)
+	{
+		m_passes.at(pass).keep = true;
+		m_compiled = false;
+	}
+
+	RenderGraph::Use & RenderGraph::use(Pass pass, Resource resource, VkImageLayout layout, VkImageUsageFlags usage)
+	{
+		PassInfo & info = m_passes.at(pass);
+		ResourceInfo & resource_info = m_resources.at(resource);
+		m_compiled = false;
+
+		if (resource_info.kind == Kind::BUFFER)
+		{
+			if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT))
+			{
+				throw std::runtime_error("failed to add " + resource_info.name + " to " + info.name + ": not an image");
+			}
+			layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+		resource_info.usage |= usage;
+
+		for (Use & existing : info.uses)
+		{
+			if (existing.resource != resource)
+			{
+				continue;
+			}
+			if (mergeLayouts(existing.layout, layout) == false)
+			{
+				throw std::runtime_error("failed to add " + resource_info.name + " to " + info.name + ": used in two layouts");
+			}
+			return existing;
+		}
+
+		Use new_use;
+		new_use.resource = resource;
+		new_use.layout = layout;
+		info.uses.push_back(new_use);
+		return info.uses.back();
+	}
+
+	void RenderGraph::writeColor(Pass pass, Resource image, VkAttachmentLoadOp load_op, VkClearColorValue clear_value)
+	{
+		Use & color = use(pass, image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+		color.attachment = Attachment::COLOR;
+		color.load_op = load_op;
+		color.clear_value.color = clear_value;
+		color.stages |= VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+		color.access |= VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+		color.write = true;
+		if (load_op == VK_ATTACHMENT_LOAD_OP_LOAD)
+		{
+			color.access |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
+			color.read = true;
+		}
+		color.discard = color.read == false;
+	}
+
+	void RenderGraph::writeDepth(Pass pass, Resource image, VkAttachmentLoadOp load_op, float clear_depth)
+	{
+		Use & depth = use(pass, image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+		depth.attachment = Attachment::DEPTH;
+		depth.load_op = load_op;
+		depth.clear_value.depthStencil = { clear_depth, 0 };
+		depth.stages |= depth_stages;
+		depth.access |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		depth.write = true;
+		depth.read = depth.read || load_op == VK_ATTACHMENT_LOAD_OP_LOAD;
+		depth.discard = depth.read == false;
+	}
+
+	void RenderGraph::readDepth(Pass pass, Resource image)
+	{
+		Use & depth = use(pass, image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+		depth.attachment = Attachment::DEPTH;
+		depth.load_op = VK_ATTACHMENT_LOAD_OP_LOAD;
+		depth.stages |= depth_stages;
+		depth.access |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		depth.read = true;
+		depth.discard = false;
+	}
+
+	void RenderGraph::sampleImage(Pass pass, Resource image, VkPipelineStageFlags2 stages)
+	{
+		Use & sampled = use(pass, image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT);
+		sampled.stages |= stages;
+		sampled.access |= VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+		sampled.read = true;
+		sampled.discard = false;
+	}
+
+	void RenderGraph::readStorage(Pass pass, Resource resource, VkPipelineStageFlags2 stages)
+	{
+		Use & storage = use(pass, resource, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT);
+		storage.stages |= stages;
+		storage.access |= VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+		storage.read = true;
+		storage.discard = false;
+	}
+
+	void RenderGraph::writeStorage(Pass pass, Resource resource, VkPipelineStageFlags2 stages)
+	{
+		// shaders may write part of it, so the previous content is kept
+		Use & storage = use(pass, resource, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT);
+		storage.stages |= stages;
+		storage.access |= VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+		storage.write = true;
+		storage.discard = false;
+	}
+
+	void RenderGraph::readBuffer(Pass pass, Resource buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access)
+	{
+		if (m_resources.at(buffer).kind != Kind::BUFFER)
+		{
+			throw std::runtime_error("failed to add " + m_resources[buffer].name + " to " + m_passes.at(pass).name + ": not a buffer");
+		}
+
+		Use & read = use(pass, buffer, VK_IMAGE_LAYOUT_UNDEFINED, 0);
+		read.stages |= stages;
+		read.access |= access;
+		read.read = true;
+		read.discard = false;
+	}
+
+	void RenderGraph::readTransfer(Pass pass, Resource resource)
+	{
+		Use & transfer = use(pass, resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+		transfer.stages |= VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+		transfer.access |= VK_ACCESS_2_TRANSFER_READ_BIT;
+		transfer.read = true;
+		transfer.discard = false;
+	}
+
+	void RenderGraph::writeTransfer(Pass pass, Resource resource)
+	{
+		Use & transfer = use(pass, resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+		transfer.stages |= VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+		transfer.access |= VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		transfer.write = true;
+		transfer.discard = false;
+	}
+
+	void RenderGraph::setExtent(VkExtent2D extent)
+	{
+		if (extent.width != m_extent.width || extent.height != m_extent.height)
+		{
+			m_extent = extent;
+			m_compiled = false;
+		}
+	}
+
+
+	VkImage RenderGraph::image(Resource resource) const
+	{
+		const ResourceInfo & info = m_resources.at(resource);
+		if (info.kind == Kind::IMPORTED_IMAGE)
+		{
+			return info.imported.image;
+		}
+		if (info.kind == Kind::TRANSIENT_IMAGE && info.transient_image != nullptr)
+		{
+			return info.transient_image->getVk();
+		}
+		return VK_NULL_HANDLE;
+	}
+
+	VkImageView RenderGraph::view(Resource resource) const
+	{
+		const ResourceInfo & info = m_resources.at(resource);
+		if (info.kind == Kind::IMPORTED_IMAGE)
+		{
+			return info.imported.view;
+		}
+		if (info.kind == Kind::TRANSIENT_IMAGE && info.transient_view != nullptr)
+		{
+			return info.transient_view->getVk();
+		}
+		return VK_NULL_HANDLE;
+	}
+
+	VkBuffer RenderGraph::buffer(Resource resource) const
+	{
+		return m_resources.at(resource).buffer;
+	}
+
+	VkFormat RenderGraph::format(Resource resource) const
+	{
+		const ResourceInfo & info = m_resources.at(resource);
+		return info.kind == Kind::IMPORTED_IMAGE ? info.imported.format : info.format;
+	}
+
+	VkExtent2D RenderGraph::extent(Resource resource) const
+	{
+		const ResourceInfo & info = m_resources.at(resource);
+		if (info.kind == Kind::IMPORTED_IMAGE)
+		{
+			return info.imported.extent;
+		}
+		if (info.extent.width == 0 || info.extent.height == 0)
+		{
+			return m_extent;
+		}
+		return info.extent;
+	}
+
+
+	void RenderGraph::compile()
+	{
+		releaseTransientImages();
+		resolveImportedImages();
+
+		cullPasses();
+		allocateTransientImages();
+		computeBarriers();
+
+		m_compiled = true;
+	}
+
+	void RenderGraph::releaseTransientImages()
+	{
+		for (ResourceInfo & info : m_resources)
+		{
+			info.transient_view.reset();
+			info.transient_image.reset();
+		}
+		m_transient_memory.reset();
+	}
+
+	void RenderGraph::resolveImportedImages()
+	{
+		for (ResourceInfo & info : m_resources)
+		{
+			if (info.kind == Kind::IMPORTED_IMAGE)
+			{
+				info.imported = info.resolver();
+			}
+		}
+	}
+
+	void RenderGraph::cullPasses()
+	{
+		// Walking backward, a resource is needed when a later pass reads its current content
+		// or when it is imported: what the graph leaves in it is used afterwards.
+		// A pass is kept when it writes a needed resource.
+		std::vector<bool> needed(m_resources.size());
+		for (size_t i = 0; i < m_resources.size(); i++)
+		{
+			needed[i] = m_resources[i].kind != Kind::TRANSIENT_IMAGE;
+		}
+
+		for (size_t i = m_passes.size(); i-- > 0;)
+		{
+			PassInfo & pass = m_passes[i];
+
+			bool alive = pass.keep;
+			for (const Use & use : pass.uses)
+			{
+				alive = alive || (use.write && needed[use.resource]);
+			}
+			pass.culled = alive == false;
+			if (pass.culled)
+			{
+				continue;
+			}
+
+			// attachments nobody reads afterwards are not stored
+			for (Use & use : pass.uses)
+			{
+				if (use.attachment != Attachment::NONE)
+				{
+					if (use.write)
+					{
+						use.store_op = needed[use.resource] ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					}
+					else
+					{
+						use.store_op = VK_ATTACHMENT_STORE_OP_NONE;
+					}
+				}
+				if (use.discard)
+				{
+					needed[use.resource] = false;
+				}
+			}
+			for (const Use & use : pass.uses)
+			{
+				if (use.read)
+				{
+					needed[use.resource] = true;
+				}
+			}
+		}
+
+		m_order.clear();
+		for (ResourceInfo & info : m_resources)
+		{
+			info.first_use = UINT32_MAX;
+			info.last_use = 0;
+		}
+		for (Pass i = 0; i < m_passes.size(); i++)
+		{
+			if (m_passes[i].culled)
+			{
+				continue;
+			}
+
+			uint32_t position = static_cast<uint32_t>(m_order.size());
+			m_order.push_back(i);
+			for (const Use & use : m_passes[i].uses)
+			{
+				ResourceInfo & info = m_resources[use.resource];
+				info.first_use = std::min(info.first_use, position);
+				info.last_use = std::max(info.last_use, position);
+			}
+		}
+
+		m_stats = {};
+		m_stats.pass_count = static_cast<uint32_t>(m_passes.size());
+		m_stats.culled_pass_count = static_cast<uint32_t>(m_passes.size() - m_order.size());
+	}
+
+	void RenderGraph::allocateTransientImages()
+	{
+		std::vector<Resource> transients;
+		for (Resource i = 0; i < m_resources.size(); i++)
+		{
+			ResourceInfo & info = m_resources[i];
+			if (info.kind != Kind::TRANSIENT_IMAGE || info.first_use == UINT32_MAX)
+			{
+				continue;
+			}
+
+			VkExtent2D image_extent = extent(i);
+			if (image_extent.width == 0 || image_extent.height == 0)
+			{
+				throw std::runtime_error("failed to create " + info.name + ": the render graph has no extent");
+			}
+
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = info.format;
+			imageInfo.extent.width = image_extent.width;
+			imageInfo.extent.height = image_extent.height;
+			imageInfo.extent.depth = 1;
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = info.usage;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+			info.transient_image = std::make_unique<core::Image>(m_device, imageInfo);
+			transients.push_back(i);
+		}
+
+		if (transients.empty())
+		{
+			return;
+		}
+
+		// Largest first, each image goes at the lowest offset that does not overlap an image
+		// placed before it and alive at the same time.
+		std::vector<VkMemoryRequirements> requirements(m_resources.size());
+		VkMemoryRequirements shared = {};
+		shared.alignment = 1;
+		shared.memoryTypeBits = ~0u;
+		for (Resource i : transients)
+		{
+			requirements[i] = m_resources[i].transient_image->getMemoryRequirements();
+			shared.alignment = std::max(shared.alignment, requirements[i].alignment);
+			shared.memoryTypeBits &= requirements[i].memoryTypeBits;
+			m_stats.unaliased_bytes += alignUp(requirements[i].size, requirements[i].alignment);
+		}
+		if (shared.memoryTypeBits == 0)
+		{
+			throw std::runtime_error("failed to find a memory type for every transient image");
+		}
+
+		std::sort(transients.begin(), transients.end(), [&](Resource a, Resource b)
+		{
+			return requirements[a].size > requirements[b].size;
+		});
+
+		std::vector<Resource> placed;
+		for (Resource i : transients)
+		{
+			ResourceInfo & info = m_resources[i];
+			info.memory_size = requirements[i].size;
+			info.memory_offset = 0;
+
+			bool moved = true;
+			while (moved)
+			{
+				moved = false;
+				for (Resource j : placed)
+				{
+					const ResourceInfo & other = m_resources[j];
+					bool same_time = info.first_use <= other.last_use && other.first_use <= info.last_use;
+					bool same_memory = info.memory_offset < other.memory_offset + other.memory_size
+						&& other.memory_offset < info.memory_offset + info.memory_size;
+					if (same_time && same_memory)
+					{
+						info.memory_offset = alignUp(other.memory_offset + other.memory_size, requirements[i].alignment);
+						moved = true;
+					}
+				}
+			}
+
+			placed.push_back(i);
+			shared.size = std::max(shared.size, info.memory_offset + info.memory_size);
+		}
+
+		m_transient_memory = std::make_unique<core::DeviceMemory>(
+			m_device,
+			m_physical_device,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			shared,
+			false
+		);
+
+		for (Resource i : transients)
+		{
+			ResourceInfo & info = m_resources[i];
+			if (info.transient_image->bindMemory(m_transient_memory->getVk(), m_transient_memory->offset() + info.memory_offset) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to bind memory of " + info.name);
+			}
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = info.transient_image->getVk();
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = info.format;
+			// a depth and stencil image is viewed through its depth only
+			viewInfo.subresourceRange.aspectMask = info.aspect & ~VK_IMAGE_ASPECT_STENCIL_BIT;
+			viewInfo.subresourceRange.baseMipLevel = 0;
+			viewInfo.subresourceRange.levelCount = 1;
+			viewInfo.subresourceRange.baseArrayLayer = 0;
+			viewInfo.subresourceRange.layerCount = 1;
+
+			info.transient_view = std::make_unique<core::ImageView>(m_device, viewInfo);
+		}
+
+		m_stats.transient_image_count = static_cast<uint32_t>(transients.size());
+		m_stats.transient_bytes = shared.size;
+	}
+
+	bool RenderGraph::transition(State & state, const Use & use, bool image, Barrier & barrier)
+	{
+		bool layout_change = image && use.layout != state.layout;
+		bool read_after_write = use.read && state.write_stages != 0 && (
+			(use.stages & ~state.visible_stages) != 0 ||
+			(use.access & ~write_access_mask & ~state.visible_access) != 0
+		);
+		bool write_after_read = use.write && state.read_stages != 0;
+		bool write_after_write = use.write && state.write_stages != 0;
+		bool needed = layout_change || read_after_write || write_after_read || write_after_write;
+
+		if (needed)
+		{
+			barrier.resource = use.resource;
+			barrier.src_stages = state.write_stages;
+			if (layout_change || write_after_read)
+			{
+				barrier.src_stages |= state.read_stages;
+			}
+			// a write after reads only has to wait for them, there is nothing to make visible
+			barrier.src_access = layout_change || read_after_write || write_after_write ? state.write_access : 0;
+			barrier.dst_stages = use.stages;
+			barrier.dst_access = use.access;
+			barrier.old_layout = image && use.discard == false ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.new_layout = image ? use.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+
+		if (use.write || layout_change)
+		{
+			// a layout transition is a write the following accesses must wait for like any other
+			state.write_stages = use.stages;
+			state.write_access = use.access & write_access_mask;
+			state.read_stages = use.read ? use.stages : 0;
+			state.visible_stages = use.write ? 0 : use.stages;
+			state.visible_access = use.write ? 0 : use.access;
+		}
+		else
+		{
+			if (needed)
+			{
+				state.visible_stages |= use.stages;
+				state.visible_access |= use.access;
+			}
+			state.read_stages |= use.stages;
+		}
+		if (image)
+		{
+			state.layout = use.layout;
+		}
+
+		return needed;
+	}
+
+	void RenderGraph::simulate(std::vector<State> & states, bool record)
+	{
+		for (Pass i : m_order)
+		{
+			PassInfo & pass = m_passes[i];
+			pass.barriers.clear();
+
+			for (const Use & use : pass.uses)
+			{
+				Barrier barrier;
+				if (transition(states[use.resource], use, isImage(use.resource), barrier) && record)
+				{
+					pass.barriers.push_back(barrier);
+				}
+			}
+		}
+
+		m_final_barriers.clear();
+		for (Resource i = 0; i < m_resources.size(); i++)
+		{
+			const ResourceInfo & info = m_resources[i];
+			State & state = states[i];
+			if (info.kind != Kind::IMPORTED_IMAGE)
+			{
+				continue;
+			}
+
+			const ImportedImage & imported = info.imported;
+			if (state.layout == imported.layout && ((state.write_stages | state.read_stages) & ~imported.stages) == 0)
+			{
+				continue;
+			}
+
+			Barrier barrier;
+			barrier.resource = i;
+			barrier.src_stages = state.write_stages | state.read_stages;
+			barrier.src_access = state.write_access;
+			barrier.dst_stages = imported.stages;
+			barrier.dst_access = imported.access;
+			barrier.old_layout = state.layout;
+			barrier.new_layout = imported.layout;
+			if (record)
+			{
+				m_final_barriers.push_back(barrier);
+			}
+
+			state.layout = imported.layout;
+			state.write_stages = imported.stages;
+			state.write_access = imported.access & write_access_mask;
+			state.read_stages = imported.stages;
+			state.visible_stages = 0;
+			state.visible_access = 0;
+		}
+	}
+
+	void RenderGraph::computeBarriers()
+	{
+		// The accesses of the previous frame come before the first ones of this frame in submission order,
+		// so the graph starts from the states it ends in. Imported images start from their own state,
+		// and transient images from the accesses of every image sharing their memory, whatever its content.
+		std::vector<State> states(m_resources.size());
+		for (Resource i = 0; i < m_resources.size(); i++)
+		{
+			const ResourceInfo & info = m_resources[i];
+			if (info.kind == Kind::IMPORTED_IMAGE)
+			{
+				states[i].layout = info.imported.layout;
+				states[i].write_stages = info.imported.stages;
+				states[i].write_access = info.imported.access & write_access_mask;
+				states[i].read_stages = info.imported.stages;
+			}
+		}
+		std::vector<State> initial = states;
+
+		simulate(states, false);
+
+		for (Resource i = 0; i < m_resources.size(); i++)
+		{
+			const ResourceInfo & info = m_resources[i];
+			if (info.kind == Kind::BUFFER)
+			{
+				initial[i] = states[i];
+			}
+			else if (info.kind == Kind::TRANSIENT_IMAGE && info.transient_image != nullptr)
+			{
+				for (Resource j = 0; j < m_resources.size(); j++)
+				{
+					const ResourceInfo & other = m_resources[j];
+					if (other.kind != Kind::TRANSIENT_IMAGE || other.transient_image == nullptr)
+					{
+						continue;
+					}
+					if (info.memory_offset < other.memory_offset + other.memory_size
+						&& other.memory_offset < info.memory_offset + info.memory_size)
+					{
+						initial[i].write_stages |= states[j].write_stages;
+						initial[i].write_access |= states[j].write_access;
+						initial[i].read_stages |= states[j].read_stages;
+					}
+				}
+				initial[i].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+		}
+
+		simulate(initial, true);
+
+		for (Pass i : m_order)
+		{
+			const std::vector<Barrier> & barriers = m_passes[i].barriers;
+			if (barriers.empty() == false)
+			{
+				m_stats.barrier_batch_count++;
+			}
+			for (const Barrier & barrier : barriers)
+			{
+				if (isImage(barrier.resource))
+				{
+					m_stats.image_barrier_count++;
+				}
+				else
+				{
+					m_stats.buffer_barrier_count++;
+				}
+			}
+		}
+		if (m_final_barriers.empty() == false)
+		{
+			m_stats.barrier_batch_count++;
+			m_stats.image_barrier_count += static_cast<uint32_t>(m_final_barriers.size());
+		}
+	}
+
+
+	void RenderGraph::execute(VkCommandBuffer cmd, GpuProfiler *profiler)
+	{
+		if (m_compiled == false)
+		{
+			compile();
+		}
+		else
+		{
+			resolveImportedImages();
+		}
+
+		for (Pass i : m_order)
+		{
+			PassInfo & pass = m_passes[i];
+
+			if (profiler != nullptr)
+			{
+				profiler->beginScope(cmd, pass.name);
+			}
+
+			recordBarriers(cmd, pass.barriers);
+			recordPass(cmd, pass);
+
+			if (profiler != nullptr)
+			{
+				profiler->endScope(cmd);
+			}
+		}
+
+		recordBarriers(cmd, m_final_barriers);
+	}
+
+	void RenderGraph::recordBarriers(VkCommandBuffer cmd, const std::vector<Barrier> & barriers)
+	{
+		if (barriers.empty())
+		{
+			return;
+		}
+
+		std::vector<VkImageMemoryBarrier2> image_barriers;
+		std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+		for (const Barrier & barrier : barriers)
+		{
+			const ResourceInfo & info = m_resources[barrier.resource];
+
+			if (isImage(barrier.resource))
+			{
+				VkImageMemoryBarrier2 image_barrier = {};
+				image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+				image_barrier.srcStageMask = barrier.src_stages;
+				image_barrier.srcAccessMask = barrier.src_access;
+				image_barrier.dstStageMask = barrier.dst_stages;
+				image_barrier.dstAccessMask = barrier.dst_access;
+				image_barrier.oldLayout = barrier.old_layout;
+				image_barrier.newLayout = barrier.new_layout;
+				image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				image_barrier.image = image(barrier.resource);
+				image_barrier.subresourceRange.aspectMask = info.kind == Kind::IMPORTED_IMAGE ? info.imported.aspect : info.aspect;
+				image_barrier.subresourceRange.baseMipLevel = 0;
+				image_barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+				image_barrier.subresourceRange.baseArrayLayer = 0;
+				image_barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+				image_barriers.push_back(image_barrier);
+			}
+			else
+			{
+				VkBufferMemoryBarrier2 buffer_barrier = {};
+				buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+				buffer_barrier.srcStageMask = barrier.src_stages;
+				buffer_barrier.srcAccessMask = barrier.src_access;
+				buffer_barrier.dstStageMask = barrier.dst_stages;
+				buffer_barrier.dstAccessMask = barrier.dst_access;
+				buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				buffer_barrier.buffer = info.buffer;
+				buffer_barrier.offset = 0;
+				buffer_barrier.size = info.size;
+				buffer_barriers.push_back(buffer_barrier);
+			}
+		}
+
+		VkDependencyInfo dependency = {};
+		dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependency.bufferMemoryBarrierCount = static_cast<uint32_t>(buffer_barriers.size());
+		dependency.pBufferMemoryBarriers = buffer_barriers.data();
+		dependency.imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers.size());
+		dependency.pImageMemoryBarriers = image_barriers.data();
+
+		vkCmdPipelineBarrier2(cmd, &dependency);
+	}
+
+	void RenderGraph::recordPass(VkCommandBuffer cmd, PassInfo & pass)
+	{
+		std::vector<VkRenderingAttachmentInfo> color_attachments;
+		VkRenderingAttachmentInfo depth_attachment = {};
+		bool has_depth = false;
+		VkExtent2D render_extent = {};
+
+		for (const Use & use : pass.uses)
+		{
+			if (use.attachment == Attachment::NONE)
+			{
+				continue;
+			}
+
+			VkRenderingAttachmentInfo attachment = {};
+			attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			attachment.imageView = view(use.resource);
+			attachment.imageLayout = use.layout;
+			attachment.loadOp = use.load_op;
+			attachment.storeOp = use.store_op;
+			attachment.clearValue = use.clear_value;
+
+			if (render_extent.width == 0)
+			{
+				render_extent = extent(use.resource);
+			}
+
+			if (use.attachment == Attachment::COLOR)
+			{
+				color_attachments.push_back(attachment);
+			}
+			else
+			{
+				depth_attachment = attachment;
+				has_depth = true;
+			}
+		}
+
+		if (color_attachments.empty() && has_depth == false)
+		{
+			pass.record(cmd);
+			return;
+		}
+
+		VkRenderingInfo rendering_info = {};
+		rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		rendering_info.renderArea = { 0, 0, render_extent.width, render_extent.height };
+		rendering_info.layerCount = 1;
+		rendering_info.colorAttachmentCount = static_cast<uint32_t>(color_attachments.size());
+		rendering_info.pColorAttachments = color_attachments.data();
+		rendering_info.pDepthAttachment = has_depth ? &depth_attachment : nullptr;
+
+		vkCmdBeginRendering(cmd, &rendering_info);
+		pass.record(cmd);
+		vkCmdEndRendering(cmd);
+	}
+}
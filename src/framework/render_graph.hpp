@@ -0,0 +1,267 @@
+#pragma once
+
+#include "defines.hpp"
+#include "gpu_profiler.hpp"
+#include "core/image/image.hpp"
+#include "core/image/image_view.hpp"
+#include "core/device_memory.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// A frame described as passes with the images and buffers they read and write,
+	// instead of startRendering/endRendering and barriers placed by hand.
+	// compile() drops the passes whose results are never used, places the transient images whose
+	// lifetimes do not overlap at the same offset of a single allocation, and works out the barriers:
+	// execute() records at most one vkCmdPipelineBarrier2 before each pass, with only the layout
+	// transitions and the hazards between its accesses and the previous ones.
+	// The graph is meant to be built once and executed every frame, it is compiled again when
+	// passes or resources are added or the extent changes.
+	class RenderGraph
+	{
+
+	public:
+
+		using Resource = uint32_t;
+		using Pass = uint32_t;
+
+		// recorded into the command buffer given to execute, inside a vkCmdBeginRendering
+		// of the attachments of the pass when it has any
+		using RecordFunction = std::function<void(VkCommandBuffer cmd)>;
+
+		// an image owned by someone else, resolved on every compile and execute since its handles
+		// may change, for example when the swapchain is recreated
+		struct ImportedImage
+		{
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			VkExtent2D extent = {};
+			VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+			// the layout and accesses of the image outside of the graph,
+			// it is found in this state and left in it
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			VkAccessFlags2 access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+		};
+
+		using ImageResolver = std::function<ImportedImage()>;
+
+		struct Stats
+		{
+			uint32_t pass_count = 0;
+			uint32_t culled_pass_count = 0;
+			// vkCmdPipelineBarrier2 calls recorded by each execute and the barriers they hold
+			uint32_t barrier_batch_count = 0;
+			uint32_t image_barrier_count = 0;
+			uint32_t buffer_barrier_count = 0;
+			uint32_t transient_image_count = 0;
+			// size of the allocation shared by the transient images, and without aliasing
+			VkDeviceSize transient_bytes = 0;
+			VkDeviceSize unaliased_bytes = 0;
+		};
+
+		RenderGraph(VkDevice device, VkPhysicalDevice physicalDevice);
+		RenderGraph(const RenderGraph &) = delete;
+		RenderGraph(RenderGraph && other) = default;
+		RenderGraph & operator=(const RenderGraph &) = delete;
+		RenderGraph & operator=(RenderGraph && other) = delete;
+		~RenderGraph();
+
+		// Images created by the graph, only alive during execute. Their content is lost between
+		// frames and their memory is shared with the transient images used at other times.
+		// An extent of 0 follows the extent of the graph.
+		Resource createColor(const std::string & name, VkFormat format, VkExtent2D extent = {});
+		Resource createDepth(const std::string & name, VkFormat format, VkExtent2D extent = {});
+
+		// The content of imported resources is kept after the graph, so the passes writing them are never culled.
+		Resource importImage(const std::string & name, ImageResolver resolver);
+		Resource importBuffer(const std::string & name, VkBuffer buffer, VkDeviceSize size = VK_WHOLE_SIZE);
+
+		Pass addPass(const std::string & name, RecordFunction record);
+		// kept even when nothing reads what it writes
+		void keepPass(Pass pass);
+
+		// attachments of the pass, in the order of the color locations of its pipelines
+		// with VK_ATTACHMENT_LOAD_OP_LOAD the previous content is read
+		void writeColor(
+			Pass pass,
+			Resource image,
+			VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+			VkClearColorValue clear_value = {}
+		);
+		void writeDepth(
+			Pass pass,
+			Resource image,
+			VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+			float clear_depth = 1.0f
+		);
+		// depth test without writes, the depth attachment is read-only
+		void readDepth(Pass pass, Resource image);
+
+		// sampled image, in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		void sampleImage(Pass pass, Resource image, VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+		// storage image in VK_IMAGE_LAYOUT_GENERAL, or storage buffer
+		void readStorage(Pass pass, Resource resource, VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+		void writeStorage(Pass pass, Resource resource, VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+		// any other read of a buffer: vertex, index, indirect or uniform
+		void readBuffer(Pass pass, Resource buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access);
+		// copies and blits
+		void readTransfer(Pass pass, Resource resource);
+		void writeTransfer(Pass pass, Resource resource);
+
+		// of the transient images created without an extent
+		void setExtent(VkExtent2D extent);
+		VkExtent2D extent() const { return m_extent; }
+
+		bool compiled() const { return m_compiled; }
+		// The GPU must be done with the previous transient images, which are destroyed.
+		void compile();
+		// compiles first when needed, the command buffer must be outside of any rendering
+		void execute(VkCommandBuffer cmd, GpuProfiler *profiler = nullptr);
+
+		bool culled(Pass pass) const { return m_passes[pass].culled; }
+		Stats stats() const { return m_stats; }
+
+		// valid during execute, and until the next compile for transient images
+		VkImage image(Resource resource) const;
+		VkImageView view(Resource resource) const;
+		VkBuffer buffer(Resource resource) const;
+		VkFormat format(Resource resource) const;
+		VkExtent2D extent(Resource resource) const;
+
+	private:
+
+		enum class Kind
+		{
+			TRANSIENT_IMAGE,
+			IMPORTED_IMAGE,
+			BUFFER
+		};
+
+		enum class Attachment
+		{
+			NONE,
+			COLOR,
+			DEPTH
+		};
+
+		struct ResourceInfo
+		{
+			std::string name;
+			Kind kind;
+
+			// transient images
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			VkExtent2D extent = {};
+			VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+			VkImageUsageFlags usage = 0;
+			std::unique_ptr<core::Image> transient_image;
+			std::unique_ptr<core::ImageView> transient_view;
+			VkDeviceSize memory_offset = 0;
+			VkDeviceSize memory_size = 0;
+
+			ImageResolver resolver;
+			ImportedImage imported;
+
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceSize size = VK_WHOLE_SIZE;
+
+			// alive passes from the first to the last one using the resource, in execution order
+			uint32_t first_use = UINT32_MAX;
+			uint32_t last_use = 0;
+		};
+
+		// one per resource a pass touches, the accesses of one resource in a pass are merged
+		struct Use
+		{
+			Resource resource;
+			VkPipelineStageFlags2 stages = 0;
+			VkAccessFlags2 access = 0;
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			bool read = false;
+			bool write = false;
+			// the previous content is not needed, the whole resource is overwritten
+			bool discard = false;
+
+			Attachment attachment = Attachment::NONE;
+			VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_STORE;
+			VkClearValue clear_value = {};
+		};
+
+		// barriers before a pass, the handles are filled in by execute
+		struct Barrier
+		{
+			Resource resource;
+			VkPipelineStageFlags2 src_stages;
+			VkAccessFlags2 src_access;
+			VkPipelineStageFlags2 dst_stages;
+			VkAccessFlags2 dst_access;
+			VkImageLayout old_layout;
+			VkImageLayout new_layout;
+		};
+
+		struct PassInfo
+		{
+			std::string name;
+			RecordFunction record;
+			std::vector<Use> uses;
+			bool keep = false;
+			bool culled = false;
+			std::vector<Barrier> barriers;
+		};
+
+		// accesses since the last write of a resource, while walking the passes
+		struct State
+		{
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags2 write_stages = 0;
+			VkAccessFlags2 write_access = 0;
+			VkPipelineStageFlags2 read_stages = 0;
+			// stages and accesses the last write has been made visible to
+			VkPipelineStageFlags2 visible_stages = 0;
+			VkAccessFlags2 visible_access = 0;
+		};
+
+		VkDevice m_device;
+		VkPhysicalDevice m_physical_device;
+
+		std::vector<ResourceInfo> m_resources;
+		std::vector<PassInfo> m_passes;
+		// alive passes in execution order
+		std::vector<Pass> m_order;
+		// back to the imported state after the last pass
+		std::vector<Barrier> m_final_barriers;
+
+		std::unique_ptr<core::DeviceMemory> m_transient_memory;
+
+		VkExtent2D m_extent = {};
+		bool m_compiled = false;
+		Stats m_stats;
+
+		Resource addResource(ResourceInfo && info);
+		// merged with the other accesses of the pass to the resource
+		Use & use(Pass pass, Resource resource, VkImageLayout layout, VkImageUsageFlags usage);
+		bool isImage(Resource resource) const { return m_resources[resource].kind != Kind::BUFFER; }
+
+		void releaseTransientImages();
+		void resolveImportedImages();
+		void cullPasses();
+		void allocateTransientImages();
+		void computeBarriers();
+		// walks the alive passes from the given states, filling the barriers when record is set
+		void simulate(std::vector<State> & states, bool record);
+		static bool transition(State & state, const Use & use, bool image, Barrier & barrier);
+
+		void recordBarriers(VkCommandBuffer cmd, const std::vector<Barrier> & barriers);
+		void recordPass(VkCommandBuffer cmd, PassInfo & pass);
+
+	};
+}
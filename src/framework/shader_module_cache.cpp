@@ -0,0 +1,184 @@
+#include "shader_module_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	namespace
+	{
+		// FNV-1a over the words, SPIR-V is always a whole number of them
+		uint64_t hashCode(const std::vector<char> & code)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i + sizeof(uint32_t) <= code.size(); i += sizeof(uint32_t))
+			{
+				uint32_t word;
+				std::memcpy(&word, code.data() + i, sizeof(word));
+				hash ^= word;
+				hash *= 1099511628211ull;
+			}
+			return hash ^ code.size();
+		}
+	}
+
+	ShaderModuleCache::Shader::Shader(VkDevice device, std::vector<char> && code, uint64_t hash):
+		m_code(std::move(code)),
+		m_hash(hash)
+	{
+		core::ShaderModule::CreateInfo createInfo;
+		createInfo.codeSize = m_code.size();
+		createInfo.pCode = reinterpret_cast<const uint32_t*>(m_code.data());
+
+		m_module = std::make_unique<core::ShaderModule>(device, createInfo);
+	}
+
+	const ShaderReflection & ShaderModuleCache::Shader::reflection() const
+	{
+		std::call_once(m_reflection_once, [this]()
+		{
+			m_reflection = std::make_unique<ShaderReflection>(m_code);
+		});
+		return *m_reflection;
+	}
+
+	ShaderModuleCache::ShaderModuleCache(VkDevice device):
+		m_device(device)
+	{
+	}
+
+	ShaderModuleCache::~ShaderModuleCache()
+	{
+	}
+
+	std::shared_ptr<const ShaderModuleCache::Shader> ShaderModuleCache::load(const std::filesystem::path & path)
+	{
+		std::error_code error;
+		uintmax_t size = std::filesystem::file_size(path, error);
+		std::filesystem::file_time_type write_time = std::filesystem::last_write_time(path, error);
+		if (error)
+		{
+			throw std::runtime_error("failed to open file: " + path.string());
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			auto it = m_files.find(path.string());
+			if (it != m_files.end() && it->second.size == size && it->second.write_time == write_time)
+			{
+				if (auto shader = it->second.shader.lock())
+				{
+					m_stats.file_reads_avoided++;
+					m_stats.module_creations_avoided++;
+					return shader;
+				}
+			}
+		}
+
+		std::vector<char> code = core::ShaderModule::readFile(path);
+		std::shared_ptr<const Shader> shader = load(std::move(code));
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		m_stats.file_reads++;
+		m_files[path.string()] = FileEntry{size, write_time, shader};
+		prune();
+
+		return shader;
+	}
+
+	std::shared_ptr<const ShaderModuleCache::Shader> ShaderModuleCache::load(std::vector<char> && code)
+	{
+		if (code.empty() || code.size() % sizeof(uint32_t) != 0)
+		{
+			throw std::runtime_error("failed to load shader: code size is not a multiple of 4.");
+		}
+
+		uint64_t hash = hashCode(code);
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			if (auto shader = find(code, hash))
+			{
+				m_stats.module_creations_avoided++;
+				return shader;
+			}
+		}
+
+		// created outside the lock, two threads loading the same new code may both create it, the last one is kept
+		auto shader = std::make_shared<const Shader>(m_device, std::move(code), hash);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		m_stats.module_creations++;
+		// locked once, the last pipeline holding the module may release it outside the mutex
+		auto& cached = m_shaders[hash];
+		auto existing = cached.lock();
+		if (existing == nullptr || existing->code() == shader->code())
+		{
+			cached = shader;
+		}
+		prune();
+
+		return shader;
+	}
+
+	ShaderModuleCache::Stats ShaderModuleCache::stats()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		Stats stats = m_stats;
+		stats.live_modules = 0;
+		for (auto& shader : m_shaders)
+		{
+			stats.live_modules += shader.second.expired() ? 0 : 1;
+		}
+		return stats;
+	}
+
+	std::shared_ptr<const ShaderModuleCache::Shader> ShaderModuleCache::find(const std::vector<char> & code, uint64_t hash)
+	{
+		auto it = m_shaders.find(hash);
+		if (it == m_shaders.end())
+		{
+			return nullptr;
+		}
+
+		auto shader = it->second.lock();
+		if (shader == nullptr)
+		{
+			m_shaders.erase(it);
+			return nullptr;
+		}
+		// a hash collision gets its own module, it is just not shared
+		if (shader->code() != code)
+		{
+			return nullptr;
+		}
+		return shader;
+	}
+
+	void ShaderModuleCache::prune()
+	{
+		// a full pass only when the maps doubled since the last one, so inserting stays amortized constant
+		if (m_files.size() + m_shaders.size() < 2 * m_pruned_size)
+		{
+			return;
+		}
+
+		for (auto it = m_files.begin(); it != m_files.end();)
+		{
+			it = it->second.shader.expired() ? m_files.erase(it) : std::next(it);
+		}
+		for (auto it = m_shaders.begin(); it != m_shaders.end();)
+		{
+			it = it->second.expired() ? m_shaders.erase(it) : std::next(it);
+		}
+
+		m_pruned_size = std::max<size_t>(m_files.size() + m_shaders.size(), 16);
+	}
+}
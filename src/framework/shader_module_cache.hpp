@@ -0,0 +1,96 @@
+#pragma once
+
+#include "defines.hpp"
+#include "core/pipeline/shader_module.hpp"
+#include "spirv/parser.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// Device-wide shader modules keyed by a hash of their SPIR-V, shared by every pipeline using the same code.
+	// A module lives as long as a pipeline holds it. Files are only read again when their size
+	// or modification time changed since the last load.
+	class ShaderModuleCache
+	{
+
+	public:
+
+		class Shader
+		{
+
+		public:
+
+			Shader(VkDevice device, std::vector<char> && code, uint64_t hash);
+
+			VkShaderModule getVk() const { return m_module->getVk(); }
+			const std::vector<char> & code() const { return m_code; }
+			uint64_t hash() const { return m_hash; }
+
+			// reflected on first use
+			const ShaderReflection & reflection() const;
+
+		private:
+
+			std::vector<char> m_code;
+			uint64_t m_hash;
+			std::unique_ptr<core::ShaderModule> m_module;
+
+			mutable std::once_flag m_reflection_once;
+			mutable std::unique_ptr<ShaderReflection> m_reflection;
+
+		};
+
+		struct Stats
+		{
+			uint64_t file_reads = 0;
+			uint64_t file_reads_avoided = 0;
+			uint64_t module_creations = 0;
+			uint64_t module_creations_avoided = 0;
+			uint32_t live_modules = 0;
+		};
+
+		ShaderModuleCache(VkDevice device);
+		ShaderModuleCache(const ShaderModuleCache &) = delete;
+		ShaderModuleCache(ShaderModuleCache && other) = delete;
+		ShaderModuleCache & operator=(const ShaderModuleCache &) = delete;
+		ShaderModuleCache & operator=(ShaderModuleCache && other) = delete;
+		~ShaderModuleCache();
+
+		// safe to call from several threads
+		std::shared_ptr<const Shader> load(const std::filesystem::path & path);
+		std::shared_ptr<const Shader> load(std::vector<char> && code);
+
+		Stats stats();
+
+	private:
+
+		struct FileEntry
+		{
+			uintmax_t size;
+			std::filesystem::file_time_type write_time;
+			std::weak_ptr<const Shader> shader;
+		};
+
+		VkDevice m_device;
+
+		std::unordered_map<std::string, FileEntry> m_files;
+		std::unordered_map<uint64_t, std::weak_ptr<const Shader>> m_shaders;
+		// entries of shaders no pipeline holds anymore are erased when the maps grow past twice this size
+		size_t m_pruned_size = 16;
+		Stats m_stats;
+
+		std::mutex m_mutex;
+
+		std::shared_ptr<const Shader> find(const std::vector<char> & code, uint64_t hash);
+		void prune();
+
+	};
+}
@@ -1,320 +1,693 @@
 #include "parser.hpp"
+#include "spriv.hpp"
 
-std::string storageClassName(uint32_t n)
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
 {
-	switch (n)
+	namespace
 	{
-		case spv::StorageClassUniformConstant: return "uniformConstant";
-		case spv::StorageClassInput: return "input";
-		case spv::StorageClassUniform: return "uniform";
-		case spv::StorageClassOutput: return "output";
-		case spv::StorageClassWorkgroup: return "workgroup";
-		case spv::StorageClassCrossWorkgroup: return "crossWorkgroup";
-		case spv::StorageClassPrivate: return "private";
-		case spv::StorageClassFunction: return "function";
-		case spv::StorageClassGeneric: return "generic";
-		case spv::StorageClassPushConstant: return "pushConstant";
-		case spv::StorageClassAtomicCounter : return "atomicCounter";
-		case spv::StorageClassImage : return "image";
-		case spv::StorageClassStorageBuffer : return "storageBuffer";
-		default: return "unknown";
-	}
-}
+		const uint32_t no_value = 0xFFFFFFFF;
 
-void ShaderTypeInfo::addBaseType(const ShaderTypeInfo& type)
-{
-	baseTypesID.push_back(type.id);
-	size += type.size;
-}
+		enum IdFlag : uint32_t
+		{
+			ID_BLOCK = 1 << 0,
+			ID_BUFFER_BLOCK = 1 << 1,
+			ID_BUILTIN = 1 << 2
+		};
 
-void ShaderTypeInfo::print()
-{
-	std::cout << "%" << id << ":\n";
-	std::cout << "  opType: " << opType << "\n";
-	if (baseTypesID.size() > 0)
-	{
-		std::cout << "  baseTypesID: ";
-		for (auto& id : baseTypesID)
-			std::cout << "%" << id << " ";
-		std::cout << "\n";
-	}
-	if (size > 0)
-		std::cout << "  size: " << size << "\n";
-	if (storageClass != spv::StorageClassMax)
-		std::cout << "  storageClass: " << storageClassName(storageClass) << "\n";
-	for (auto& decoration : decorations)
-	{
-		std::cout << "  decoration: " << decoration;
-		switch (decoration)
+		struct IdInfo
 		{
-			case spv::DecorationLocation:
-				std::cout << " (Location) " << location;
-				break;
-			case spv::DecorationBinding:
-				std::cout << " (Binding) " << binding;
-				break;
-			case spv::DecorationDescriptorSet:
-				std::cout << " (DescriptorSet) " << set;
-				break;
-			default:
-				break;
-		}
-		std::cout << "\n";
-	}
-}
+			// instruction defining the id and where it is in the code, 0 for an id not defined yet
+			uint32_t opcode = 0;
+			uint32_t word = 0;
+			const char *name = nullptr;
+			uint32_t flags = 0;
+			uint32_t set = 0;
+			uint32_t binding = 0;
+			uint32_t location = no_value;
+			uint32_t array_stride = 0;
+			// structs only, first member in Module::members
+			uint32_t member_begin = 0;
+		};
 
+		struct MemberInfo
+		{
+			const char *name = nullptr;
+			uint32_t offset = no_value;
+			uint32_t matrix_stride = 0;
+			bool row_major = false;
+			bool builtin = false;
+		};
 
-// static std::map<uint32_t, ShaderTypeInfo> typeInfoMap;
+		// ids of the types, constants and variables of a module, indexed by id
+		class Module
+		{
 
-static void openSpirv(const std::string& filename, std::vector<uint32_t> &spirvCode)
-{
-	std::ifstream file(filename, std::ios::binary | std::ios::ate);
-	if (!file.is_open())
-	{
-		throw std::runtime_error("failed to open file " + filename + ".");
-	}
+		public:
 
-	size_t fileSize = (size_t)file.tellg();
-	file.seekg(0);
+			Module(const uint32_t *code, size_t word_count):
+				m_code(code),
+				m_word_count(word_count)
+			{
+				if (word_count < 5 || code[0] != spv::MagicNumber)
+				{
+					throw std::runtime_error("failed to reflect shader: not a SPIR-V module.");
+				}
 
-	std::vector<char> buffer(fileSize);
-	file.read(buffer.data(), fileSize);
+				m_ids.resize(code[3]);
+				parse();
+			}
 
-	file.close();
+			uint32_t executionModel() const { return m_execution_model; }
+			const char *entryPoint() const { return m_entry_point; }
+			const std::vector<uint32_t> & variables() const { return m_variables; }
 
-	spirvCode.clear();
-	spirvCode.resize(fileSize / sizeof(uint32_t));
-	memcpy(spirvCode.data(), buffer.data(), fileSize);
-}
+			const IdInfo & id(uint32_t id) const
+			{
+				if (id >= m_ids.size() || m_ids[id].opcode == 0)
+				{
+					throw std::runtime_error("failed to reflect shader: undefined id %" + std::to_string(id) + ".");
+				}
+				return m_ids[id];
+			}
 
-static void parseInstruction(uint32_t opcode, uint32_t* args, uint32_t count, std::map<uint32_t, ShaderTypeInfo> &typeInfoMap)
-{
-	switch (opcode)
-	{
-		case spv::OpTypeVoid:
-			std::cout << "%" << args[0] << " = OpTypeVoid" << std::endl;
-			typeInfoMap[args[0]].id = args[0];
-			typeInfoMap[args[0]].opType = spv::OpTypeVoid;
-			typeInfoMap[args[0]].size = 0;
-			break;
-		case spv::OpTypeBool:
-			std::cout << "%" << args[0] << " = OpTypeBool" << std::endl;
-			typeInfoMap[args[0]].id = args[0];
-			typeInfoMap[args[0]].opType = spv::OpTypeBool;
-			typeInfoMap[args[0]].size = 1;
-			break;
-		case spv::OpTypeInt:
-			std::cout << "%" << args[0] << " = OpTypeInt " << args[1] << " " << args[2] << std::endl;
-			typeInfoMap[args[0]].id = args[0];
-			typeInfoMap[args[0]].opType = spv::OpTypeInt;
-			typeInfoMap[args[0]].size = args[1] / 8;
-			break;
-		case spv::OpTypeFloat:
-			std::cout << "%" << args[0] << " = OpTypeFloat " << args[1] << std::endl;
-			typeInfoMap[args[0]].id = args[0];
-			typeInfoMap[args[0]].opType = spv::OpTypeFloat;
-			typeInfoMap[args[0]].size = args[1] / 8;
-			break;
-		case spv::OpTypeVector:
-			std::cout << "%" << args[0] << " = OpTypeVector %" << args[1] << " " << args[2] << std::endl;
-			typeInfoMap[args[0]].id = args[0];
-			typeInfoMap[args[0]].opType = spv::OpTypeVector;
-			typeInfoMap[args[0]].baseTypesID.push_back(args[1]);
-			typeInfoMap[args[0]].size = typeInfoMap[args[1]].size * args[2];
-			break;
-		case spv::OpTypeMatrix:
-			std::cout << "%" << args[0] << " = OpTypeMatrix %" << args[1] << " " << args[2] << std::endl;
-			typeInfoMap[args[0]].id = args[0];
-			typeInfoMap[args[0]].opType = spv::OpTypeMatrix;
-			typeInfoMap[args[0]].baseTypesID.push_back(args[1]);
-			typeInfoMap[args[0]].size = typeInfoMap[args[1]].size * args[2];
-			break;
-		case spv::OpTypeImage:
-			std::cout << "%" << args[0] << " = OpTypeImage %" << args[1] << " " << args[2] << " " << args[3] << " " << args[4] << " " << args[5] << " " << args[6] << " " << args[7] << std::endl;
-			break;
-		case spv::OpTypeSampler:
-			std::cout << "%" << args[0] << " = OpTypeSampler" << std::endl;
-			break;
-		case spv::OpTypeSampledImage:
-			std::cout << "%" << args[0] << " = OpTypeSampledImage %" << args[1] << std::endl;
-			typeInfoMap[args[0]].id = args[0];
-			typeInfoMap[args[0]].opType = spv::OpTypeSampledImage;
-			typeInfoMap[args[0]].baseTypesID.push_back(args[1]);
-			break;
-		case spv::OpTypeArray:
-			std::cout << "%" << args[0] << " = OpTypeArray %" << args[1] << " %" << args[2] << std::endl;
-			break;
-		case spv::OpTypeStruct:
-			std::cout << "%" << args[0] << " = OpTypeStruct";
-			for (uint32_t i = 1; i < count; i++)
-				std::cout << " %" << args[i];
-			std::cout << std::endl;
-			typeInfoMap[args[0]].id = args[0];
-			typeInfoMap[args[0]].opType = spv::OpTypeStruct;
-			for (uint32_t i = 1; i < count; i++)
+			// operands of the defining instruction, after the opcode word
+			const uint32_t *words(uint32_t id_value) const { return m_code + id(id_value).word + 1; }
+
+			const MemberInfo & member(uint32_t struct_id, uint32_t index) const { return m_members[id(struct_id).member_begin + index]; }
+			uint32_t memberCount(uint32_t struct_id) const { return (m_code[id(struct_id).word] >> 16) - 2; }
+			uint32_t memberType(uint32_t struct_id, uint32_t index) const { return words(struct_id)[1 + index]; }
+
+			uint32_t constantValue(uint32_t constant_id) const
 			{
-				typeInfoMap[args[0]].baseTypesID.push_back(args[i]);
-				typeInfoMap[args[0]].size += typeInfoMap[args[i]].size;
+				const IdInfo & constant = id(constant_id);
+				if (constant.opcode != spv::OpConstant && constant.opcode != spv::OpSpecConstant)
+				{
+					throw std::runtime_error("failed to reflect shader: array length is not a constant.");
+				}
+				// specialization constants are reflected with their default value
+				return m_code[constant.word + 3];
 			}
-			break;
-		case spv::OpTypePointer:
-			std::cout << "%" << args[0] << " = OpTypePointer " << storageClassName(args[1]) << " %" << args[2] << std::endl;
-			typeInfoMap[args[0]].id = args[0];
-			typeInfoMap[args[0]].opType = spv::OpTypePointer;
-			typeInfoMap[args[0]].baseTypesID.push_back(args[2]);
-			typeInfoMap[args[0]].storageClass = (spv::StorageClass)args[1];
-			break;
-		case spv::OpVariable:
-			std::cout << "%" << args[1] << " = OpVariable %" << args[0] << " " << storageClassName(args[2]) << " " << args[3] << std::endl;
-			typeInfoMap[args[1]].id = args[1];
-			typeInfoMap[args[1]].opType = spv::OpVariable;
-			typeInfoMap[args[1]].baseTypesID.push_back(args[0]);
-			typeInfoMap[args[1]].storageClass = (spv::StorageClass)args[2];
-			break;
-		case spv::OpDecorate:
-			std::cout << "OpDecorate %" << args[0] << " " << args[1];
-			typeInfoMap[args[0]].decorations.push_back((spv::Decoration)args[1]);
-			switch (args[1])
+
+			// size as laid out in memory, using the stride decorations when there are some
+			uint32_t typeSize(uint32_t type_id, uint32_t matrix_stride = 0, bool row_major = false) const
 			{
-				case spv::DecorationLocation:
-					std::cout << " (Location) " << args[2];
-					typeInfoMap[args[0]].location = args[2];
-					break;
-				case spv::DecorationBinding:
-					std::cout << " (Binding) " << args[2];
-					typeInfoMap[args[0]].binding = args[2];
-					break;
-				case spv::DecorationDescriptorSet:
-					std::cout << " (DescriptorSet) " << args[2];
-					typeInfoMap[args[0]].set = args[2];
-					break;
+				const IdInfo & type = id(type_id);
+				const uint32_t *operands = words(type_id);
+
+				switch (type.opcode)
+				{
+					case spv::OpTypeBool:
+						return 4;
+					case spv::OpTypeInt:
+					case spv::OpTypeFloat:
+						return operands[1] / 8;
+					case spv::OpTypeVector:
+						return typeSize(operands[1]) * operands[2];
+					case spv::OpTypeMatrix:
+					{
+						uint32_t columns = operands[2];
+						if (matrix_stride == 0)
+						{
+							return typeSize(operands[1]) * columns;
+						}
+						uint32_t rows = words(operands[1])[2];
+						return (row_major ? rows : columns) * matrix_stride;
+					}
+					case spv::OpTypeArray:
+					{
+						uint32_t stride = type.array_stride != 0 ? type.array_stride : typeSize(operands[1], matrix_stride, row_major);
+						return constantValue(operands[2]) * stride;
+					}
+					case spv::OpTypeRuntimeArray:
+						return 0;
+					case spv::OpTypeStruct:
+					{
+						uint32_t size = 0;
+						uint32_t end = 0;
+						for (uint32_t i = 0; i < memberCount(type_id); i++)
+						{
+							const MemberInfo & info = member(type_id, i);
+							uint32_t offset = info.offset != no_value ? info.offset : end;
+							end = offset + typeSize(memberType(type_id, i), info.matrix_stride, info.row_major);
+							size = std::max(size, end);
+						}
+						return size;
+					}
+					case spv::OpTypePointer:
+						// physical storage buffer address
+						return 8;
+					default:
+						return 0;
+				}
+			}
+
+		private:
+
+			const uint32_t *m_code;
+			size_t m_word_count;
+
+			std::vector<IdInfo> m_ids;
+			std::vector<MemberInfo> m_members;
+			std::vector<uint32_t> m_variables;
+
+			uint32_t m_execution_model = no_value;
+			const char *m_entry_point = "";
+
+			IdInfo & define(uint32_t id_value, uint32_t opcode, uint32_t word)
+			{
+				if (id_value >= m_ids.size())
+				{
+					throw std::runtime_error("failed to reflect shader: id %" + std::to_string(id_value) + " out of bound.");
+				}
+				m_ids[id_value].opcode = opcode;
+				m_ids[id_value].word = word;
+				return m_ids[id_value];
+			}
+
+			IdInfo & decorated(uint32_t id_value)
+			{
+				if (id_value >= m_ids.size())
+				{
+					throw std::runtime_error("failed to reflect shader: id %" + std::to_string(id_value) + " out of bound.");
+				}
+				return m_ids[id_value];
+			}
+
+			// literal strings are nul terminated inside the instruction
+			const char *readString(uint32_t word, uint32_t instruction_end) const
+			{
+				if (word >= instruction_end)
+				{
+					throw std::runtime_error("failed to reflect shader: missing string.");
+				}
+				const char *string = reinterpret_cast<const char *>(m_code + word);
+				size_t max_length = (instruction_end - word) * sizeof(uint32_t);
+				if (strnlen(string, max_length) == max_length)
+				{
+					throw std::runtime_error("failed to reflect shader: unterminated string.");
+				}
+				return string;
+			}
+
+			void parse()
+			{
+				// member decorations come before the struct they apply to, they are resolved once every type is known
+				std::vector<uint32_t> member_instructions;
+				std::vector<uint32_t> structs;
+
+				for (uint32_t word = 5; word < m_word_count;)
+				{
+					uint32_t count = m_code[word] >> 16;
+					uint32_t opcode = m_code[word] & 0xFFFF;
+					if (count == 0 || word + count > m_word_count)
+					{
+						throw std::runtime_error("failed to reflect shader: truncated instruction.");
+					}
+					const uint32_t *args = m_code + word + 1;
+					uint32_t end = word + count;
+
+					switch (opcode)
+					{
+						case spv::OpEntryPoint:
+							if (m_execution_model == no_value)
+							{
+								m_execution_model = args[0];
+								m_entry_point = readString(word + 3, end);
+							}
+							break;
+						case spv::OpName:
+							decorated(args[0]).name = readString(word + 2, end);
+							break;
+						case spv::OpMemberName:
+						case spv::OpMemberDecorate:
+							member_instructions.push_back(word);
+							break;
+						case spv::OpDecorate:
+						{
+							IdInfo & info = decorated(args[0]);
+							uint32_t value = count > 3 ? args[2] : 0;
+							switch (args[1])
+							{
+								case spv::DecorationDescriptorSet: info.set = value; break;
+								case spv::DecorationBinding: info.binding = value; break;
+								case spv::DecorationLocation: info.location = value; break;
+								case spv::DecorationArrayStride: info.array_stride = value; break;
+								case spv::DecorationBlock: info.flags |= ID_BLOCK; break;
+								case spv::DecorationBufferBlock: info.flags |= ID_BUFFER_BLOCK; break;
+								case spv::DecorationBuiltIn: info.flags |= ID_BUILTIN; break;
+								default: break;
+							}
+							break;
+						}
+						case spv::OpTypeStruct:
+							define(args[0], opcode, word);
+							structs.push_back(args[0]);
+							break;
+						case spv::OpTypeVoid:
+						case spv::OpTypeBool:
+						case spv::OpTypeInt:
+						case spv::OpTypeFloat:
+						case spv::OpTypeVector:
+						case spv::OpTypeMatrix:
+						case spv::OpTypeImage:
+						case spv::OpTypeSampler:
+						case spv::OpTypeSampledImage:
+						case spv::OpTypeArray:
+						case spv::OpTypeRuntimeArray:
+						case spv::OpTypePointer:
+						case spv::OpTypeAccelerationStructureKHR:
+							define(args[0], opcode, word);
+							break;
+						case spv::OpConstant:
+						case spv::OpSpecConstant:
+							define(args[1], opcode, word);
+							break;
+						case spv::OpVariable:
+							define(args[1], opcode, word);
+							if (args[2] != spv::StorageClassFunction)
+							{
+								m_variables.push_back(args[1]);
+							}
+							break;
+						default:
+							break;
+					}
+
+					// every global is declared before the first function
+					if (opcode == spv::OpFunction)
+					{
+						break;
+					}
+					word = end;
+				}
+
+				if (m_execution_model == no_value)
+				{
+					throw std::runtime_error("failed to reflect shader: no entry point.");
+				}
+
+				for (uint32_t struct_id : structs)
+				{
+					m_ids[struct_id].member_begin = static_cast<uint32_t>(m_members.size());
+					m_members.resize(m_members.size() + memberCount(struct_id));
+				}
+
+				for (uint32_t word : member_instructions)
+				{
+					const uint32_t *args = m_code + word + 1;
+					uint32_t end = word + (m_code[word] >> 16);
+					if (args[0] >= m_ids.size() || m_ids[args[0]].opcode != spv::OpTypeStruct || args[1] >= memberCount(args[0]))
+					{
+						throw std::runtime_error("failed to reflect shader: member of an undefined struct.");
+					}
+					MemberInfo & info = m_members[m_ids[args[0]].member_begin + args[1]];
+
+					if ((m_code[word] & 0xFFFF) == spv::OpMemberName)
+					{
+						info.name = readString(word + 3, end);
+						continue;
+					}
+					uint32_t value = end - word > 4 ? args[3] : 0;
+					switch (args[2])
+					{
+						case spv::DecorationOffset: info.offset = value; break;
+						case spv::DecorationMatrixStride: info.matrix_stride = value; break;
+						case spv::DecorationRowMajor: info.row_major = true; break;
+						case spv::DecorationBuiltIn: info.builtin = true; break;
+						default: break;
+					}
+				}
+			}
+
+		};
+
+		VkShaderStageFlagBits stageOf(uint32_t execution_model)
+		{
+			switch (execution_model)
+			{
+				case spv::ExecutionModelVertex: return VK_SHADER_STAGE_VERTEX_BIT;
+				case spv::ExecutionModelTessellationControl: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+				case spv::ExecutionModelTessellationEvaluation: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+				case spv::ExecutionModelGeometry: return VK_SHADER_STAGE_GEOMETRY_BIT;
+				case spv::ExecutionModelFragment: return VK_SHADER_STAGE_FRAGMENT_BIT;
+				case spv::ExecutionModelGLCompute: return VK_SHADER_STAGE_COMPUTE_BIT;
+				case spv::ExecutionModelTaskEXT: return VK_SHADER_STAGE_TASK_BIT_EXT;
+				case spv::ExecutionModelMeshEXT: return VK_SHADER_STAGE_MESH_BIT_EXT;
 				default:
-					break;
+					throw std::runtime_error("failed to reflect shader: unsupported execution model " + std::to_string(execution_model) + ".");
 			}
-			std::cout << std::endl;
-			break;
-		default:
-			break;
-	}
-}
+		}
 
-static void fillShaderTypeInfoMap(std::vector<uint32_t> &spirvCode, std::map<uint32_t, ShaderTypeInfo> &typeInfoMap)
-{
-	size_t offset = 0;
-	uint32_t magic = spirvCode[offset++];
-	uint32_t version = spirvCode[offset++];
-	uint32_t generator = spirvCode[offset++];
-	uint32_t bound = spirvCode[offset++];
-	uint32_t schema = spirvCode[offset++];
+		ShaderReflection::Block reflectBlock(const Module & module, uint32_t struct_id)
+		{
+			ShaderReflection::Block block;
+			block.name = module.id(struct_id).name ? module.id(struct_id).name : "";
+			block.size = module.typeSize(struct_id);
 
-	(void)magic; (void)version; (void)generator; (void)bound; (void)schema;
+			uint32_t member_count = module.memberCount(struct_id);
+			block.members.resize(member_count);
+			for (uint32_t i = 0; i < member_count; i++)
+			{
+				const MemberInfo & info = module.member(struct_id, i);
+				block.members[i].name = info.name ? info.name : "";
+				block.members[i].offset = info.offset != no_value ? info.offset : 0;
+				block.members[i].size = module.typeSize(module.memberType(struct_id, i), info.matrix_stride, info.row_major);
+			}
 
-	while (offset < spirvCode.size())
-	{
-		uint32_t wordCount = spirvCode[offset] >> 16;
-		uint32_t opcode = spirvCode[offset] & 0xFFFF;
+			return block;
+		}
 
-		parseInstruction(opcode, &spirvCode[offset + 1], wordCount - 1, typeInfoMap);
+		VkFormat vertexFormat(const Module & module, uint32_t type_id)
+		{
+			uint32_t components = 1;
+			uint32_t component_id = type_id;
+			if (module.id(type_id).opcode == spv::OpTypeVector)
+			{
+				components = module.words(type_id)[2];
+				component_id = module.words(type_id)[1];
+			}
 
-		offset += wordCount;
-	}
-}
+			uint32_t opcode = module.id(component_id).opcode;
+			const uint32_t *operands = module.words(component_id);
+			uint32_t width = operands[1];
+			static const VkFormat float_formats[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+			static const VkFormat double_formats[] = {VK_FORMAT_R64_SFLOAT, VK_FORMAT_R64G64_SFLOAT, VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_R64G64B64A64_SFLOAT};
+			static const VkFormat int_formats[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+			static const VkFormat uint_formats[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
 
-static void detectVulkanRessource(
-	std::map<uint32_t, ShaderTypeInfo>& typeInfoMap,
-	std::vector<VulkanResourceInfo>& resourceInfos,
-	VkShaderStageFlagBits stageFlags
-)
-{
-	for (auto& [id, typeInfo] : typeInfoMap)
-	{
-		if (typeInfo.opType == spv::OpVariable)
+			if (components < 1 || components > 4)
+			{
+				return VK_FORMAT_UNDEFINED;
+			}
+			if (opcode == spv::OpTypeFloat && width == 32)
+			{
+				return float_formats[components - 1];
+			}
+			if (opcode == spv::OpTypeFloat && width == 64)
+			{
+				return double_formats[components - 1];
+			}
+			if (opcode == spv::OpTypeInt && width == 32)
+			{
+				return operands[2] ? int_formats[components - 1] : uint_formats[components - 1];
+			}
+			return VK_FORMAT_UNDEFINED;
+		}
+
+		// matrices and arrays take one location per column or element
+		void reflectVertexInput(
+			const Module & module,
+			uint32_t type_id,
+			const std::string & name,
+			uint32_t & location,
+			std::vector<ShaderReflection::VertexInput> & inputs
+		)
 		{
-			uint32_t pointerID = typeInfo.baseTypesID[0];
-			uint32_t typeID = typeInfoMap[pointerID].baseTypesID[0];
-			switch (typeInfo.storageClass)
+			const uint32_t *operands = module.words(type_id);
+			switch (module.id(type_id).opcode)
 			{
-				case spv::StorageClassUniformConstant: // 0
+				case spv::OpTypeArray:
+					for (uint32_t i = 0; i < module.constantValue(operands[2]); i++)
+					{
+						reflectVertexInput(module, operands[1], name, location, inputs);
+					}
+					return;
+				case spv::OpTypeMatrix:
+					for (uint32_t i = 0; i < operands[2]; i++)
+					{
+						reflectVertexInput(module, operands[1], name, location, inputs);
+					}
+					return;
+				default:
 				{
-					if (typeInfoMap[typeID].opType == spv::OpTypeSampledImage)
+					ShaderReflection::VertexInput input;
+					input.name = name;
+					input.location = location;
+					input.format = vertexFormat(module, type_id);
+					if (input.format == VK_FORMAT_UNDEFINED)
 					{
-						std::cout << "layout(set = " << typeInfo.set
-							<< ", binding = " << typeInfo.binding
-							<< ") uniform sampler2D ";
-						VulkanResourceInfo resourceInfo;
-						resourceInfo.type = VulkanResourceInfo::IMAGE_SAMPLER;
-						resourceInfo.stageFlags = stageFlags;
-						resourceInfo.imageSamplerDescriptorSet = typeInfo.set;
-						resourceInfo.imageSamplerBinding = typeInfo.binding;
-						resourceInfos.push_back(resourceInfo);
+						throw std::runtime_error("failed to reflect shader: unsupported type for vertex input " + name + ".");
 					}
-					break;
+					// 64 bits vec3 and vec4 take two locations
+					location += ShaderReflection::formatSize(input.format) > 16 ? 2 : 1;
+					inputs.push_back(input);
+					return;
 				}
-				case spv::StorageClassInput: // 1
+			}
+		}
+	}
+
+	ShaderReflection::ShaderReflection(const std::vector<char> & code):
+		ShaderReflection(reinterpret_cast<const uint32_t *>(code.data()), code.size() / sizeof(uint32_t))
+	{
+	}
+
+	ShaderReflection::ShaderReflection(const uint32_t *code, size_t word_count)
+	{
+		Module module(code, word_count);
+
+		m_stage = stageOf(module.executionModel());
+		m_entry_point = module.entryPoint();
+
+		for (uint32_t variable_id : module.variables())
+		{
+			const IdInfo & variable = module.id(variable_id);
+			const uint32_t *operands = module.words(variable_id);
+			uint32_t storage_class = operands[2];
+			uint32_t type_id = module.words(operands[0])[2];
+			std::string name = variable.name ? variable.name : "";
+
+			if (storage_class == spv::StorageClassInput)
+			{
+				bool builtin = (variable.flags & ID_BUILTIN)
+					|| (
+						module.id(type_id).opcode == spv::OpTypeStruct
+						&& module.memberCount(type_id) > 0
+						&& module.member(type_id, 0).builtin
+					);
+				if (m_stage == VK_SHADER_STAGE_VERTEX_BIT && builtin == false && variable.location != no_value)
 				{
-					std::cout << "layout(location = " << typeInfo.location << ") in " << typeInfoMap[typeID].size << " ";
-					break;
+					uint32_t location = variable.location;
+					reflectVertexInput(module, type_id, name, location, m_vertex_inputs);
 				}
-				case spv::StorageClassUniform: // 2
+				continue;
+			}
+
+			if (storage_class == spv::StorageClassPushConstant)
+			{
+				PushConstant push_constant;
+				push_constant.block = reflectBlock(module, type_id);
+				if (push_constant.block.size == 0)
 				{
-					std::cout << "layout(set = " << typeInfo.set
-						<< ", binding = " << typeInfo.binding
-						<< ") uniform " << typeInfoMap[typeID].size << " ";
-					
-					VulkanResourceInfo resourceInfo;
-					resourceInfo.type = VulkanResourceInfo::UNIFORM_BUFFER;
-					resourceInfo.stageFlags = stageFlags;
-					resourceInfo.uniformBufferSize = typeInfoMap[typeID].size;
-					resourceInfo.uniformBufferDescriptorSet = typeInfo.set;
-					resourceInfo.uniformBufferBinding = typeInfo.binding;
-					resourceInfos.push_back(resourceInfo);
-					break;
+					continue;
 				}
-				case spv::StorageClassOutput: // 3
+
+				uint32_t offset = push_constant.block.size;
+				for (auto& member : push_constant.block.members)
 				{
-					std::cout << "layout(location = " << typeInfo.location << ") out " << typeInfoMap[typeID].size << " ";
-					break;
+					offset = std::min(offset, member.offset);
 				}
-				case spv::StorageClassPushConstant: // 9
+				push_constant.range.stageFlags = m_stage;
+				push_constant.range.offset = offset;
+				push_constant.range.size = push_constant.block.size - offset;
+				m_push_constants.push_back(push_constant);
+				continue;
+			}
+
+			if (
+				storage_class != spv::StorageClassUniformConstant
+				&& storage_class != spv::StorageClassUniform
+				&& storage_class != spv::StorageClassStorageBuffer
+			)
+			{
+				continue;
+			}
+
+			DescriptorBinding binding;
+			binding.set = variable.set;
+			binding.binding = variable.binding;
+			binding.stage_flags = m_stage;
+
+			// arrays of descriptors, a runtime array has no count until the set is allocated
+			while (module.id(type_id).opcode == spv::OpTypeArray || module.id(type_id).opcode == spv::OpTypeRuntimeArray)
+			{
+				const uint32_t *array = module.words(type_id);
+				binding.count = module.id(type_id).opcode == spv::OpTypeArray ? binding.count * module.constantValue(array[2]) : 0;
+				type_id = array[1];
+			}
+
+			const IdInfo & type = module.id(type_id);
+			const uint32_t *type_operands = module.words(type_id);
+			switch (type.opcode)
+			{
+				case spv::OpTypeSampledImage:
+					binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+					break;
+				case spv::OpTypeSampler:
+					binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+					break;
+				case spv::OpTypeImage:
 				{
-					std::cout << "layout(push_constant) push_constant " << typeInfoMap[typeID].size << " ";
-					VulkanResourceInfo resourceInfo;
-					resourceInfo.type = VulkanResourceInfo::PUSH_CONSTANT;
-					resourceInfo.stageFlags = stageFlags;
-					resourceInfo.pushConstantSize = typeInfoMap[typeID].size;
-					resourceInfos.push_back(resourceInfo);
+					uint32_t dim = type_operands[2];
+					bool storage = type_operands[6] == 2;
+					if (dim == spv::DimSubpassData)
+					{
+						binding.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+					}
+					else if (dim == spv::DimBuffer)
+					{
+						binding.type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+					}
+					else
+					{
+						binding.type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+					}
 					break;
 				}
-				default:
+				case spv::OpTypeStruct:
+					if (storage_class == spv::StorageClassStorageBuffer || (type.flags & ID_BUFFER_BLOCK))
+					{
+						binding.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					}
+					else
+					{
+						binding.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+					}
+					binding.block = reflectBlock(module, type_id);
 					break;
+				default:
+					// acceleration structures and anything else this library does not bind
+					continue;
 			}
-			std::cout << std::endl;
+
+			binding.name = name.empty() ? binding.block.name : name;
+			m_descriptor_bindings.push_back(std::move(binding));
 		}
+
+		std::sort(m_descriptor_bindings.begin(), m_descriptor_bindings.end(), [](const DescriptorBinding & a, const DescriptorBinding & b)
+		{
+			return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+		});
+		std::sort(m_vertex_inputs.begin(), m_vertex_inputs.end(), [](const VertexInput & a, const VertexInput & b)
+		{
+			return a.location < b.location;
+		});
 	}
-}
 
-std::vector<VulkanResourceInfo> parseSpriv(const std::string& vertexShaderFile, const std::string& fragmentShaderFile)
-{
-	// read vertex shader
-	std::vector<uint32_t> vertexShaderCode;
-	openSpirv(vertexShaderFile, vertexShaderCode);
+	std::vector<std::vector<VkDescriptorSetLayoutBinding>> ShaderReflection::setLayoutBindings(
+		const std::vector<const ShaderReflection *> & stages
+	)
+	{
+		std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
 
-	std::map<uint32_t, ShaderTypeInfo> vertexShaderTypeInfoMap;
-	fillShaderTypeInfoMap(vertexShaderCode, vertexShaderTypeInfoMap);
+		for (const ShaderReflection *stage : stages)
+		{
+			for (auto& binding : stage->descriptorBindings())
+			{
+				if (binding.set >= sets.size())
+				{
+					sets.resize(binding.set + 1);
+				}
+				auto& set = sets[binding.set];
 
-	// read fragment shader
-	std::vector<uint32_t> fragmentShaderCode;
-	openSpirv(fragmentShaderFile, fragmentShaderCode);
+				auto it = std::find_if(set.begin(), set.end(), [&](const VkDescriptorSetLayoutBinding & layout_binding)
+				{
+					return layout_binding.binding == binding.binding;
+				});
+				if (it == set.end())
+				{
+					VkDescriptorSetLayoutBinding layout_binding = {};
+					layout_binding.binding = binding.binding;
+					layout_binding.descriptorType = binding.type;
+					layout_binding.descriptorCount = binding.count;
+					layout_binding.stageFlags = binding.stage_flags;
+					set.push_back(layout_binding);
+					continue;
+				}
 
-	std::map<uint32_t, ShaderTypeInfo> fragmentShaderTypeInfoMap;
-	fillShaderTypeInfoMap(fragmentShaderCode, fragmentShaderTypeInfoMap);
+				if (it->descriptorType != binding.type)
+				{
+					throw std::runtime_error(
+						"failed to merge shader reflections: set " + std::to_string(binding.set)
+						+ " binding " + std::to_string(binding.binding) + " has different types in different stages."
+					);
+				}
+				it->stageFlags |= binding.stage_flags;
+				it->descriptorCount = std::max(it->descriptorCount, binding.count);
+			}
+		}
 
+		for (auto& set : sets)
+		{
+			std::sort(set.begin(), set.end(), [](const VkDescriptorSetLayoutBinding & a, const VkDescriptorSetLayoutBinding & b)
+			{
+				return a.binding < b.binding;
+			});
+		}
 
-	std::vector<VulkanResourceInfo> resourceInfos;
+		return sets;
+	}
 
-	detectVulkanRessource(vertexShaderTypeInfoMap, resourceInfos, VK_SHADER_STAGE_VERTEX_BIT);
-	detectVulkanRessource(fragmentShaderTypeInfoMap, resourceInfos, VK_SHADER_STAGE_FRAGMENT_BIT);
+	std::vector<VkPushConstantRange> ShaderReflection::pushConstantRanges(
+		const std::vector<const ShaderReflection *> & stages
+	)
+	{
+		std::vector<VkPushConstantRange> ranges;
 
-	return resourceInfos;
-}
+		for (const ShaderReflection *stage : stages)
+		{
+			for (auto& push_constant : stage->pushConstants())
+			{
+				auto it = std::find_if(ranges.begin(), ranges.end(), [&](const VkPushConstantRange & range)
+				{
+					return range.offset == push_constant.range.offset && range.size == push_constant.range.size;
+				});
+				if (it == ranges.end())
+				{
+					ranges.push_back(push_constant.range);
+				}
+				else
+				{
+					it->stageFlags |= push_constant.range.stageFlags;
+				}
+			}
+		}
+
+		return ranges;
+	}
 
+	uint32_t ShaderReflection::formatSize(VkFormat format)
+	{
+		switch (format)
+		{
+			case VK_FORMAT_R32_SFLOAT:
+			case VK_FORMAT_R32_SINT:
+			case VK_FORMAT_R32_UINT:
+				return 4;
+			case VK_FORMAT_R32G32_SFLOAT:
+			case VK_FORMAT_R32G32_SINT:
+			case VK_FORMAT_R32G32_UINT:
+			case VK_FORMAT_R64_SFLOAT:
+				return 8;
+			case VK_FORMAT_R32G32B32_SFLOAT:
+			case VK_FORMAT_R32G32B32_SINT:
+			case VK_FORMAT_R32G32B32_UINT:
+				return 12;
+			case VK_FORMAT_R32G32B32A32_SFLOAT:
+			case VK_FORMAT_R32G32B32A32_SINT:
+			case VK_FORMAT_R32G32B32A32_UINT:
+			case VK_FORMAT_R64G64_SFLOAT:
+				return 16;
+			case VK_FORMAT_R64G64B64_SFLOAT:
+				return 24;
+			case VK_FORMAT_R64G64B64A64_SFLOAT:
+				return 32;
+			default:
+				return 0;
+		}
+	}
+}
@@ -2,65 +2,99 @@
 
 #include "defines.hpp"
 
-#include <iostream>
-#include <fstream>
-#include <vector>
-#include <cstring>
-#include <iomanip>
-#include <map>
-
-#include "spriv.hpp"
+#include <vulkan/vulkan.h>
 
-std::string storageClassName(uint32_t n);
+#include <string>
+#include <vector>
 
-struct ShaderTypeInfo
-{
-	// the ID
-	uint32_t id;
-	// the OpType* instruction
-	spv::Op opType;
-	// the IDs types this type is based on
-	std::vector<uint32_t> baseTypesID;
-	// the size in bytes
-	uint32_t size;
-	// storage class
-	spv::StorageClass storageClass = spv::StorageClassMax;
-	// decorations
-	std::vector<spv::Decoration> decorations;
-	// decorations arguments
-	uint32_t location;
-	uint32_t binding;
-	uint32_t set;
-
-	// add a base type to this type
-	void addBaseType(const ShaderTypeInfo& type);
-
-	void print();
-};
-
-struct VulkanResourceInfo
+namespace LIB_NAMESPACE
 {
-	enum Type
+	// Reflection of one SPIR-V module: descriptor bindings, push constants and vertex inputs of its entry point.
+	// Ids are looked up in flat arrays sized by the module bound, only the types and variables
+	// are read and parsing stops at the first function.
+	// Block sizes and member offsets come from the Offset, ArrayStride and MatrixStride decorations,
+	// so they are exact for std140, std430 and scalar layouts alike.
+	class ShaderReflection
 	{
-		IMAGE_SAMPLER,
-		UNIFORM_BUFFER,
-		PUSH_CONSTANT
-	};
-	Type type;
 
-	VkShaderStageFlagBits stageFlags;
+	public:
+
+		struct Member
+		{
+			std::string name;
+			uint32_t offset = 0;
+			// 0 for a runtime array
+			uint32_t size = 0;
+		};
+
+		// uniform buffer, storage buffer or push constant block, top level members only
+		struct Block
+		{
+			std::string name;
+			// up to the end of the last member, without the runtime array of a storage buffer
+			uint32_t size = 0;
+			std::vector<Member> members;
+		};
+
+		struct DescriptorBinding
+		{
+			std::string name;
+			uint32_t set = 0;
+			uint32_t binding = 0;
+			VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+			// 0 for a runtime array, the actual count is chosen when the set is allocated
+			uint32_t count = 1;
+			VkShaderStageFlags stage_flags = 0;
+			// buffers only
+			Block block;
+		};
 
-	// IMAGE_SAMPLER
-	uint32_t imageSamplerDescriptorSet;
-	uint32_t imageSamplerBinding;
+		struct PushConstant
+		{
+			VkPushConstantRange range = {};
+			Block block;
+		};
 
-	// UNIFORM_BUFFER
-	uint32_t uniformBufferSize;
-	uint32_t uniformBufferDescriptorSet;
-	uint32_t uniformBufferBinding;
+		struct VertexInput
+		{
+			std::string name;
+			uint32_t location = 0;
+			VkFormat format = VK_FORMAT_UNDEFINED;
+		};
 
-	// PUSH_CONSTANT
-	uint32_t pushConstantSize;
-};
+		ShaderReflection(const uint32_t *code, size_t word_count);
+		ShaderReflection(const std::vector<char> & code);
 
-std::vector<VulkanResourceInfo> parseSpriv(const std::string& vertexShaderFile, const std::string& fragmentShaderFile);
\ No newline at end of file
+		VkShaderStageFlagBits stage() const { return m_stage; }
+		const std::string & entryPoint() const { return m_entry_point; }
+
+		// sorted by set then binding
+		const std::vector<DescriptorBinding> & descriptorBindings() const { return m_descriptor_bindings; }
+		// at most one push constant block per stage
+		const std::vector<PushConstant> & pushConstants() const { return m_push_constants; }
+		// vertex stage only, sorted by location, built-ins excluded
+		const std::vector<VertexInput> & vertexInputs() const { return m_vertex_inputs; }
+
+		// bindings of all the stages merged, indexed by set, the stage flags of a binding used by several stages combined
+		static std::vector<std::vector<VkDescriptorSetLayoutBinding>> setLayoutBindings(
+			const std::vector<const ShaderReflection *> & stages
+		);
+		// one range per stage, stages with the same range share it
+		static std::vector<VkPushConstantRange> pushConstantRanges(
+			const std::vector<const ShaderReflection *> & stages
+		);
+
+		// size in bytes of a vertex attribute format, 0 if it is not one the reflection produces
+		static uint32_t formatSize(VkFormat format);
+
+	private:
+
+		VkShaderStageFlagBits m_stage = VK_SHADER_STAGE_ALL;
+		std::string m_entry_point;
+
+		std::vector<DescriptorBinding> m_descriptor_bindings;
+		std::vector<PushConstant> m_push_constants;
+		std::vector<VertexInput> m_vertex_inputs;
+
+	};
+}
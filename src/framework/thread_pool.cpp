@@ -0,0 +1,60 @@
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+
+namespace LIB_NAMESPACE
+{
+	ThreadPool::ThreadPool(unsigned int thread_count)
+	{
+		if (thread_count == 0)
+		{
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		m_threads.reserve(thread_count);
+		for (unsigned int i = 0; i < thread_count; i++)
+		{
+			m_threads.emplace_back(&ThreadPool::work, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_task_available.notify_all();
+
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	void ThreadPool::work()
+	{
+		TRACE_THREAD_NAME("thread pool");
+
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_task_available.wait(lock, [this]() { return m_stopping || m_tasks.empty() == false; });
+
+				if (m_tasks.empty())
+				{
+					return;
+				}
+
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+
+			// packaged_task stores exceptions in the future, nothing escapes here
+			task();
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LIB_NAMESPACE
+{
+	// Fixed set of worker threads running tasks in submission order.
+	// Tasks still queued when the pool is destroyed are run before the workers are joined.
+	class ThreadPool
+	{
+
+	public:
+
+		// 0 uses one thread per hardware thread
+		ThreadPool(unsigned int thread_count = 0);
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool(ThreadPool && other) = delete;
+		ThreadPool & operator=(const ThreadPool &) = delete;
+		ThreadPool & operator=(ThreadPool && other) = delete;
+		~ThreadPool();
+
+		// the future holds the result of the task or the exception it threw
+		template<typename Function>
+		auto submit(Function function) -> std::future<decltype(function())>
+		{
+			using Result = decltype(function());
+
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+			std::future<Result> future = task->get_future();
+
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_tasks.emplace_back([task]() { (*task)(); });
+			}
+			m_task_available.notify_one();
+
+			return future;
+		}
+
+		unsigned int threadCount() const { return static_cast<unsigned int>(m_threads.size()); }
+
+	private:
+
+		std::vector<std::thread> m_threads;
+
+		std::deque<std::function<void()>> m_tasks;
+		std::mutex m_mutex;
+		std::condition_variable m_task_available;
+		bool m_stopping = false;
+
+		void work();
+
+	};
+}
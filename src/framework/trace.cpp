@@ -0,0 +1,205 @@
+#include "trace.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace LIB_NAMESPACE
+{
+	std::mutex Trace::s_mutex;
+	std::vector<std::unique_ptr<Trace::ThreadBuffer>> Trace::s_buffers;
+	std::atomic<bool> Trace::s_recording{ true };
+
+	namespace
+	{
+		void writeJsonString(std::ostream & out, const char *string)
+		{
+			out << '"';
+			for (const char *c = string; *c != '\0'; c++)
+			{
+				if (*c == '"' || *c == '\\')
+				{
+					out << '\\';
+				}
+				if (static_cast<unsigned char>(*c) >= 0x20)
+				{
+					out << *c;
+				}
+			}
+			out << '"';
+		}
+	}
+
+	Trace::Zone::Zone(const char *name):
+		m_name(name),
+		m_start(Trace::now())
+	{
+	}
+
+	Trace::Zone::~Zone()
+	{
+		Event event = {};
+		event.name = m_name;
+		event.start = m_start;
+		event.duration = Trace::now() - m_start;
+		event.type = EventType::Zone;
+		Trace::record(event);
+	}
+
+	void Trace::counter(const char *name, double value)
+	{
+		Event event = {};
+		event.name = name;
+		event.start = now();
+		event.value = value;
+		event.type = EventType::Counter;
+		record(event);
+	}
+
+	void Trace::setThreadName(const char *name)
+	{
+		threadBuffer().thread_name.store(name, std::memory_order_release);
+	}
+
+	void Trace::start()
+	{
+		s_recording.store(true, std::memory_order_relaxed);
+	}
+
+	void Trace::stop()
+	{
+		s_recording.store(false, std::memory_order_relaxed);
+	}
+
+	bool Trace::recording()
+	{
+		return s_recording.load(std::memory_order_relaxed);
+	}
+
+	void Trace::clear()
+	{
+		std::unique_lock<std::mutex> lock(s_mutex);
+
+		for (auto& buffer : s_buffers)
+		{
+			buffer->count.store(0, std::memory_order_relaxed);
+			buffer->dropped.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	uint64_t Trace::droppedEvents()
+	{
+		std::unique_lock<std::mutex> lock(s_mutex);
+
+		uint64_t dropped = 0;
+		for (auto& buffer : s_buffers)
+		{
+			dropped += buffer->dropped.load(std::memory_order_relaxed);
+		}
+		return dropped;
+	}
+
+	void Trace::writeChromeTrace(const std::string & filename)
+	{
+		std::ofstream file(filename, std::ios::trunc);
+		if (file.is_open() == false)
+		{
+			throw std::runtime_error("failed to open trace file: " + filename);
+		}
+
+		std::unique_lock<std::mutex> lock(s_mutex);
+
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		file.precision(3);
+		file << std::fixed;
+
+		bool first = true;
+		auto separator = [&file, &first]()
+		{
+			file << (first ? "\n" : ",\n");
+			first = false;
+		};
+
+		for (auto& buffer : s_buffers)
+		{
+			const char *threadName = buffer->thread_name.load(std::memory_order_acquire);
+			if (threadName != nullptr)
+			{
+				separator();
+				file << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->thread_id << ",\"args\":{\"name\":";
+				writeJsonString(file, threadName);
+				file << "}}";
+			}
+
+			uint32_t count = buffer->count.load(std::memory_order_acquire);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const Event & event = buffer->events[i];
+
+				separator();
+				file << "{\"name\":";
+				writeJsonString(file, event.name);
+				// timestamps in microseconds
+				file << ",\"pid\":1,\"tid\":" << buffer->thread_id << ",\"ts\":" << event.start / 1000.0;
+				if (event.type == EventType::Zone)
+				{
+					file << ",\"ph\":\"X\",\"dur\":" << event.duration / 1000.0 << "}";
+				}
+				else
+				{
+					file << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}";
+				}
+			}
+		}
+
+		file << "\n]}\n";
+
+		if (file.fail())
+		{
+			throw std::runtime_error("failed to write trace file: " + filename);
+		}
+	}
+
+	uint64_t Trace::now()
+	{
+		static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	Trace::ThreadBuffer & Trace::threadBuffer()
+	{
+		// buffers outlive their thread, they are only freed with the process
+		thread_local ThreadBuffer *buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			std::unique_lock<std::mutex> lock(s_mutex);
+
+			s_buffers.push_back(std::make_unique<ThreadBuffer>());
+			buffer = s_buffers.back().get();
+			buffer->thread_id = static_cast<uint32_t>(s_buffers.size());
+			buffer->events = std::make_unique<Event[]>(events_per_thread);
+		}
+		return *buffer;
+	}
+
+	void Trace::record(const Event & event)
+	{
+		if (recording() == false)
+		{
+			return;
+		}
+
+		ThreadBuffer & buffer = threadBuffer();
+
+		// only this thread writes count, a relaxed load sees its own last store
+		uint32_t count = buffer.count.load(std::memory_order_relaxed);
+		if (count >= events_per_thread)
+		{
+			buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		buffer.events[count] = event;
+		buffer.count.store(count + 1, std::memory_order_release);
+	}
+}
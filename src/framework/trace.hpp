@@ -0,0 +1,113 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// CPU instrumentation, compiled in with the CPPVULKANAPI_TRACE CMake option.
+// Without it the macros expand to nothing, the instrumented code costs nothing.
+// Names must be string literals, only their address is recorded.
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#ifdef CPPVULKANAPI_TRACE
+#	define TRACE_ZONE(name) LIB_NAMESPACE::Trace::Zone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#	define TRACE_COUNTER(name, value) LIB_NAMESPACE::Trace::counter(name, static_cast<double>(value))
+#	define TRACE_THREAD_NAME(name) LIB_NAMESPACE::Trace::setThreadName(name)
+#else
+#	define TRACE_ZONE(name)
+#	define TRACE_COUNTER(name, value)
+#	define TRACE_THREAD_NAME(name)
+#endif
+
+namespace LIB_NAMESPACE
+{
+	// Scoped zones and counters recorded per thread and exported in the Chrome trace event format,
+	// to open in chrome://tracing or ui.perfetto.dev.
+	// Each thread appends to its own fixed size buffer without locking, a lock is only taken
+	// the first time a thread records and when exporting. Events past the capacity of a buffer are dropped.
+	class Trace
+	{
+
+	public:
+
+		static constexpr uint32_t events_per_thread = 1 << 16;
+
+		// records a complete event from construction to destruction
+		class Zone
+		{
+
+		public:
+
+			Zone(const char *name);
+			Zone(const Zone &) = delete;
+			Zone & operator=(const Zone &) = delete;
+			~Zone();
+
+		private:
+
+			const char *m_name;
+			uint64_t m_start;
+
+		};
+
+		static void counter(const char *name, double value);
+		static void setThreadName(const char *name);
+
+		// recording is on from the start, stop it to export a fixed window
+		static void start();
+		static void stop();
+		static bool recording();
+
+		// no thread may be recording
+		static void clear();
+
+		// events recorded so far, written while the other threads keep recording
+		static void writeChromeTrace(const std::string & filename);
+
+		static uint64_t droppedEvents();
+
+	private:
+
+		enum class EventType : uint8_t
+		{
+			Zone,
+			Counter
+		};
+
+		struct Event
+		{
+			const char *name;
+			uint64_t start;
+			// duration in nanoseconds of a zone
+			uint64_t duration;
+			double value;
+			EventType type;
+		};
+
+		struct ThreadBuffer
+		{
+			uint32_t thread_id;
+			std::atomic<const char *> thread_name{ nullptr };
+			// events before count are complete, published with release
+			std::atomic<uint32_t> count{ 0 };
+			std::atomic<uint64_t> dropped{ 0 };
+			std::unique_ptr<Event[]> events;
+		};
+
+		// nanoseconds since the first event of the process
+		static uint64_t now();
+		static ThreadBuffer & threadBuffer();
+		static void record(const Event & event);
+
+		static std::mutex s_mutex;
+		static std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+		static std::atomic<bool> s_recording;
+
+	};
+}
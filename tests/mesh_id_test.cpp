@@ -0,0 +1,50 @@
+#include "test.hpp"
+#include "render_api.hpp"
+#include "object/mesh_cache.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+// Mesh ids are 64 bits slot map keys, the generation in the high half must survive getMesh.
+static_assert(
+	std::is_same<decltype(&LIB_NAMESPACE::RenderAPI::getMesh), LIB_NAMESPACE::Mesh & (LIB_NAMESPACE::RenderAPI::*)(uint64_t)>::value,
+	"getMesh must take the full 64 bits id"
+);
+
+int main()
+{
+	std::unique_ptr<LIB_NAMESPACE::RenderAPI> api;
+	try
+	{
+		api = std::make_unique<LIB_NAMESPACE::RenderAPI>(VkExtent2D{ 64, 64 }, "");
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << "no Vulkan device: " << e.what() << std::endl;
+		return TEST_SKIP;
+	}
+
+	const char *path = "mesh_id_test.obj";
+	{
+		std::ofstream obj(path);
+		obj << "v 0 0 0\nv 1 0 0\nv 0 1 0\n";
+		obj << "vt 0 0\nvt 1 0\nvt 0 1\n";
+		obj << "f 1/1 2/2 3/3\n";
+	}
+
+	// parsed the first time, read back from the mesh cache written meanwhile the second time
+	uint64_t first = api->loadModel(path);
+	uint64_t second = api->loadModel(path);
+	std::remove(path);
+	std::remove(LIB_NAMESPACE::MeshCache::cachePath(path).c_str());
+
+	CHECK(first != second);
+	CHECK((first >> 32) != 0);
+	CHECK(api->getMesh(first).indexCount() == 3);
+	CHECK(api->getMesh(second).indexCount() == 3);
+
+	return 0;
+}
@@ -0,0 +1,38 @@
+#include "test.hpp"
+#include "mipmap_generator.hpp"
+
+#include <vector>
+
+using LIB_NAMESPACE::MipmapGenerator;
+
+// every level of a solid image has the same color, whatever the size and the path taken
+static bool solid(uint32_t width, uint32_t height, uint32_t mip_levels, unsigned char value, bool srgb)
+{
+	std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4, value);
+	std::vector<unsigned char> levels = MipmapGenerator::downsample(pixels.data(), width, height, mip_levels, srgb);
+
+	for (unsigned char level_value : levels)
+	{
+		if (level_value != value)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	// white sRGB texels sum to the end of the linear to sRGB table
+	CHECK(solid(64, 64, 7, 255, true));
+	CHECK(solid(37, 5, 6, 255, true));
+	CHECK(solid(1, 16, 5, 255, true));
+	CHECK(solid(64, 64, 7, 0, true));
+	CHECK(solid(64, 64, 7, 128, true));
+
+	CHECK(solid(64, 64, 7, 255, false));
+	CHECK(solid(37, 5, 6, 255, false));
+	CHECK(solid(64, 64, 7, 128, false));
+
+	return 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <iostream>
+
+// returned by a test that can not run here, reported as skipped by ctest
+#define TEST_SKIP 77
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+			return 1; \
+		} \
+	} while (0)
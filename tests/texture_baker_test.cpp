@@ -0,0 +1,57 @@
+#include "test.hpp"
+#include "bc_encoder.hpp"
+#include "mipmap_generator.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <vector>
+
+using LIB_NAMESPACE::MipmapGenerator;
+using LIB_NAMESPACE::ThreadPool;
+
+// the levels texture_baker writes for a solid white sRGB image decode back to white
+static bool bakesWhite(bc::Format format, uint32_t width, uint32_t height, ThreadPool & pool)
+{
+	uint32_t mip_levels = 1;
+	while ((std::max(width, height) >> mip_levels) > 0)
+	{
+		mip_levels++;
+	}
+
+	std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4, 255);
+	std::vector<unsigned char> chain = MipmapGenerator::downsample(pixels.data(), width, height, mip_levels, true);
+
+	size_t offset = 0;
+	for (uint32_t level = 0; level < mip_levels; level++)
+	{
+		uint32_t level_width = std::max(width >> level, 1u);
+		uint32_t level_height = std::max(height >> level, 1u);
+
+		std::vector<uint8_t> blocks = bc::encodeImage(format, chain.data() + offset, level_width, level_height, pool);
+		std::vector<uint8_t> decoded = bc::decodeImage(format, blocks.data(), level_width, level_height);
+		if (std::any_of(decoded.begin(), decoded.end(), [](uint8_t value) { return value != 255; }))
+		{
+			return false;
+		}
+
+		offset += static_cast<size_t>(level_width) * level_height * 4;
+	}
+	return true;
+}
+
+int main()
+{
+	ThreadPool pool(2);
+
+	CHECK(bakesWhite(bc::Format::BC7, 64, 64, pool));
+	CHECK(bakesWhite(bc::Format::BC7, 37, 5, pool));
+	CHECK(bakesWhite(bc::Format::BC1, 64, 64, pool));
+
+	// an empty image has no blocks, and no rows to spread over the pool
+	unsigned char pixel[4] = { 255, 255, 255, 255 };
+	CHECK(bc::encodeImage(bc::Format::BC7, pixel, 0, 0, pool).empty());
+	CHECK(bc::encodeImage(bc::Format::BC7, pixel, 4, 0, pool).empty());
+	CHECK(bc::encodeImage(bc::Format::BC1, pixel, 0, 4, pool).empty());
+
+	return 0;
+}
@@ -0,0 +1,700 @@
+#include "bc_encoder.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <stdexcept>
+
+namespace bc
+{
+	namespace
+	{
+		// texels of a block, one array per channel so 4 texels fit a SSE register
+		struct Block
+		{
+			alignas(16) float channels[4][16];
+		};
+
+		struct Palette
+		{
+			int size;
+			float colors[16][4];
+		};
+
+		const int bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		Block loadBlock(const uint8_t *pixels)
+		{
+			Block block;
+			for (int i = 0; i < 16; i++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					block.channels[c][i] = pixels[i * 4 + c];
+				}
+			}
+			return block;
+		}
+
+		float selectIndicesScalar(const Block & block, const Palette & palette, int channel_count, uint8_t *indices)
+		{
+			float total = 0.0f;
+			for (int i = 0; i < 16; i++)
+			{
+				float best = std::numeric_limits<float>::max();
+				for (int k = 0; k < palette.size; k++)
+				{
+					float error = 0.0f;
+					for (int c = 0; c < channel_count; c++)
+					{
+						float d = block.channels[c][i] - palette.colors[k][c];
+						error += d * d;
+					}
+					if (error < best)
+					{
+						best = error;
+						indices[i] = static_cast<uint8_t>(k);
+					}
+				}
+				total += best;
+			}
+			return total;
+		}
+
+#if defined(__SSE2__)
+		float selectIndicesSimd(const Block & block, const Palette & palette, int channel_count, uint8_t *indices)
+		{
+			__m128 total = _mm_setzero_ps();
+			for (int i = 0; i < 16; i += 4)
+			{
+				__m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+				__m128i bestIndex = _mm_setzero_si128();
+
+				for (int k = 0; k < palette.size; k++)
+				{
+					__m128 error = _mm_setzero_ps();
+					for (int c = 0; c < channel_count; c++)
+					{
+						__m128 d = _mm_sub_ps(_mm_load_ps(&block.channels[c][i]), _mm_set1_ps(palette.colors[k][c]));
+						error = _mm_add_ps(error, _mm_mul_ps(d, d));
+					}
+
+					// first palette entry wins ties, like the scalar search
+					__m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, best));
+					best = _mm_min_ps(best, error);
+					bestIndex = _mm_or_si128(
+						_mm_and_si128(closer, _mm_set1_epi32(k)),
+						_mm_andnot_si128(closer, bestIndex)
+					);
+				}
+
+				total = _mm_add_ps(total, best);
+
+				alignas(16) int32_t lanes[4];
+				_mm_store_si128(reinterpret_cast<__m128i *>(lanes), bestIndex);
+				for (int lane = 0; lane < 4; lane++)
+				{
+					indices[i + lane] = static_cast<uint8_t>(lanes[lane]);
+				}
+			}
+
+			alignas(16) float sums[4];
+			_mm_store_ps(sums, total);
+			return sums[0] + sums[1] + sums[2] + sums[3];
+		}
+#endif
+
+		float selectIndices(const Block & block, const Palette & palette, int channel_count, uint8_t *indices, bool simd)
+		{
+#if defined(__SSE2__)
+			if (simd)
+			{
+				return selectIndicesSimd(block, palette, channel_count, indices);
+			}
+#else
+			(void)simd;
+#endif
+			return selectIndicesScalar(block, palette, channel_count, indices);
+		}
+
+		// endpoints at both ends of the principal axis of the texels
+		void principalEndpoints(const Block & block, int channel_count, float *e0, float *e1)
+		{
+			float mean[4] = {};
+			for (int c = 0; c < channel_count; c++)
+			{
+				for (int i = 0; i < 16; i++)
+				{
+					mean[c] += block.channels[c][i];
+				}
+				mean[c] /= 16.0f;
+			}
+
+			float covariance[4][4] = {};
+			for (int i = 0; i < 16; i++)
+			{
+				for (int a = 0; a < channel_count; a++)
+				{
+					for (int b = 0; b < channel_count; b++)
+					{
+						covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+					}
+				}
+			}
+
+			// power iteration from the diagonal of the bounding box
+			float axis[4] = {};
+			for (int c = 0; c < channel_count; c++)
+			{
+				axis[c] = 1.0f;
+			}
+			for (int iteration = 0; iteration < 8; iteration++)
+			{
+				float next[4] = {};
+				float length = 0.0f;
+				for (int a = 0; a < channel_count; a++)
+				{
+					for (int b = 0; b < channel_count; b++)
+					{
+						next[a] += covariance[a][b] * axis[b];
+					}
+					length = std::max(length, std::abs(next[a]));
+				}
+				if (length == 0.0f)
+				{
+					break;
+				}
+				for (int c = 0; c < channel_count; c++)
+				{
+					axis[c] = next[c] / length;
+				}
+			}
+
+			float minT = std::numeric_limits<float>::max();
+			float maxT = -std::numeric_limits<float>::max();
+			float axisLength = 0.0f;
+			for (int c = 0; c < channel_count; c++)
+			{
+				axisLength += axis[c] * axis[c];
+			}
+			for (int i = 0; i < 16; i++)
+			{
+				float t = 0.0f;
+				for (int c = 0; c < channel_count; c++)
+				{
+					t += (block.channels[c][i] - mean[c]) * axis[c];
+				}
+				minT = std::min(minT, t);
+				maxT = std::max(maxT, t);
+			}
+			if (axisLength > 0.0f)
+			{
+				minT /= axisLength;
+				maxT /= axisLength;
+			}
+
+			for (int c = 0; c < channel_count; c++)
+			{
+				e0[c] = std::clamp(mean[c] + minT * axis[c], 0.0f, 255.0f);
+				e1[c] = std::clamp(mean[c] + maxT * axis[c], 0.0f, 255.0f);
+			}
+		}
+
+		// least squares endpoints for the chosen indices, texel = (1 - t) * e0 + t * e1
+		bool refineEndpoints(const Block & block, int channel_count, const uint8_t *indices, const float *weights, float *e0, float *e1)
+		{
+			float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+			float ax[4] = {}, bx[4] = {};
+			for (int i = 0; i < 16; i++)
+			{
+				float t = weights[indices[i]];
+				float s = 1.0f - t;
+				aa += s * s;
+				ab += s * t;
+				bb += t * t;
+				for (int c = 0; c < channel_count; c++)
+				{
+					ax[c] += s * block.channels[c][i];
+					bx[c] += t * block.channels[c][i];
+				}
+			}
+
+			float determinant = aa * bb - ab * ab;
+			if (std::abs(determinant) < 1e-6f)
+			{
+				return false;
+			}
+			for (int c = 0; c < channel_count; c++)
+			{
+				e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+				e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+			}
+			return true;
+		}
+
+		// BC1
+
+		uint16_t packColor565(const float *color)
+		{
+			uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+			uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+			uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+			return static_cast<uint16_t>(r << 11 | g << 5 | b);
+		}
+
+		void unpackColor565(uint16_t packed, int *color)
+		{
+			int r = packed >> 11 & 31;
+			int g = packed >> 5 & 63;
+			int b = packed & 31;
+			color[0] = r << 3 | r >> 2;
+			color[1] = g << 2 | g >> 4;
+			color[2] = b << 3 | b >> 2;
+			color[3] = 255;
+		}
+
+		// 4 colors when c0 > c1, 3 colors and transparent black otherwise
+		void bc1Palette(uint16_t c0, uint16_t c1, int colors[4][4])
+		{
+			unpackColor565(c0, colors[0]);
+			unpackColor565(c1, colors[1]);
+			for (int c = 0; c < 4; c++)
+			{
+				if (c0 > c1)
+				{
+					colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+					colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+				}
+				else
+				{
+					colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+					colors[3][c] = 0;
+				}
+			}
+		}
+
+		struct Bc1Candidate
+		{
+			uint16_t c0;
+			uint16_t c1;
+			uint8_t indices[16];
+			float error;
+		};
+
+		Bc1Candidate bc1Candidate(const Block & block, const float *e0, const float *e1, bool simd)
+		{
+			Bc1Candidate candidate;
+			candidate.c0 = packColor565(e0);
+			candidate.c1 = packColor565(e1);
+			if (candidate.c0 < candidate.c1)
+			{
+				std::swap(candidate.c0, candidate.c1);
+			}
+
+			int colors[4][4];
+			bc1Palette(candidate.c0, candidate.c1, colors);
+
+			// equal endpoints fall in 3 colors mode, only the first one is used
+			Palette palette;
+			palette.size = candidate.c0 == candidate.c1 ? 1 : 4;
+			for (int k = 0; k < palette.size; k++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					palette.colors[k][c] = static_cast<float>(colors[k][c]);
+				}
+			}
+
+			candidate.error = selectIndices(block, palette, 3, candidate.indices, simd);
+			return candidate;
+		}
+
+		void encodeBC1(const Block & block, uint8_t *out, bool simd)
+		{
+			float e0[4], e1[4];
+			principalEndpoints(block, 3, e0, e1);
+			Bc1Candidate best = bc1Candidate(block, e1, e0, simd);
+
+			// palette order: c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+			const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+			if (best.c0 != best.c1 && refineEndpoints(block, 3, best.indices, weights, e0, e1))
+			{
+				Bc1Candidate refined = bc1Candidate(block, e0, e1, simd);
+				if (refined.error < best.error)
+				{
+					best = refined;
+				}
+			}
+
+			uint32_t indices = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				indices |= static_cast<uint32_t>(best.indices[i]) << (2 * i);
+			}
+			out[0] = static_cast<uint8_t>(best.c0);
+			out[1] = static_cast<uint8_t>(best.c0 >> 8);
+			out[2] = static_cast<uint8_t>(best.c1);
+			out[3] = static_cast<uint8_t>(best.c1 >> 8);
+			std::memcpy(out + 4, &indices, sizeof(indices));
+		}
+
+		void decodeBC1(const uint8_t *in, uint8_t *pixels)
+		{
+			uint16_t c0 = static_cast<uint16_t>(in[0] | in[1] << 8);
+			uint16_t c1 = static_cast<uint16_t>(in[2] | in[3] << 8);
+			int colors[4][4];
+			bc1Palette(c0, c1, colors);
+
+			uint32_t indices;
+			std::memcpy(&indices, in + 4, sizeof(indices));
+			for (int i = 0; i < 16; i++)
+			{
+				int index = indices >> (2 * i) & 3;
+				for (int c = 0; c < 4; c++)
+				{
+					pixels[i * 4 + c] = static_cast<uint8_t>(colors[index][c]);
+				}
+			}
+		}
+
+		// BC7 mode 6
+
+		struct Bc7Endpoint
+		{
+			int values[4];
+			int pbit;
+		};
+
+		// the 7 bits and the p-bit closest to color, the p-bit is the low bit of every channel
+		Bc7Endpoint quantizeBC7(const float *color)
+		{
+			Bc7Endpoint best = {};
+			float bestError = std::numeric_limits<float>::max();
+			for (int pbit = 0; pbit < 2; pbit++)
+			{
+				Bc7Endpoint endpoint;
+				endpoint.pbit = pbit;
+				float error = 0.0f;
+				for (int c = 0; c < 4; c++)
+				{
+					int value = std::clamp(static_cast<int>(std::lround((color[c] - pbit) / 2.0f)), 0, 127);
+					endpoint.values[c] = value;
+					float d = static_cast<float>(value << 1 | pbit) - color[c];
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					best = endpoint;
+				}
+			}
+			return best;
+		}
+
+		void bc7Palette(const Bc7Endpoint & e0, const Bc7Endpoint & e1, int colors[16][4])
+		{
+			for (int k = 0; k < 16; k++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					int v0 = e0.values[c] << 1 | e0.pbit;
+					int v1 = e1.values[c] << 1 | e1.pbit;
+					colors[k][c] = ((64 - bc7_weights[k]) * v0 + bc7_weights[k] * v1 + 32) >> 6;
+				}
+			}
+		}
+
+		struct Bc7Candidate
+		{
+			Bc7Endpoint e0;
+			Bc7Endpoint e1;
+			uint8_t indices[16];
+			float error;
+		};
+
+		Bc7Candidate bc7Candidate(const Block & block, const float *e0, const float *e1, bool simd)
+		{
+			Bc7Candidate candidate;
+			candidate.e0 = quantizeBC7(e0);
+			candidate.e1 = quantizeBC7(e1);
+
+			int colors[16][4];
+			bc7Palette(candidate.e0, candidate.e1, colors);
+
+			Palette palette;
+			palette.size = 16;
+			for (int k = 0; k < 16; k++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					palette.colors[k][c] = static_cast<float>(colors[k][c]);
+				}
+			}
+
+			candidate.error = selectIndices(block, palette, 4, candidate.indices, simd);
+			return candidate;
+		}
+
+		// little endian bit stream, the first field in the lowest bits
+		struct BitWriter
+		{
+			uint8_t *data;
+			int position = 0;
+
+			void write(uint32_t value, int bits)
+			{
+				for (int i = 0; i < bits; i++, position++)
+				{
+					data[position / 8] |= static_cast<uint8_t>((value >> i & 1) << (position % 8));
+				}
+			}
+		};
+
+		struct BitReader
+		{
+			const uint8_t *data;
+			int position = 0;
+
+			uint32_t read(int bits)
+			{
+				uint32_t value = 0;
+				for (int i = 0; i < bits; i++, position++)
+				{
+					value |= static_cast<uint32_t>(data[position / 8] >> (position % 8) & 1) << i;
+				}
+				return value;
+			}
+		};
+
+		void encodeBC7(const Block & block, uint8_t *out, bool simd)
+		{
+			float e0[4], e1[4];
+			principalEndpoints(block, 4, e0, e1);
+			Bc7Candidate best = bc7Candidate(block, e0, e1, simd);
+
+			float weights[16];
+			for (int k = 0; k < 16; k++)
+			{
+				weights[k] = bc7_weights[k] / 64.0f;
+			}
+			if (refineEndpoints(block, 4, best.indices, weights, e0, e1))
+			{
+				Bc7Candidate refined = bc7Candidate(block, e0, e1, simd);
+				if (refined.error < best.error)
+				{
+					best = refined;
+				}
+			}
+
+			// the anchor index is stored without its high bit, swapping the endpoints clears it
+			if (best.indices[0] >= 8)
+			{
+				std::swap(best.e0, best.e1);
+				for (auto& index : best.indices)
+				{
+					index = static_cast<uint8_t>(15 - index);
+				}
+			}
+
+			std::memset(out, 0, 16);
+			BitWriter writer{ out };
+			writer.write(1 << 6, 7);
+			for (int c = 0; c < 4; c++)
+			{
+				writer.write(static_cast<uint32_t>(best.e0.values[c]), 7);
+				writer.write(static_cast<uint32_t>(best.e1.values[c]), 7);
+			}
+			writer.write(static_cast<uint32_t>(best.e0.pbit), 1);
+			writer.write(static_cast<uint32_t>(best.e1.pbit), 1);
+			for (int i = 0; i < 16; i++)
+			{
+				writer.write(best.indices[i], i == 0 ? 3 : 4);
+			}
+		}
+
+		void decodeBC7(const uint8_t *in, uint8_t *pixels)
+		{
+			BitReader reader{ in };
+			if (reader.read(7) != 1 << 6)
+			{
+				throw std::runtime_error("only BC7 mode 6 blocks can be decoded");
+			}
+
+			Bc7Endpoint e0, e1;
+			for (int c = 0; c < 4; c++)
+			{
+				e0.values[c] = static_cast<int>(reader.read(7));
+				e1.values[c] = static_cast<int>(reader.read(7));
+			}
+			e0.pbit = static_cast<int>(reader.read(1));
+			e1.pbit = static_cast<int>(reader.read(1));
+
+			int colors[16][4];
+			bc7Palette(e0, e1, colors);
+			for (int i = 0; i < 16; i++)
+			{
+				uint32_t index = reader.read(i == 0 ? 3 : 4);
+				for (int c = 0; c < 4; c++)
+				{
+					pixels[i * 4 + c] = static_cast<uint8_t>(colors[index][c]);
+				}
+			}
+		}
+
+		// 4x4 texels at block x, y, clamped to the image
+		void gatherBlock(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t x, uint32_t y, uint8_t *out)
+		{
+			for (uint32_t row = 0; row < 4; row++)
+			{
+				uint32_t sy = std::min(y * 4 + row, height - 1);
+				for (uint32_t column = 0; column < 4; column++)
+				{
+					uint32_t sx = std::min(x * 4 + column, width - 1);
+					std::memcpy(out + (row * 4 + column) * 4, pixels + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+				}
+			}
+		}
+	}
+
+	uint32_t blockBytes(Format format)
+	{
+		return format == Format::BC1 ? 8 : 16;
+	}
+
+	VkFormat vkFormat(Format format, bool srgb)
+	{
+		if (format == Format::BC1)
+		{
+			return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		}
+		return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+
+	void encodeBlock(Format format, const uint8_t *pixels, uint8_t *block, bool simd)
+	{
+		Block texels = loadBlock(pixels);
+		if (format == Format::BC1)
+		{
+			encodeBC1(texels, block, simd);
+		}
+		else
+		{
+			encodeBC7(texels, block, simd);
+		}
+	}
+
+	void decodeBlock(Format format, const uint8_t *block, uint8_t *pixels)
+	{
+		if (format == Format::BC1)
+		{
+			decodeBC1(block, pixels);
+		}
+		else
+		{
+			decodeBC7(block, pixels);
+		}
+	}
+
+	std::vector<uint8_t> encodeImage(
+		Format format,
+		const uint8_t *pixels,
+		uint32_t width,
+		uint32_t height,
+		LIB_NAMESPACE::ThreadPool & pool,
+		bool simd
+	)
+	{
+		if (width == 0 || height == 0)
+		{
+			return {};
+		}
+
+		uint32_t blocksX = (width + 3) / 4;
+		uint32_t blocksY = (height + 3) / 4;
+		uint32_t bytes = blockBytes(format);
+		std::vector<uint8_t> blocks(static_cast<size_t>(blocksX) * blocksY * bytes);
+
+		// a few tasks per thread so uneven rows still keep every thread busy
+		uint32_t taskCount = std::min(blocksY, pool.threadCount() * 4);
+		uint32_t rowsPerTask = (blocksY + taskCount - 1) / taskCount;
+
+		std::vector<std::future<void>> tasks;
+		for (uint32_t first = 0; first < blocksY; first += rowsPerTask)
+		{
+			uint32_t last = std::min(first + rowsPerTask, blocksY);
+			tasks.push_back(pool.submit([=, &blocks]()
+			{
+				uint8_t texels[64];
+				for (uint32_t y = first; y < last; y++)
+				{
+					for (uint32_t x = 0; x < blocksX; x++)
+					{
+						gatherBlock(pixels, width, height, x, y, texels);
+						encodeBlock(format, texels, blocks.data() + (static_cast<size_t>(y) * blocksX + x) * bytes, simd);
+					}
+				}
+			}));
+		}
+		for (auto& task : tasks)
+		{
+			task.get();
+		}
+
+		return blocks;
+	}
+
+	std::vector<uint8_t> decodeImage(Format format, const uint8_t *blocks, uint32_t width, uint32_t height)
+	{
+		uint32_t blocksX = (width + 3) / 4;
+		uint32_t blocksY = (height + 3) / 4;
+		uint32_t bytes = blockBytes(format);
+		std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+
+		uint8_t texels[64];
+		for (uint32_t y = 0; y < blocksY; y++)
+		{
+			for (uint32_t x = 0; x < blocksX; x++)
+			{
+				decodeBlock(format, blocks + (static_cast<size_t>(y) * blocksX + x) * bytes, texels);
+				for (uint32_t row = 0; row < 4 && y * 4 + row < height; row++)
+				{
+					uint32_t columns = std::min(4u, width - x * 4);
+					std::memcpy(
+						pixels.data() + ((static_cast<size_t>(y) * 4 + row) * width + x * 4) * 4,
+						texels + row * 16,
+						columns * 4
+					);
+				}
+			}
+		}
+
+		return pixels;
+	}
+
+	double psnr(const uint8_t *a, const uint8_t *b, size_t pixel_count, bool alpha)
+	{
+		int channel_count = alpha ? 4 : 3;
+		double sum = 0.0;
+		for (size_t i = 0; i < pixel_count; i++)
+		{
+			for (int c = 0; c < channel_count; c++)
+			{
+				double d = static_cast<double>(a[i * 4 + c]) - b[i * 4 + c];
+				sum += d * d;
+			}
+		}
+
+		double mse = sum / (static_cast<double>(pixel_count) * channel_count);
+		if (mse == 0.0)
+		{
+			return std::numeric_limits<double>::infinity();
+		}
+		return 10.0 * std::log10(255.0 * 255.0 / mse);
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "thread_pool.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// BC1 and BC7 encoders for RGBA8 images, shared by texture_baker and texture_compression_benchmark.
+// Endpoints come from the principal axis of the block and are refined once by least squares,
+// the index search is vectorized with SSE2 over 4 texels at a time.
+namespace bc
+{
+	enum class Format
+	{
+		// opaque, alpha is dropped
+		BC1,
+		// mode 6 only, 7 bits RGBA endpoints with a p-bit and 4 bits indices
+		BC7
+	};
+
+	uint32_t blockBytes(Format format);
+	VkFormat vkFormat(Format format, bool srgb);
+
+	// pixels are the 16 RGBA8 texels of a 4x4 block, row by row
+	void encodeBlock(Format format, const uint8_t *pixels, uint8_t *block, bool simd = true);
+	// BC7 blocks must be mode 6, the only one encodeBlock writes
+	void decodeBlock(Format format, const uint8_t *block, uint8_t *pixels);
+
+	// blocks of the image in row order, the texels past the edge repeat the last row and column
+	// and the rows of blocks are spread over the pool, an empty image has no blocks
+	std::vector<uint8_t> encodeImage(
+		Format format,
+		const uint8_t *pixels,
+		uint32_t width,
+		uint32_t height,
+		LIB_NAMESPACE::ThreadPool & pool,
+		bool simd = true
+	);
+	std::vector<uint8_t> decodeImage(Format format, const uint8_t *blocks, uint32_t width, uint32_t height);
+
+	// over RGB, or RGBA when alpha is set, of two RGBA8 images
+	double psnr(const uint8_t *a, const uint8_t *b, size_t pixel_count, bool alpha);
+}
@@ -0,0 +1,132 @@
+#include "map.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+// Compares lookups in the slot map backing RenderAPI handles with the std::map based Map it replaced.
+
+namespace
+{
+	// previous implementation of Map, kept here as the baseline
+	template<typename Value>
+	class TreeMap
+	{
+
+	public:
+
+		uint64_t insert(Value && value)
+		{
+			m_map.insert(std::make_pair(m_next_id, std::move(value)));
+			return m_next_id++;
+		}
+
+		Value & get(uint64_t key) { return m_map.at(key); }
+
+	private:
+
+		std::map<uint64_t, Value> m_map;
+		uint64_t m_next_id = 1;
+
+	};
+
+	// about the size of a Mesh, so the slot map pages are not unrealistically dense
+	struct Resource
+	{
+		uint64_t data[16];
+	};
+
+	struct Result
+	{
+		double insert_ns;
+		double lookup_ns;
+		uint64_t checksum;
+	};
+
+	template<typename MapType>
+	Result run(MapType & map, size_t count, size_t lookup_count)
+	{
+		using clock = std::chrono::steady_clock;
+
+		std::vector<uint64_t> ids;
+		ids.reserve(count);
+
+		auto start = clock::now();
+		for (size_t i = 0; i < count; i++)
+		{
+			Resource resource = {};
+			resource.data[0] = i;
+			ids.push_back(map.insert(std::move(resource)));
+		}
+		auto inserted = clock::now();
+
+		// random access, like draw calls walking a scene in no particular order
+		std::mt19937_64 rng(42);
+		std::vector<uint64_t> lookups(lookup_count);
+		for (auto& lookup : lookups)
+		{
+			lookup = ids[rng() % ids.size()];
+		}
+
+		uint64_t checksum = 0;
+		auto lookup_start = clock::now();
+		for (auto& lookup : lookups)
+		{
+			checksum += map.get(lookup).data[0];
+		}
+		auto end = clock::now();
+
+		Result result;
+		result.insert_ns = std::chrono::duration<double, std::nano>(inserted - start).count() / count;
+		result.lookup_ns = std::chrono::duration<double, std::nano>(end - lookup_start).count() / lookup_count;
+		result.checksum = checksum;
+		return result;
+	}
+}
+
+int main()
+{
+	const size_t lookup_count = 10'000'000;
+
+	std::cout << std::setw(10) << "entries"
+		<< std::setw(18) << "std::map insert"
+		<< std::setw(18) << "std::map get"
+		<< std::setw(18) << "slot map insert"
+		<< std::setw(18) << "slot map get"
+		<< std::setw(10) << "speedup" << std::endl;
+
+	for (size_t count : {1'000, 100'000, 1'000'000})
+	{
+		Result tree_result;
+		{
+			TreeMap<Resource> tree_map;
+			tree_result = run(tree_map, count, lookup_count);
+		}
+
+		Result slot_result;
+		{
+			LIB_NAMESPACE::Map<Resource> slot_map;
+			slot_result = run(slot_map, count, lookup_count);
+		}
+
+		if (tree_result.checksum != slot_result.checksum)
+		{
+			std::cerr << "checksum mismatch for " << count << " entries" << std::endl;
+			return 1;
+		}
+
+		std::cout << std::fixed << std::setprecision(1)
+			<< std::setw(10) << count
+			<< std::setw(15) << tree_result.insert_ns << " ns"
+			<< std::setw(15) << tree_result.lookup_ns << " ns"
+			<< std::setw(15) << slot_result.insert_ns << " ns"
+			<< std::setw(15) << slot_result.lookup_ns << " ns"
+			<< std::setw(9) << tree_result.lookup_ns / slot_result.lookup_ns << "x" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include "render_api.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+// Cold-start time of pipeline creation with and without the persisted pipeline cache.
+// Run it twice: the first run writes the cache file, the second one starts from it.
+
+namespace
+{
+	const char *cache_path = "pipeline_cache_benchmark.bin";
+
+	struct Result
+	{
+		double startup_ms;
+		double pipeline_ms;
+		bool cache_loaded;
+	};
+
+	Result run(const std::string & vertex_shader, const std::string & fragment_shader, const std::string & path)
+	{
+		using clock = std::chrono::steady_clock;
+
+		auto start = clock::now();
+		LIB_NAMESPACE::RenderAPI renderAPI(VkExtent2D{256, 256}, path);
+
+		LIB_NAMESPACE::Pipeline::CreateInfo pipelineInfo = {};
+		pipelineInfo.vertex_shader_path = vertex_shader;
+		pipelineInfo.fragment_shader_path = fragment_shader;
+		pipelineInfo.color_target_ids = { renderAPI.newColorTarget() };
+		pipelineInfo.depth_target_id = renderAPI.newDepthTarget();
+
+		auto pipeline_start = clock::now();
+		renderAPI.newPipeline(pipelineInfo);
+		auto end = clock::now();
+
+		Result result;
+		result.startup_ms = std::chrono::duration<double, std::milli>(end - start).count();
+		result.pipeline_ms = std::chrono::duration<double, std::milli>(end - pipeline_start).count();
+		result.cache_loaded = renderAPI.pipelineCacheLoaded();
+		return result;
+	}
+
+	void print(const char *name, const Result & result)
+	{
+		std::cout << std::fixed << std::setprecision(2)
+			<< std::setw(14) << name
+			<< std::setw(12) << result.startup_ms << " ms"
+			<< std::setw(12) << result.pipeline_ms << " ms"
+			<< std::setw(12) << (result.cache_loaded ? "yes" : "no") << std::endl;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 3 && argc != 4)
+	{
+		std::cerr << "usage: " << argv[0] << " <vertex.spv> <fragment.spv> [--reset]" << std::endl;
+		return 1;
+	}
+
+	if (argc == 4 && std::string(argv[3]) == "--reset")
+	{
+		std::remove(cache_path);
+	}
+
+	std::cout << std::setw(14) << "cache"
+		<< std::setw(15) << "startup"
+		<< std::setw(15) << "pipeline"
+		<< std::setw(12) << "loaded" << std::endl;
+
+	// the uncached run goes first so it does not benefit from anything the cached one compiled
+	print("none", run(argv[1], argv[2], ""));
+	print("file", run(argv[1], argv[2], cache_path));
+
+	return 0;
+}
@@ -0,0 +1,260 @@
+#include "bc_encoder.hpp"
+#include "descriptor/texture.hpp"
+#include "descriptor/compressed_texture.hpp"
+#include "mipmap_generator.hpp"
+#include "thread_pool.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Bakes a PNG or JPG into a BC7 or BC1 KTX2 file with its whole mip chain, ready for Texture.
+//
+// usage: texture_baker [--bc1] [--linear] [--threads N] input.png output.ktx2
+//   --bc1      BC1 instead of BC7, half the size but opaque and lower quality
+//   --linear   UNORM data like normal maps, sRGB otherwise
+
+namespace
+{
+	struct Options
+	{
+		bc::Format format = bc::Format::BC7;
+		bool srgb = true;
+		unsigned int threads = 0;
+		std::string input;
+		std::string output;
+	};
+
+	bool parseOptions(int argc, char **argv, Options & options)
+	{
+		std::vector<std::string> paths;
+		for (int i = 1; i < argc; i++)
+		{
+			std::string argument = argv[i];
+			if (argument == "--bc1")
+			{
+				options.format = bc::Format::BC1;
+			}
+			else if (argument == "--linear")
+			{
+				options.srgb = false;
+			}
+			else if (argument == "--threads" && i + 1 < argc)
+			{
+				// a number only, std::stoul would throw before main reports errors, and take -1 as a huge count
+				std::string value = argv[++i];
+				unsigned long threads = std::strtoul(value.c_str(), nullptr, 10);
+				if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos || threads > 1024)
+				{
+					std::cerr << "invalid --threads value: " << value << std::endl;
+					return false;
+				}
+				options.threads = static_cast<unsigned int>(threads);
+			}
+			else
+			{
+				paths.push_back(argument);
+			}
+		}
+
+		if (paths.size() != 2)
+		{
+			return false;
+		}
+		options.input = paths[0];
+		options.output = paths[1];
+		return true;
+	}
+
+	void append32(std::vector<uint8_t> & data, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+		}
+	}
+
+	void append64(std::vector<uint8_t> & data, uint64_t value)
+	{
+		append32(data, static_cast<uint32_t>(value));
+		append32(data, static_cast<uint32_t>(value >> 32));
+	}
+
+	// basic data format descriptor with a single sample covering the whole block
+	std::vector<uint8_t> dataFormatDescriptor(bc::Format format, bool srgb)
+	{
+		const uint32_t model_bc1a = 128;
+		const uint32_t model_bc7 = 134;
+		const uint32_t primaries_bt709 = 1;
+		const uint32_t transfer = srgb ? 2 : 1;
+		const uint32_t block_size = 24 + 16;
+		uint32_t bytes = bc::blockBytes(format);
+
+		std::vector<uint8_t> dfd;
+		append32(dfd, 4 + block_size);
+		append32(dfd, 0);
+		append32(dfd, 2 | block_size << 16);
+		append32(dfd, (format == bc::Format::BC1 ? model_bc1a : model_bc7) | primaries_bt709 << 8 | transfer << 16);
+		append32(dfd, 3 | 3 << 8);
+		append32(dfd, bytes);
+		append32(dfd, 0);
+
+		append32(dfd, (bytes * 8 - 1) << 16);
+		append32(dfd, 0);
+		append32(dfd, 0);
+		append32(dfd, 0xFFFFFFFF);
+		return dfd;
+	}
+
+	// levels are given largest first and stored smallest first, each aligned to the block size
+	void writeKtx2(
+		const std::string & path,
+		bc::Format format,
+		bool srgb,
+		uint32_t width,
+		uint32_t height,
+		const std::vector<std::vector<uint8_t>> & levels
+	)
+	{
+		const uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+		uint32_t levelCount = static_cast<uint32_t>(levels.size());
+		std::vector<uint8_t> dfd = dataFormatDescriptor(format, srgb);
+
+		uint64_t dfdOffset = 80 + 24 * static_cast<uint64_t>(levelCount);
+		uint64_t alignment = bc::blockBytes(format);
+
+		std::vector<uint64_t> offsets(levelCount);
+		uint64_t offset = dfdOffset + dfd.size();
+		for (uint32_t i = levelCount; i-- > 0;)
+		{
+			offset = (offset + alignment - 1) / alignment * alignment;
+			offsets[i] = offset;
+			offset += levels[i].size();
+		}
+
+		std::vector<uint8_t> file(identifier, identifier + sizeof(identifier));
+		append32(file, static_cast<uint32_t>(bc::vkFormat(format, srgb)));
+		append32(file, 1);
+		append32(file, width);
+		append32(file, height);
+		append32(file, 0);
+		append32(file, 0);
+		append32(file, 1);
+		append32(file, levelCount);
+		append32(file, 0);
+
+		append32(file, static_cast<uint32_t>(dfdOffset));
+		append32(file, static_cast<uint32_t>(dfd.size()));
+		append32(file, 0);
+		append32(file, 0);
+		append64(file, 0);
+		append64(file, 0);
+
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			append64(file, offsets[i]);
+			append64(file, levels[i].size());
+			append64(file, levels[i].size());
+		}
+		file.insert(file.end(), dfd.begin(), dfd.end());
+
+		file.resize(offset);
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			std::memcpy(file.data() + offsets[i], levels[i].data(), levels[i].size());
+		}
+
+		std::ofstream stream(path, std::ios::binary);
+		stream.write(reinterpret_cast<const char *>(file.data()), static_cast<std::streamsize>(file.size()));
+		if (stream.good() == false)
+		{
+			throw std::runtime_error("failed to write " + path);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	Options options;
+	if (parseOptions(argc, argv, options) == false)
+	{
+		std::cerr << "usage: " << argv[0] << " [--bc1] [--linear] [--threads N] input.png output.ktx2" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		using clock = std::chrono::steady_clock;
+
+		LIB_NAMESPACE::Texture::Pixels pixels = LIB_NAMESPACE::Texture::decode(options.input);
+		uint32_t width = static_cast<uint32_t>(pixels.width);
+		uint32_t height = static_cast<uint32_t>(pixels.height);
+		uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+		auto start = clock::now();
+
+		// the same filter Texture uses when it generates the levels on the CPU
+		std::vector<unsigned char> chain = LIB_NAMESPACE::MipmapGenerator::downsample(
+			pixels.data.get(),
+			width,
+			height,
+			mipLevels,
+			options.srgb
+		);
+
+		LIB_NAMESPACE::ThreadPool pool(options.threads);
+		std::vector<std::vector<uint8_t>> levels;
+		double psnr = 0.0;
+		size_t texels = 0;
+		size_t offset = 0;
+		for (uint32_t level = 0; level < mipLevels; level++)
+		{
+			uint32_t levelWidth = std::max(width >> level, 1u);
+			uint32_t levelHeight = std::max(height >> level, 1u);
+			const uint8_t *levelPixels = chain.data() + offset;
+
+			levels.push_back(bc::encodeImage(options.format, levelPixels, levelWidth, levelHeight, pool));
+			if (level == 0)
+			{
+				std::vector<uint8_t> decoded = bc::decodeImage(options.format, levels.back().data(), levelWidth, levelHeight);
+				psnr = bc::psnr(levelPixels, decoded.data(), static_cast<size_t>(levelWidth) * levelHeight, options.format == bc::Format::BC7);
+			}
+
+			texels += static_cast<size_t>(levelWidth) * levelHeight;
+			offset += static_cast<size_t>(levelWidth) * levelHeight * 4;
+		}
+
+		double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+		writeKtx2(options.output, options.format, options.srgb, width, height, levels);
+
+		// the output goes through the same parser as Texture
+		LIB_NAMESPACE::CompressedTexture baked(options.output, options.srgb);
+		if (baked.levels().size() != mipLevels)
+		{
+			throw std::runtime_error("failed to read back " + options.output);
+		}
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< options.output << ": " << width << "x" << height
+			<< (options.format == bc::Format::BC1 ? " BC1" : " BC7")
+			<< (options.srgb ? " sRGB" : " UNORM")
+			<< ", " << mipLevels << " levels, " << baked.size() / 1024 << " KiB"
+			<< ", " << texels / seconds / 1e6 << " MP/s on " << pool.threadCount() << " threads"
+			<< ", level 0 PSNR " << psnr << " dB" << std::endl;
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,151 @@
+#include "bc_encoder.hpp"
+#include "descriptor/texture.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+// Throughput and quality of the BC1 and BC7 encoders used by texture_baker.
+// Encodes an image, or a generated one without argument, with the scalar and the SSE2 index search
+// on one thread and on every thread, and reports megapixels per second and the PSNR of the decoded blocks.
+
+namespace
+{
+	struct Image
+	{
+		std::vector<uint8_t> pixels;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	// smooth gradients, hard edges and noise, the cases block compression finds hard in different ways
+	Image generateImage(uint32_t size)
+	{
+		Image image;
+		image.width = size;
+		image.height = size;
+		image.pixels.resize(static_cast<size_t>(size) * size * 4);
+
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<int> noise(-12, 12);
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				uint8_t *texel = image.pixels.data() + (static_cast<size_t>(y) * size + x) * 4;
+				float u = static_cast<float>(x) / size;
+				float v = static_cast<float>(y) / size;
+				bool checker = ((x / 37) + (y / 53)) % 2 == 0;
+
+				int r = static_cast<int>(255.0f * u);
+				int g = static_cast<int>(255.0f * (0.5f + 0.5f * std::sin(v * 20.0f)));
+				int b = checker ? 200 : 40;
+				int a = static_cast<int>(255.0f * v);
+				texel[0] = static_cast<uint8_t>(std::clamp(r + noise(rng), 0, 255));
+				texel[1] = static_cast<uint8_t>(std::clamp(g + noise(rng), 0, 255));
+				texel[2] = static_cast<uint8_t>(std::clamp(b + noise(rng), 0, 255));
+				texel[3] = static_cast<uint8_t>(a);
+			}
+		}
+		return image;
+	}
+
+	struct Result
+	{
+		double megapixels_per_second;
+		double psnr;
+	};
+
+	Result run(bc::Format format, const Image & image, LIB_NAMESPACE::ThreadPool & pool, bool simd)
+	{
+		using clock = std::chrono::steady_clock;
+
+		// best of a few runs, the first one also warms up the pool
+		double best = 0.0;
+		std::vector<uint8_t> blocks;
+		for (int i = 0; i < 3; i++)
+		{
+			auto start = clock::now();
+			blocks = bc::encodeImage(format, image.pixels.data(), image.width, image.height, pool, simd);
+			double seconds = std::chrono::duration<double>(clock::now() - start).count();
+			best = std::max(best, static_cast<double>(image.width) * image.height / seconds / 1e6);
+		}
+
+		std::vector<uint8_t> decoded = bc::decodeImage(format, blocks.data(), image.width, image.height);
+
+		Result result;
+		result.megapixels_per_second = best;
+		result.psnr = bc::psnr(
+			image.pixels.data(),
+			decoded.data(),
+			static_cast<size_t>(image.width) * image.height,
+			format == bc::Format::BC7
+		);
+		return result;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 2)
+	{
+		std::cerr << "usage: " << argv[0] << " [image]" << std::endl;
+		return 1;
+	}
+
+	Image image;
+	if (argc == 2)
+	{
+		try
+		{
+			LIB_NAMESPACE::Texture::Pixels pixels = LIB_NAMESPACE::Texture::decode(argv[1]);
+			image.width = static_cast<uint32_t>(pixels.width);
+			image.height = static_cast<uint32_t>(pixels.height);
+			image.pixels.assign(pixels.data.get(), pixels.data.get() + static_cast<size_t>(image.width) * image.height * 4);
+		}
+		catch (const std::exception & e)
+		{
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+	else
+	{
+		image = generateImage(2048);
+	}
+
+	LIB_NAMESPACE::ThreadPool single(1);
+	LIB_NAMESPACE::ThreadPool all;
+
+	std::cout << image.width << "x" << image.height << ", PSNR over RGB for BC1 and RGBA for BC7" << std::endl;
+	std::cout << std::setw(8) << "format"
+		<< std::setw(10) << "search"
+		<< std::setw(10) << "threads"
+		<< std::setw(14) << "MP/s"
+		<< std::setw(14) << "PSNR" << std::endl;
+
+	for (bc::Format format : { bc::Format::BC1, bc::Format::BC7 })
+	{
+		for (bool simd : { false, true })
+		{
+			for (LIB_NAMESPACE::ThreadPool * pool : { &single, &all })
+			{
+				Result result = run(format, image, *pool, simd);
+				std::cout << std::fixed << std::setprecision(2)
+					<< std::setw(8) << (format == bc::Format::BC1 ? "BC1" : "BC7")
+					<< std::setw(10) << (simd ? "SSE2" : "scalar")
+					<< std::setw(10) << pool->threadCount()
+					<< std::setw(14) << result.megapixels_per_second
+					<< std::setw(11) << result.psnr << " dB" << std::endl;
+			}
+		}
+	}
+
+	return 0;
+}